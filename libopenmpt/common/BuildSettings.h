@@ -12,6 +12,7 @@
 
 
 
+#include "mpt/base/detect_arch.hpp"
 #include "mpt/base/detect_compiler.hpp"
 #include "mpt/base/detect_os.hpp"
 #include "mpt/base/detect_quirks.hpp"
@@ -164,8 +165,8 @@
 #else
 //#define MPT_ENABLE_CHARSET_LOCALE
 #endif
-// Do not use architecture-specifid intrinsics in library builds. There is just about no codepath which would use it anyway.
-//#define MPT_ENABLE_ARCH_INTRINSICS
+// Use architecture-specific intrinsics (runtime-dispatched mixer interpolation kernels)
+#define MPT_ENABLE_ARCH_INTRINSICS
 #if defined(MPT_BUILD_HACK_ARCHIVE_SUPPORT)
 //#define NO_ARCHIVE_SUPPORT
 #else
@@ -235,7 +236,20 @@
 #define MPT_ENABLE_ARCH_INTRINSICS_SSE
 #define MPT_ENABLE_ARCH_INTRINSICS_SSE2
 
+#elif (MPT_COMPILER_GCC || MPT_COMPILER_CLANG) && MPT_ARCH_X86
+
+#define MPT_ENABLE_ARCH_X86
+
+#elif (MPT_COMPILER_GCC || MPT_COMPILER_CLANG) && MPT_ARCH_AMD64
+
+#define MPT_ENABLE_ARCH_AMD64
+
 #endif // arch
+#if defined(MPT_ENABLE_ARCH_X86) || defined(MPT_ENABLE_ARCH_AMD64)
+// Code using these must be compiled with MPT_ARCH_TARGET_SSE4 / MPT_ARCH_TARGET_AVX2 and only be called after checking the CPU features.
+#define MPT_ENABLE_ARCH_INTRINSICS_SSE4
+#define MPT_ENABLE_ARCH_INTRINSICS_AVX2
+#endif // MPT_ENABLE_ARCH_X86 || MPT_ENABLE_ARCH_AMD64
 #endif // MPT_ENABLE_ARCH_INTRINSICS
 
 #if defined(ENABLE_TESTS) && defined(MODPLUG_NO_FILESAVE)
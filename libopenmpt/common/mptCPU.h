@@ -18,6 +18,20 @@
 #endif
 
 
+// Function attributes allowing the use of instruction set extensions that are not enabled for the whole build.
+// MSVC does not need them, intrinsics for all instruction sets can be used anywhere.
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4) && (MPT_COMPILER_GCC || MPT_COMPILER_CLANG)
+#define MPT_ARCH_TARGET_SSE4 __attribute__((target("sse4.1")))
+#else
+#define MPT_ARCH_TARGET_SSE4
+#endif
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_AVX2) && (MPT_COMPILER_GCC || MPT_COMPILER_CLANG)
+#define MPT_ARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MPT_ARCH_TARGET_AVX2
+#endif
+
+
 OPENMPT_NAMESPACE_BEGIN
 
 
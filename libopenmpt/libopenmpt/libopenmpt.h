@@ -1417,7 +1417,9 @@ LIBOPENMPT_API const char * openmpt_module_highlight_pattern_row_channel( openmp
  *          - load.skip_patterns (boolean): Set to "1" to avoid loading patterns into memory
  *          - load.skip_plugins (boolean): Set to "1" to avoid loading plugins
  *          - load.skip_subsongs_init (boolean): Set to "1" to avoid pre-initializing sub-songs. Skipping results in faster module loading but slower seeking.
+ *          - load.subsongs (text): Sub-song boundaries and durations as returned by getting this ctl from a previously loaded instance of the same module, in the form "sequence,order,row,duration" with sub-songs separated by ";". If set when loading and the data is valid for the module, the sub-songs are not computed again. Setting it after loading with load.skip_subsongs_init only has an effect if the sub-songs have not been computed yet. Getting this ctl returns the sub-songs of the current module.
  *          - seek.sync_samples (boolean): Set to "0" to not sync sample playback when using openmpt_module_set_position_seconds or openmpt_module_set_position_order_row.
+ *          - seek.checkpoint_interval (floatingpoint): Interval in seconds at which playback state snapshots are recorded. openmpt_module_set_position_seconds resumes from the closest snapshot instead of replaying the song from the start. The snapshots are recorded in an additional pass through the module the first time a position past the first interval is requested rather than while loading. Set to "0" to disable. The default is "5.0".
  *          - subsong (integer): The current subsong. Setting it has identical semantics as openmpt_module_select_subsong(), getting it returns the currently selected subsong.
  *          - play.at_end (text): Chooses the behaviour when the end of song is reached. The song end is considered to be reached after the number of reptitions set by openmpt_module_set_repeat_count was played, so if the song is set to repeat infinitely, its end is never considered to be reached.
  *                         - "fadeout": Fades the module out for a short while. Subsequent reads after the fadeout will return 0 rendered frames.
@@ -1431,7 +1433,13 @@ LIBOPENMPT_API const char * openmpt_module_highlight_pattern_row_channel( openmp
  *                    - "a500": Amiga A500 filter.
  *                    - "a1200": Amiga A1200 filter.
  *                    - "unfiltered": BLEP synthesis without model-specific filters. The LED filter is ignored by this setting. This filter mode is considered to be experimental and might change in the future.
+ *          - render.resampler.sample_pyramids (boolean): Set to "1" to mix voices that are played an octave or more above the output sample rate from band-limited copies of the sample at half, quarter, etc. of its rate. This reduces aliasing and the number of sample frames read for very high notes. It only applies to cubic and 8-tap interpolation and to voices that play the sample's regular loop, and only if the loop points are multiples of the rate reduction. The copies of all samples are built when this is enabled, which takes time and memory proportional to the total length of all samples. The default is "0".
  *          - render.opl.volume_factor (floatingpoint): Set volume factor applied to synthesized OPL sounds, relative to the default OPL volume.
+ *          - render.mixer.float (boolean): Set to "1" to process the master mix (plugins, global volume and stereo separation) in floating point. This avoids converting the mix to fixed point and back around plugins, and avoids clipping before the final output conversion, which works best when reading floating point output. Voices are still mixed in fixed point. The output is not bit-identical to the default fixed point mix. The default is "0".
+ *          - render.mixer.threads (integer): Number of threads that voices are mixed on. Each additional thread mixes its share of the voices into private buffers, which are summed up in a fixed order, so the output is the same for any number of threads. Values of 1 or less mix all voices on the thread that renders audio. At most 64 threads are used. The default is "1".
+ *          - render.mixer.threads.min_voices (integer): Voices are only distributed over the threads set by render.mixer.threads if at least this many of them are active, so that modules with few voices do not pay for the synchronization. The default is "64".
+ *          - render.mixer.block_size (integer): Maximum number of frames that are mixed in one go. All internal mix buffers (including those of plugins) are sized accordingly. Larger blocks reduce per-block overhead when rendering offline, especially with many plugins, while smaller blocks use less memory and let plugin parameter changes take effect with finer granularity. The value is rounded down to a power of two between 64 and 4096. The default is "512".
+ *          - render.state_history (integer): Number of ticks for which a snapshot of the playback state is kept while rendering, so that visualizations can show what is audible right now instead of what has been rendered last. The snapshots can be read from any thread with openmpt_module_ext_interface_state_history. The default is "0", which disables recording. Setting it discards all snapshots and must not happen while the snapshots are being read or audio is being rendered.
  *          - dither (integer): Set the dither algorithm that is used for the 16 bit versions of openmpt_module_read. Supported values are:
  *                    - 0: No dithering.
  *                    - 1: Default mode. Chosen by OpenMPT code, might change.
@@ -1812,6 +1812,101 @@ static int set_current_tempo2( openmpt_module_ext * mod_ext, double tempo ) {
 
 
 
+static size_t read_interleaved_stereo_channels( openmpt_module_ext * mod_ext, int32_t samplerate, size_t count, float * interleaved_stereo, int32_t num_channels, float * const * channel_buffers ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->read_interleaved_stereo_channels( samplerate, count, interleaved_stereo, num_channels, channel_buffers );
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
+
+
+static int restart_subsong( openmpt_module_ext * mod_ext, int32_t subsong ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		mod_ext->impl->restart_subsong( subsong );
+		return 1;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
+
+
+static int queue_render_param( openmpt_module_ext * mod_ext, int param, int32_t value ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		mod_ext->impl->queue_render_param( param, value );
+		return 1;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
+static int queue_ctl( openmpt_module_ext * mod_ext, const char * ctl, const char * value ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		openmpt::interface::check_pointer( ctl );
+		openmpt::interface::check_pointer( value );
+		mod_ext->impl->queue_ctl( ctl, value );
+		return 1;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
+
+
+static uint64_t get_rendered_frames( openmpt_module_ext * mod_ext ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->get_rendered_frames();
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
+static int32_t get_state_at( openmpt_module_ext * mod_ext, uint64_t timestamp, openmpt_module_ext_playback_state * state, openmpt_module_ext_playback_state_channel * channels, int32_t num_channels ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		openmpt::interface::check_pointer( state );
+		if ( num_channels > 0 ) {
+			openmpt::interface::check_pointer( channels );
+		}
+		openmpt::ext::playback_state cxx_state{};
+		openmpt::ext::playback_state_channel cxx_channels[256];
+		const int32_t result = mod_ext->impl->get_state_at( timestamp, cxx_state, cxx_channels, std::min( num_channels, static_cast<int32_t>( std::size( cxx_channels ) ) ) );
+		if ( result < 0 ) {
+			return result;
+		}
+		state->timestamp = cxx_state.timestamp;
+		state->order = cxx_state.order;
+		state->pattern = cxx_state.pattern;
+		state->row = cxx_state.row;
+		state->speed = cxx_state.speed;
+		state->tempo = cxx_state.tempo;
+		for ( int32_t i = 0; i < result; ++i ) {
+			channels[i].vu_left = cxx_channels[i].vu_left;
+			channels[i].vu_right = cxx_channels[i].vu_right;
+			channels[i].note = cxx_channels[i].note;
+			channels[i].instrument = cxx_channels[i].instrument;
+		}
+		return result;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return -1;
+}
+
+
+
 /* add stuff here */
 
 
@@ -1877,6 +1972,27 @@ int openmpt_module_ext_get_interface( openmpt_module_ext * mod_ext, const char *
 
 
 
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_CHANNEL_OUTPUT ) && ( interface_size == sizeof( openmpt_module_ext_interface_channel_output ) ) ) {
+			openmpt_module_ext_interface_channel_output * i = static_cast< openmpt_module_ext_interface_channel_output * >( interface );
+			i->read_interleaved_stereo_channels = &read_interleaved_stereo_channels;
+			result = 1;
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_RESTART ) && ( interface_size == sizeof( openmpt_module_ext_interface_restart ) ) ) {
+			openmpt_module_ext_interface_restart * i = static_cast< openmpt_module_ext_interface_restart * >( interface );
+			i->restart_subsong = &restart_subsong;
+			result = 1;
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_QUEUED_PARAMS ) && ( interface_size == sizeof( openmpt_module_ext_interface_queued_params ) ) ) {
+			openmpt_module_ext_interface_queued_params * i = static_cast< openmpt_module_ext_interface_queued_params * >( interface );
+			i->queue_render_param = &queue_render_param;
+			i->queue_ctl = &queue_ctl;
+			result = 1;
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_STATE_HISTORY ) && ( interface_size == sizeof( openmpt_module_ext_interface_state_history ) ) ) {
+			openmpt_module_ext_interface_state_history * i = static_cast< openmpt_module_ext_interface_state_history * >( interface );
+			i->get_rendered_frames = &get_rendered_frames;
+			i->get_state_at = &get_state_at;
+			result = 1;
+
+
+
 /* add stuff here */
 
 
@@ -410,6 +410,137 @@ typedef struct openmpt_module_ext_interface_interactive3 {
 
 
 
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_CHANNEL_OUTPUT
+#define LIBOPENMPT_EXT_C_INTERFACE_CHANNEL_OUTPUT "channel_output"
+#endif
+
+typedef struct openmpt_module_ext_interface_channel_output {
+
+	/*! Render audio data along with the output of each individual channel
+	 *
+	 * Renders the stereo mix like openmpt_module_read_interleaved_float_stereo and, in the same pass, the dry contribution of each pattern channel. Voices that are playing in the background because of New Note Actions are added to the channel that triggered them.
+	 * \param mod_ext The module handle to work on.
+	 * \param samplerate Sample rate to render output. Should be in [8000,192000], but this is not enforced.
+	 * \param count Number of audio frames to render per channel.
+	 * \param interleaved_stereo Pointer to a buffer of at least count*2 floats that will receive the interleaved stereo mix.
+	 * \param num_channels Number of channels to output. Usually this is openmpt_module_get_num_channels().
+	 * \param channel_buffers Array of num_channels*2 pointers to buffers of at least count floats each. channel_buffers[2*n] receives the left and channel_buffers[2*n+1] the right output of channel n. Null pointers are skipped. Channels that do not exist in the module are filled with silence.
+	 * \return The number of frames actually rendered, or 0 if the end of song has been reached or an error occurred.
+	 * \remarks The channel output is taken before global volume, global DSP effects, plugins and stereo separation are applied. It also lacks the short fade-out that the stereo mix applies to voices that stopped abruptly, to avoid clicks. Hence it does not necessarily add up to the stereo mix.
+	 * \sa openmpt_module_read_interleaved_float_stereo
+	 */
+	size_t ( * read_interleaved_stereo_channels ) ( openmpt_module_ext * mod_ext, int32_t samplerate, size_t count, float * interleaved_stereo, int32_t num_channels, float * const * channel_buffers );
+
+} openmpt_module_ext_interface_channel_output;
+
+
+
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_RESTART
+#define LIBOPENMPT_EXT_C_INTERFACE_RESTART "restart"
+#endif
+
+typedef struct openmpt_module_ext_interface_restart {
+
+	/*! Restart playback of an already loaded module
+	 *
+	 * Resets the playback and mixer state to what it was right after loading the module and selects a sub-song. Rendering afterwards produces the same output as a freshly loaded module would, which allows reusing a loaded module instead of loading it again.
+	 * \param mod_ext The module handle to work on.
+	 * \param subsong Index of the sub-song. -1 plays all sub-songs consecutively.
+	 * \return 1 on success, 0 on failure.
+	 * \remarks Render parameters and ctls keep their current values.
+	 * \sa openmpt_module_select_subsong
+	 */
+	int ( * restart_subsong ) ( openmpt_module_ext * mod_ext, int32_t subsong );
+
+} openmpt_module_ext_interface_restart;
+
+
+
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_QUEUED_PARAMS
+#define LIBOPENMPT_EXT_C_INTERFACE_QUEUED_PARAMS "queued_params"
+#endif
+
+typedef struct openmpt_module_ext_interface_queued_params {
+
+	/*! Change a render parameter from any thread
+	 *
+	 * The change is queued and applied by the next call that renders audio, before any audio of that call is rendered. Posting never blocks and may happen while another thread is rendering.
+	 * \param mod_ext The module handle to work on.
+	 * \param param Parameter to set. See OPENMPT_MODULE_RENDER_*.
+	 * \param value The value to set param to.
+	 * \return 1 on success, 0 if param is unknown. Invalid values are only detected when the change is applied and are then logged and ignored.
+	 * \remarks Changes are applied in the order they have been queued.
+	 * \sa openmpt_module_set_render_param
+	 */
+	int ( * queue_render_param ) ( openmpt_module_ext * mod_ext, int param, int32_t value );
+
+	/*! Set a ctl from any thread
+	 *
+	 * The change is queued and applied by the next call that renders audio, before any audio of that call is rendered. Posting never blocks and may happen while another thread is rendering.
+	 * \param mod_ext The module handle to work on.
+	 * \param ctl The ctl key whose value should be set.
+	 * \param value The value that should be set, in the text form accepted by openmpt_module_ctl_set_text.
+	 * \return 1 on success, 0 if the ctl key is unknown. Invalid values are only detected when the change is applied and are then logged and ignored.
+	 * \remarks Changes are applied in the order they have been queued.
+	 * \sa openmpt_module_ctl_set_text
+	 */
+	int ( * queue_ctl ) ( openmpt_module_ext * mod_ext, const char * ctl, const char * value );
+
+} openmpt_module_ext_interface_queued_params;
+
+
+
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_STATE_HISTORY
+#define LIBOPENMPT_EXT_C_INTERFACE_STATE_HISTORY "state_history"
+#endif
+
+/*! Playback state at the start of a tick */
+typedef struct openmpt_module_ext_playback_state {
+	/*! Number of frames rendered since loading the module when the tick started */
+	uint64_t timestamp;
+	int32_t order;
+	int32_t pattern;
+	int32_t row;
+	int32_t speed;
+	double tempo;
+} openmpt_module_ext_playback_state;
+
+/*! State of a single channel at the start of a tick */
+typedef struct openmpt_module_ext_playback_state_channel {
+	/*! Left and right VU meter in range [0,128] */
+	uint8_t vu_left;
+	uint8_t vu_right;
+	/*! Playing note, 0 if none */
+	uint8_t note;
+	/*! Last instrument (or sample) number used on the channel, 0 if none */
+	uint8_t instrument;
+} openmpt_module_ext_playback_state_channel;
+
+typedef struct openmpt_module_ext_interface_state_history {
+
+	/*! Get the number of frames rendered since loading the module
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \return The time base of openmpt_module_ext_playback_state::timestamp. Can be called from any thread.
+	 */
+	uint64_t ( * get_rendered_frames ) ( openmpt_module_ext * mod_ext );
+
+	/*! Get the playback state at a given time
+	 *
+	 * Looks up the latest tick that started at or before timestamp in the snapshots recorded while rendering. Recording has to be enabled with the ctl render.state_history. Can be called from any thread, also while another thread is rendering, and never blocks.
+	 * \param mod_ext The module handle to work on.
+	 * \param timestamp Frame position as returned by get_rendered_frames. To get the audible state, subtract the number of frames that have been rendered but not played yet.
+	 * \param state Receives the global playback state.
+	 * \param channels Array of num_channels entries that receives the state of the first num_channels channels.
+	 * \param num_channels Number of entries in channels.
+	 * \return Number of channels written, or -1 if no snapshot is available for timestamp (recording disabled, nothing rendered yet or the snapshot has already been overwritten).
+	 */
+	int32_t ( * get_state_at ) ( openmpt_module_ext * mod_ext, uint64_t timestamp, openmpt_module_ext_playback_state * state, openmpt_module_ext_playback_state_channel * channels, int32_t num_channels );
+
+} openmpt_module_ext_interface_state_history;
+
+
+
 /* add stuff here */
 
 
@@ -410,6 +410,144 @@ class interactive3 {
 }; // class interactive3
 
 
+#ifndef LIBOPENMPT_EXT_INTERFACE_CHANNEL_OUTPUT
+#define LIBOPENMPT_EXT_INTERFACE_CHANNEL_OUTPUT
+#endif
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(channel_output)
+
+class channel_output {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(channel_output)
+
+	//! Render audio data along with the output of each individual channel
+	/*!
+	  Renders the stereo mix like openmpt::module::read_interleaved_stereo and, in the same pass, the dry contribution of each pattern channel. Voices that are playing in the background because of New Note Actions are added to the channel that triggered them.
+	  \param samplerate Sample rate to render output. Should be in [8000,192000], but this is not enforced.
+	  \param count Number of audio frames to render per channel.
+	  \param interleaved_stereo Pointer to a buffer of at least count*2 floats that will receive the interleaved stereo mix.
+	  \param num_channels Number of channels to output. Usually this is openmpt::module::get_num_channels().
+	  \param channel_buffers Array of num_channels*2 pointers to buffers of at least count floats each. channel_buffers[2*n] receives the left and channel_buffers[2*n+1] the right output of channel n. Null pointers are skipped. Channels that do not exist in the module are filled with silence.
+	  \return The number of frames actually rendered.
+	  \retval 0 The end of song has been reached.
+	  \remarks The channel output is taken before global volume, global DSP effects, plugins and stereo separation are applied. It also lacks the short fade-out that the stereo mix applies to voices that stopped abruptly, to avoid clicks. Hence it does not necessarily add up to the stereo mix.
+	  \sa openmpt::module::read_interleaved_stereo
+	*/
+	virtual std::size_t read_interleaved_stereo_channels( std::int32_t samplerate, std::size_t count, float * interleaved_stereo, std::int32_t num_channels, float * const * channel_buffers ) = 0;
+
+}; // class channel_output
+
+
+#ifndef LIBOPENMPT_EXT_INTERFACE_RESTART
+#define LIBOPENMPT_EXT_INTERFACE_RESTART
+#endif
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(restart)
+
+class restart {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(restart)
+
+	//! Restart playback of an already loaded module
+	/*!
+	  Resets the playback and mixer state to what it was right after loading the module and selects a sub-song. Rendering afterwards produces the same output as a freshly loaded module would, which allows reusing a loaded module instead of loading it again.
+	  \param subsong Index of the sub-song. -1 plays all sub-songs consecutively.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if sub-song is not in range [-1,openmpt::module::get_num_subsongs()[
+	  \remarks Render parameters and ctls keep their current values.
+	  \sa openmpt::module::select_subsong
+	*/
+	virtual void restart_subsong( std::int32_t subsong ) = 0;
+
+}; // class restart
+
+
+#ifndef LIBOPENMPT_EXT_INTERFACE_QUEUED_PARAMS
+#define LIBOPENMPT_EXT_INTERFACE_QUEUED_PARAMS
+#endif
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(queued_params)
+
+class queued_params {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(queued_params)
+
+	//! Change a render parameter from any thread
+	/*!
+	  The change is queued and applied by the next call that renders audio, before any audio of that call is rendered. Posting never blocks and may happen while another thread is rendering.
+	  \param param Parameter to set. See openmpt::module::render_param.
+	  \param value The value to set param to.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if param is unknown. Invalid values are only detected when the change is applied and are then logged and ignored.
+	  \remarks Changes are applied in the order they have been queued.
+	  \sa openmpt::module::set_render_param
+	*/
+	virtual void queue_render_param( int param, std::int32_t value ) = 0;
+
+	//! Set a ctl from any thread
+	/*!
+	  The change is queued and applied by the next call that renders audio, before any audio of that call is rendered. Posting never blocks and may happen while another thread is rendering.
+	  \param ctl The ctl key whose value should be set.
+	  \param value The value that should be set, in the text form accepted by openmpt::module::ctl_set_text.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the ctl key is unknown. Invalid values are only detected when the change is applied and are then logged and ignored.
+	  \remarks Changes are applied in the order they have been queued.
+	  \sa openmpt::module::ctl_set_text
+	*/
+	virtual void queue_ctl( std::string_view ctl, const std::string & value ) = 0;
+
+}; // class queued_params
+
+
+#ifndef LIBOPENMPT_EXT_INTERFACE_STATE_HISTORY
+#define LIBOPENMPT_EXT_INTERFACE_STATE_HISTORY
+#endif
+
+//! Playback state at the start of a tick
+struct playback_state {
+	//! Number of frames rendered since loading the module when the tick started
+	std::uint64_t timestamp;
+	std::int32_t order;
+	std::int32_t pattern;
+	std::int32_t row;
+	std::int32_t speed;
+	double tempo;
+};
+
+//! State of a single channel at the start of a tick
+struct playback_state_channel {
+	//! Left and right VU meter in range [0,128]
+	std::uint8_t vu_left;
+	std::uint8_t vu_right;
+	//! Playing note, 0 if none
+	std::uint8_t note;
+	//! Last instrument (or sample) number used on the channel, 0 if none
+	std::uint8_t instrument;
+};
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(state_history)
+
+class state_history {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(state_history)
+
+	//! Get the number of frames rendered since loading the module
+	/*!
+	  \return The time base of playback_state::timestamp. Can be called from any thread.
+	*/
+	virtual std::uint64_t get_rendered_frames() = 0;
+
+	//! Get the playback state at a given time
+	/*!
+	  Looks up the latest tick that started at or before timestamp in the snapshots recorded while rendering. Recording has to be enabled with the ctl render.state_history. Can be called from any thread, also while another thread is rendering, and never blocks.
+	  \param timestamp Frame position as returned by get_rendered_frames. To get the audible state, subtract the number of frames that have been rendered but not played yet.
+	  \param state Receives the global playback state.
+	  \param channels Array of num_channels entries that receives the state of the first num_channels channels.
+	  \param num_channels Number of entries in channels.
+	  \return Number of channels written, or -1 if no snapshot is available for timestamp (recording disabled, nothing rendered yet or the snapshot has already been overwritten).
+	*/
+	virtual std::int32_t get_state_at( std::uint64_t timestamp, playback_state & state, playback_state_channel * channels, std::int32_t num_channels ) = 0;
+
+}; // class state_history
+
+
 
 /* add stuff here */
 
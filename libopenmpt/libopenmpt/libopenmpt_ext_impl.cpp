@@ -18,10 +18,16 @@
 
 #include "soundlib/Sndfile.h"
 
+#include <algorithm>
+
 // assume OPENMPT_NAMESPACE is OpenMPT
 
 namespace openmpt {
 
+	struct module_ext_impl::initial_state {
+		OpenMPT::CSoundFile::PlayState play_state;
+	};
+
 	module_ext_impl::module_ext_impl( callback_stream_wrapper stream, std::unique_ptr<log_interface> log, const std::map< std::string, std::string > & ctls ) : module_impl( stream, std::move(log), ctls ) {
 		ctor();
 	}
@@ -54,7 +60,7 @@ namespace openmpt {
 
 	void module_ext_impl::ctor() {
 
-
+		m_initial_state = std::make_unique<initial_state>( initial_state{ m_sndFile->m_PlayState } );
 
 		/* add stuff here */
 
@@ -87,6 +93,14 @@ namespace openmpt {
 			return dynamic_cast< ext::interactive2 * >( this );
 		} else if ( interface_id == ext::interactive3_id ) {
 			return dynamic_cast< ext::interactive3 * >( this );
+		} else if ( interface_id == ext::channel_output_id ) {
+			return dynamic_cast< ext::channel_output * >( this );
+		} else if ( interface_id == ext::restart_id ) {
+			return dynamic_cast< ext::restart * >( this );
+		} else if ( interface_id == ext::queued_params_id ) {
+			return dynamic_cast< ext::queued_params * >( this );
+		} else if ( interface_id == ext::state_history_id ) {
+			return dynamic_cast< ext::state_history * >( this );
 
 
 
@@ -259,7 +273,8 @@ namespace openmpt {
 			throw openmpt::exception("invalid note");
 		}
 
-		// Find a free channel
+		// Find a free channel. Voices may have stopped while being mixed since the last tick.
+		m_sndFile->m_PlayState.BackgroundVoices.InvalidateAll();
 		OpenMPT::CHANNELINDEX free_channel = m_sndFile->GetNNAChannel( OpenMPT::CHANNELINDEX_INVALID );
 		if ( free_channel == OpenMPT::CHANNELINDEX_INVALID ) {
 			free_channel = OpenMPT::MAX_CHANNELS - 1;
@@ -275,6 +290,7 @@ namespace openmpt {
 		m_sndFile->NoteChange(chn, note, false, true, true);
 		chn.nPan = mpt::saturate_round<std::int32_t>( OpenMPT::Clamp( panning * 128.0, -128.0, 128.0 ) + 128.0 );
 		chn.nVolume = mpt::saturate_round<std::int32_t>( OpenMPT::Clamp( volume * 256.0, 0.0, 256.0 ) );
+		m_sndFile->m_PlayState.BackgroundVoices.Activate( free_channel );
 
 		// Remove channel from list of mixed channels to fix https://bugs.openmpt.org/view.php?id=209
 		// This is required because a previous note on the same channel might have just stopped playing,
@@ -296,6 +312,7 @@ namespace openmpt {
 		auto & chn = m_sndFile->m_PlayState.Chn[channel];
 		chn.nLength = 0;
 		chn.pCurrentSample = nullptr;
+		m_sndFile->InvalidateBackgroundVoice( static_cast<OpenMPT::CHANNELINDEX>( channel ) );
 	}
 
 	void module_ext_impl::note_off(int32_t channel ) {
@@ -304,6 +321,7 @@ namespace openmpt {
 		}
 		auto & chn = m_sndFile->m_PlayState.Chn[channel];
 		chn.dwFlags |= OpenMPT::CHN_KEYOFF;
+		m_sndFile->InvalidateBackgroundVoice( static_cast<OpenMPT::CHANNELINDEX>( channel ) );
 	}
 
 	void module_ext_impl::note_fade(int32_t channel ) {
@@ -312,6 +330,7 @@ namespace openmpt {
 		}
 		auto & chn = m_sndFile->m_PlayState.Chn[channel];
 		chn.dwFlags |= OpenMPT::CHN_NOTEFADE;
+		m_sndFile->InvalidateBackgroundVoice( static_cast<OpenMPT::CHANNELINDEX>( channel ) );
 	}
 
 	void module_ext_impl::set_channel_panning( int32_t channel, double panning ) {
@@ -353,6 +372,88 @@ namespace openmpt {
 		m_sndFile->m_PlayState.m_nMusicTempo = decltype( m_sndFile->m_PlayState.m_nMusicTempo )( tempo );
 	}
 
+	// channel_output
+
+	std::size_t module_ext_impl::read_interleaved_stereo_channels( std::int32_t samplerate, std::size_t count, float * interleaved_stereo, std::int32_t num_channels, float * const * channel_buffers ) {
+		if ( !interleaved_stereo ) {
+			throw openmpt::exception("null pointer");
+		}
+		if ( num_channels < 0 ) {
+			throw openmpt::exception("invalid channel count");
+		}
+		if ( num_channels > 0 && !channel_buffers ) {
+			throw openmpt::exception("null pointer");
+		}
+		apply_mixer_settings( samplerate, 2 );
+		const std::size_t num_buffers = static_cast<std::size_t>( num_channels ) * 2;
+		count = read_interleaved_wrapper( count, 2, interleaved_stereo, num_buffers, channel_buffers );
+		for ( std::size_t buffer = static_cast<std::size_t>( m_sndFile->GetNumChannels() ) * 2; buffer < num_buffers; ++buffer ) {
+			if ( channel_buffers[buffer] ) {
+				std::fill( channel_buffers[buffer], channel_buffers[buffer] + count, 0.0f );
+			}
+		}
+		m_currentPositionSeconds += static_cast<double>( count ) / static_cast<double>( samplerate );
+		return count;
+	}
+
+	// restart
+
+	void module_ext_impl::restart_subsong( std::int32_t subsong ) {
+		if ( subsong != all_subsongs && ( subsong < 0 || subsong >= get_num_subsongs() ) ) {
+			throw openmpt::exception("invalid subsong");
+		}
+		m_sndFile->m_PlayState = m_initial_state->play_state;
+		m_sndFile->m_SongFlags.reset( OpenMPT::SONG_FADINGSONG | OpenMPT::SONG_ENDREACHED );
+		m_sndFile->StopAllVsti();
+		// the mixer (click removal, DSP and OPL state) is reset on the next read
+		m_mixer_initialized = false;
+		select_subsong( subsong );
+	}
+
+	// queued_params
+
+	void module_ext_impl::queue_render_param( int param, std::int32_t value ) {
+		post_render_param( param, value );
+	}
+
+	void module_ext_impl::queue_ctl( std::string_view ctl, const std::string & value ) {
+		post_ctl( ctl, value );
+	}
+
+	// state_history
+
+	std::uint64_t module_ext_impl::get_rendered_frames() {
+		return module_impl::get_rendered_frames();
+	}
+
+	std::int32_t module_ext_impl::get_state_at( std::uint64_t timestamp, ext::playback_state & state, ext::playback_state_channel * channels, std::int32_t num_channels ) {
+		if ( num_channels < 0 ) {
+			throw openmpt::exception("invalid channel count");
+		}
+		if ( num_channels > 0 && !channels ) {
+			throw openmpt::exception("null pointer");
+		}
+		// Small enough for the stack, so this never allocates
+		std::uint32_t packed[256];
+		playback_state_frame frame;
+		if ( !module_impl::get_state_at( timestamp, frame, packed, std::min( static_cast<std::size_t>( num_channels ), std::size( packed ) ) ) ) {
+			return -1;
+		}
+		state.timestamp = frame.timestamp;
+		state.order = frame.order;
+		state.pattern = frame.pattern;
+		state.row = frame.row;
+		state.speed = frame.speed;
+		state.tempo = frame.tempo;
+		for ( std::size_t i = 0; i < frame.num_channels; ++i ) {
+			channels[i].vu_left = static_cast<std::uint8_t>( packed[i] & 0xff );
+			channels[i].vu_right = static_cast<std::uint8_t>( ( packed[i] >> 8 ) & 0xff );
+			channels[i].note = static_cast<std::uint8_t>( ( packed[i] >> 16 ) & 0xff );
+			channels[i].instrument = static_cast<std::uint8_t>( packed[i] >> 24 );
+		}
+		return static_cast<std::int32_t>( frame.num_channels );
+	}
+
 	/* add stuff here */
 
 
@@ -22,6 +22,10 @@ class module_ext_impl
 	, public ext::interactive
 	, public ext::interactive2
 	, public ext::interactive3
+	, public ext::channel_output
+	, public ext::restart
+	, public ext::queued_params
+	, public ext::state_history
 
 
 
@@ -43,7 +47,9 @@ public:
 
 private:
 
-
+	// Playback state right after loading, used to restart the module
+	struct initial_state;
+	std::unique_ptr<initial_state> m_initial_state;
 
 	/* add stuff here */
 
@@ -115,6 +121,26 @@ public:
 
 	void set_current_tempo2(double tempo) override;
 
+	// channel_output
+
+	std::size_t read_interleaved_stereo_channels( std::int32_t samplerate, std::size_t count, float * interleaved_stereo, std::int32_t num_channels, float * const * channel_buffers ) override;
+
+	// restart
+
+	void restart_subsong( std::int32_t subsong ) override;
+
+	// queued_params
+
+	void queue_render_param( int param, std::int32_t value ) override;
+
+	void queue_ctl( std::string_view ctl, const std::string & value ) override;
+
+	// state_history
+
+	std::uint64_t get_rendered_frames() override;
+
+	std::int32_t get_state_at( std::uint64_t timestamp, ext::playback_state & state, ext::playback_state_channel * channels, std::int32_t num_channels ) override;
+
 	/* add stuff here */
 
 }; // class module_ext_impl
@@ -15,6 +15,7 @@
 #include "libopenmpt_impl.hpp"
 
 #include <algorithm>
+#include <exception>
 #include <iostream>
 #include <istream>
 #include <iterator>
@@ -428,26 +429,342 @@ void module_impl::apply_libopenmpt_defaults() {
 	set_render_param( module::RENDER_STEREOSEPARATION_PERCENT, 100 );
 	m_sndFile->Order.SetSequence( 0 );
 }
-module_impl::subsongs_type module_impl::get_subsongs() const {
+struct module_impl::seek_index {
+	// Checkpoints are only valid for the timing settings and the seek mode they were recorded with
+	std::uint32_t mixing_freq;
+	std::uint32_t tempo_factor;
+	std::uint32_t freq_factor;
+	bool sync_samples;
+	std::vector<OpenMPT::SeekCheckpoint> checkpoints;
+	seek_index( const OpenMPT::CSoundFile & sndFile, bool sync_samples )
+		: mixing_freq(sndFile.m_MixerSettings.gdwMixingFreq)
+		, tempo_factor(sndFile.m_nTempoFactor)
+		, freq_factor(sndFile.m_nFreqFactor)
+		, sync_samples(sync_samples)
+	{
+		return;
+	}
+	bool matches( const OpenMPT::CSoundFile & sndFile, bool sync_samples ) const {
+		return mixing_freq == sndFile.m_MixerSettings.gdwMixingFreq && tempo_factor == sndFile.m_nTempoFactor && freq_factor == sndFile.m_nFreqFactor && this->sync_samples == sync_samples;
+	}
+}; // struct seek_index
+
+module_impl::subsongs_type module_impl::get_subsongs( std::vector<OpenMPT::SeekCheckpoint> * checkpoints ) const {
 	std::vector<subsong_data> subsongs;
 	if ( m_sndFile->Order.GetNumSequences() == 0 ) {
 		throw openmpt::exception("module contains no songs");
 	}
 	for ( OpenMPT::SEQUENCEINDEX seq = 0; seq < m_sndFile->Order.GetNumSequences(); ++seq ) {
-		const std::vector<OpenMPT::GetLengthType> lengths = m_sndFile->GetLength( OpenMPT::eNoAdjust, OpenMPT::GetLengthTarget( true ).StartPos( seq, 0, 0 ) );
+		OpenMPT::GetLengthTarget target = OpenMPT::GetLengthTarget( true ).StartPos( seq, 0, 0 );
+		if ( checkpoints ) {
+			target.RecordCheckpoints( *checkpoints, m_ctl_seek_checkpoint_interval, m_ctl_seek_sync_samples );
+		}
+		const std::vector<OpenMPT::GetLengthType> lengths = m_sndFile->GetLength( OpenMPT::eNoAdjust, target );
 		for ( const auto & l : lengths ) {
 			subsongs.push_back( subsong_data( l.duration, l.startRow, l.startOrder, seq ) );
 		}
 	}
 	return subsongs;
 }
+std::string module_impl::format_subsongs( const subsongs_type & subsongs ) {
+	std::string result;
+	for ( const auto & subsong : subsongs ) {
+		if ( !result.empty() ) {
+			result += ";";
+		}
+		result += mpt::format_value_default<std::string>( subsong.sequence );
+		result += ",";
+		result += mpt::format_value_default<std::string>( subsong.start_order );
+		result += ",";
+		result += mpt::format_value_default<std::string>( subsong.start_row );
+		result += ",";
+		result += mpt::format_value_default<std::string>( subsong.duration );
+	}
+	return result;
+}
+module_impl::subsongs_type module_impl::parse_subsongs( std::string_view text ) {
+	subsongs_type subsongs;
+	while ( !text.empty() ) {
+		std::string_view entry = text.substr( 0, text.find( ';' ) );
+		text.remove_prefix( std::min( entry.length() + 1, text.length() ) );
+		std::string_view fields[4];
+		std::size_t num_fields = 0;
+		while ( num_fields < std::size( fields ) ) {
+			const std::size_t separator = entry.find( ',' );
+			fields[num_fields++] = entry.substr( 0, separator );
+			if ( separator == std::string_view::npos ) {
+				entry = std::string_view();
+				break;
+			}
+			entry.remove_prefix( separator + 1 );
+		}
+		if ( num_fields != std::size( fields ) || !entry.empty() ) {
+			throw openmpt::exception("invalid subsong data");
+		}
+		const double duration = mpt::parse<double>( std::string( fields[3] ) );
+		if ( !( duration >= 0.0 ) ) {
+			throw openmpt::exception("invalid subsong duration");
+		}
+		subsongs.push_back( subsong_data( duration, mpt::parse<std::int32_t>( std::string( fields[2] ) ), mpt::parse<std::int32_t>( std::string( fields[1] ) ), mpt::parse<std::int32_t>( std::string( fields[0] ) ) ) );
+	}
+	return subsongs;
+}
+bool module_impl::are_subsongs_valid( const subsongs_type & subsongs ) const {
+	if ( subsongs.empty() ) {
+		return false;
+	}
+	for ( const auto & subsong : subsongs ) {
+		if ( subsong.sequence < 0 || subsong.sequence >= m_sndFile->Order.GetNumSequences() ) {
+			return false;
+		}
+		const OpenMPT::ModSequence & order = m_sndFile->Order( static_cast<OpenMPT::SEQUENCEINDEX>( subsong.sequence ) );
+		if ( subsong.start_order < 0 || subsong.start_order >= order.GetLengthTailTrimmed() ) {
+			return false;
+		}
+		if ( subsong.start_row < 0 ) {
+			return false;
+		}
+	}
+	return true;
+}
 void module_impl::init_subsongs( subsongs_type & subsongs ) const {
 	subsongs = get_subsongs();
 }
 bool module_impl::has_subsongs_inited() const {
 	return !m_subsongs.empty();
 }
+void module_impl::init_seek_index() {
+	// Recording the checkpoints requires an additional full pass through the module with complete channel state, so this is only done once seeking is actually used.
+	std::unique_ptr<seek_index> index = std::make_unique<seek_index>( *m_sndFile, m_ctl_seek_sync_samples );
+	get_subsongs( &index->checkpoints );
+	m_seek_index = std::move( index );
+}
+const OpenMPT::SeekCheckpoint * module_impl::find_seek_checkpoint( const subsong_data & subsong, double seconds ) {
+	if ( m_ctl_seek_checkpoint_interval <= 0.0 || seconds < m_ctl_seek_checkpoint_interval ) {
+		// There cannot be a checkpoint before the target position
+		return nullptr;
+	}
+	if ( !m_seek_index || !m_seek_index->matches( *m_sndFile, m_ctl_seek_sync_samples ) ) {
+		init_seek_index();
+	}
+	const OpenMPT::SeekCheckpoint * result = nullptr;
+	for ( const auto & checkpoint : m_seek_index->checkpoints ) {
+		if ( checkpoint.sequence != subsong.sequence || checkpoint.subsongStartOrder != subsong.start_order || checkpoint.subsongStartRow != static_cast<OpenMPT::ROWINDEX>( subsong.start_row ) ) {
+			continue;
+		}
+		if ( checkpoint.elapsedTime > seconds ) {
+			// Checkpoints of a subsong are recorded in chronological order
+			break;
+		}
+		result = &checkpoint;
+	}
+	return result;
+}
+struct module_impl::queued_command {
+	queued_command * next = nullptr;
+	bool is_render_param = false;
+	int render_param = 0;
+	std::int32_t render_param_value = 0;
+	std::string ctl;
+	std::string ctl_value;
+	// Set by the rendering thread if applying the command failed
+	std::exception_ptr error;
+};
+void module_impl::post_command( std::unique_ptr<queued_command> command ) {
+	release_done_commands();
+	queued_command * head = m_queued_commands.load( std::memory_order_relaxed );
+	do {
+		command->next = head;
+	} while ( !m_queued_commands.compare_exchange_weak( head, command.get(), std::memory_order_release, std::memory_order_relaxed ) );
+	command.release();
+}
+void module_impl::post_render_param( int param, std::int32_t value ) {
+	switch ( param ) {
+		case module::RENDER_MASTERGAIN_MILLIBEL:
+		case module::RENDER_STEREOSEPARATION_PERCENT:
+		case module::RENDER_INTERPOLATIONFILTER_LENGTH:
+		case module::RENDER_VOLUMERAMPING_STRENGTH:
+			break;
+		default: throw openmpt::exception("unknown render param"); break;
+	}
+	std::unique_ptr<queued_command> command = std::make_unique<queued_command>();
+	command->is_render_param = true;
+	command->render_param = param;
+	command->render_param_value = value;
+	post_command( std::move( command ) );
+}
+void module_impl::post_ctl( std::string_view ctl, const std::string & value ) {
+	auto found_ctl = std::find_if(get_ctl_infos().first, get_ctl_infos().second, [&](const ctl_info & info) -> bool { return info.name == ctl; });
+	if ( found_ctl == get_ctl_infos().second ) {
+		throw openmpt::exception("unknown ctl: " + std::string( ctl ));
+	}
+	std::unique_ptr<queued_command> command = std::make_unique<queued_command>();
+	command->ctl = std::string( ctl );
+	command->ctl_value = value;
+	post_command( std::move( command ) );
+}
+void module_impl::apply_queued_commands() {
+	// Taking the whole list never waits for posting threads
+	queued_command * head = m_queued_commands.exchange( nullptr, std::memory_order_acquire );
+	if ( !head ) {
+		return;
+	}
+	// Commands are applied in the order they have been posted
+	queued_command * reversed = nullptr;
+	while ( head ) {
+		queued_command * next = head->next;
+		head->next = reversed;
+		reversed = head;
+		head = next;
+	}
+	queued_command * last = reversed;
+	for ( queued_command * command = reversed; command; command = command->next ) {
+		try {
+			if ( command->is_render_param ) {
+				set_render_param( command->render_param, command->render_param_value );
+			} else {
+				ctl_set( command->ctl, command->ctl_value, true );
+			}
+		} catch ( const std::exception & ) {
+			command->error = std::current_exception();
+		}
+		last = command;
+	}
+	// Applied commands are freed and their errors are logged by the posting side, see release_done_commands()
+	queued_command * done = m_done_commands.load( std::memory_order_relaxed );
+	do {
+		last->next = done;
+	} while ( !m_done_commands.compare_exchange_weak( done, reversed, std::memory_order_release, std::memory_order_relaxed ) );
+}
+void module_impl::release_done_commands() {
+	queued_command * head = m_done_commands.exchange( nullptr, std::memory_order_acquire );
+	while ( head ) {
+		std::unique_ptr<queued_command> command( head );
+		head = command->next;
+		if ( command->error ) {
+			try {
+				std::rethrow_exception( command->error );
+			} catch ( const std::exception & e ) {
+				PushToCSoundFileLog( std::string( "ignoring queued command: " ) + e.what() );
+			}
+		}
+	}
+}
+// Ring of playback state snapshots taken at every tick. Written by the rendering thread, can be read from any thread.
+// Each slot is guarded by a sequence number that is odd while the slot is being written.
+struct module_impl::state_history : public OpenMPT::ITickObserver {
+	struct slot {
+		std::atomic<std::uint64_t> sequence{0};
+		std::atomic<std::uint64_t> timestamp{0};
+		// order << 48 | pattern << 32 | row
+		std::atomic<std::uint64_t> position{0};
+		// raw tempo << 32 | speed
+		std::atomic<std::uint64_t> timing{0};
+	};
+	const std::atomic<std::uint64_t> & rendered_frames;
+	const std::size_t capacity;
+	const std::size_t num_channels;
+	std::unique_ptr<slot[]> slots;
+	// vu_left | vu_right << 8 | note << 16 | instrument << 24 for each channel of each slot
+	std::unique_ptr<std::atomic<std::uint32_t>[]> channels;
+	std::atomic<std::uint64_t> written{0};
+	state_history( const std::atomic<std::uint64_t> & rendered_frames, std::size_t capacity, std::size_t num_channels )
+		: rendered_frames(rendered_frames)
+		, capacity(capacity)
+		, num_channels(num_channels)
+		, slots(std::make_unique<slot[]>( capacity ))
+		, channels(std::make_unique<std::atomic<std::uint32_t>[]>( capacity * num_channels ))
+	{
+		for ( std::size_t i = 0; i < capacity * num_channels; ++i ) {
+			channels[i].store( 0, std::memory_order_relaxed );
+		}
+	}
+	void OnTick( const OpenMPT::CSoundFile & sndFile, OpenMPT::uint32 offset ) override {
+		const std::uint64_t index = written.load( std::memory_order_relaxed );
+		slot & s = slots[index % capacity];
+		const std::uint64_t sequence = s.sequence.load( std::memory_order_relaxed );
+		s.sequence.store( sequence + 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+		const auto & state = sndFile.m_PlayState;
+		s.timestamp.store( rendered_frames.load( std::memory_order_relaxed ) + offset, std::memory_order_relaxed );
+		s.position.store( ( static_cast<std::uint64_t>( state.m_nCurrentOrder ) << 48 ) | ( static_cast<std::uint64_t>( state.m_nPattern ) << 32 ) | state.m_nRow, std::memory_order_relaxed );
+		s.timing.store( ( static_cast<std::uint64_t>( state.m_nMusicTempo.GetRaw() ) << 32 ) | state.m_nMusicSpeed, std::memory_order_relaxed );
+		std::atomic<std::uint32_t> * slot_channels = &channels[( index % capacity ) * num_channels];
+		const std::size_t count = std::min( num_channels, static_cast<std::size_t>( sndFile.GetNumChannels() ) );
+		for ( std::size_t i = 0; i < count; ++i ) {
+			const OpenMPT::ModChannel & chn = state.Chn[i];
+			slot_channels[i].store( chn.nLeftVU | ( chn.nRightVU << 8 ) | ( chn.nNote << 16 ) | ( static_cast<std::uint32_t>( chn.nOldIns ) << 24 ), std::memory_order_relaxed );
+		}
+		s.sequence.store( sequence + 2, std::memory_order_release );
+		written.store( index + 1, std::memory_order_release );
+	}
+	// Reads the slot for index. Fails if the slot is being written or has been overwritten since.
+	bool read( std::uint64_t index, std::uint64_t & timestamp, std::uint64_t & position, std::uint64_t & timing, std::uint32_t * channels_out, std::size_t count ) const {
+		const slot & s = slots[index % capacity];
+		const std::uint64_t sequence = s.sequence.load( std::memory_order_acquire );
+		if ( sequence & 1 ) {
+			return false;
+		}
+		timestamp = s.timestamp.load( std::memory_order_relaxed );
+		position = s.position.load( std::memory_order_relaxed );
+		timing = s.timing.load( std::memory_order_relaxed );
+		const std::atomic<std::uint32_t> * slot_channels = &channels[( index % capacity ) * num_channels];
+		for ( std::size_t i = 0; i < count; ++i ) {
+			channels_out[i] = slot_channels[i].load( std::memory_order_relaxed );
+		}
+		std::atomic_thread_fence( std::memory_order_acquire );
+		return s.sequence.load( std::memory_order_relaxed ) == sequence && index + capacity >= written.load( std::memory_order_acquire ) + 1;
+	}
+};
+std::int32_t module_impl::get_state_history_size() const {
+	return m_state_history ? static_cast<std::int32_t>( m_state_history->capacity ) : 0;
+}
+void module_impl::set_state_history_size( std::int64_t size ) {
+	if ( size < 0 || size > 65536 ) {
+		throw openmpt::exception("invalid state history size");
+	}
+	m_sndFile->m_tickObserver = nullptr;
+	m_state_history.reset();
+	if ( size > 0 ) {
+		m_state_history = std::make_unique<state_history>( m_rendered_frames, static_cast<std::size_t>( size ), m_sndFile->GetNumChannels() );
+		m_sndFile->m_tickObserver = m_state_history.get();
+	}
+}
+bool module_impl::get_state_at( std::uint64_t timestamp, playback_state_frame & frame, std::uint32_t * channels, std::size_t num_channels ) const {
+	const state_history * history = m_state_history.get();
+	if ( !history ) {
+		return false;
+	}
+	num_channels = std::min( num_channels, history->num_channels );
+	const std::uint64_t written = history->written.load( std::memory_order_acquire );
+	const std::uint64_t oldest = written > history->capacity ? written - history->capacity : 0;
+	// Newest snapshot that is not later than timestamp
+	for ( std::uint64_t index = written; index > oldest; --index ) {
+		std::uint64_t frame_timestamp = 0, position = 0, timing = 0;
+		if ( !history->read( index - 1, frame_timestamp, position, timing, channels, num_channels ) ) {
+			// The writer has caught up with us, everything older is gone as well
+			return false;
+		}
+		if ( frame_timestamp <= timestamp ) {
+			frame.timestamp = frame_timestamp;
+			frame.order = static_cast<std::int32_t>( position >> 48 );
+			frame.pattern = static_cast<std::int32_t>( ( position >> 32 ) & 0xffff );
+			frame.row = static_cast<std::int32_t>( position & 0xffffffff );
+			frame.speed = static_cast<std::int32_t>( timing & 0xffffffff );
+			frame.tempo = OpenMPT::TEMPO().SetRaw( static_cast<OpenMPT::uint32>( timing >> 32 ) ).ToDouble();
+			frame.num_channels = num_channels;
+			return true;
+		}
+	}
+	return false;
+}
+std::uint64_t module_impl::get_rendered_frames() const {
+	return m_rendered_frames.load( std::memory_order_acquire );
+}
 void module_impl::ctor( const std::map< std::string, std::string > & ctls ) {
+	m_queued_commands = nullptr;
+	m_done_commands = nullptr;
+	m_rendered_frames = 0;
 	m_sndFile = std::make_unique<OpenMPT::CSoundFile>();
 	m_loaded = false;
 	m_mixer_initialized = false;
@@ -463,6 +780,7 @@ void module_impl::ctor( const std::map< std::string, std::string > & ctls ) {
 	m_ctl_load_skip_plugins = false;
 	m_ctl_load_skip_subsongs_init = false;
 	m_ctl_seek_sync_samples = true;
+	m_ctl_seek_checkpoint_interval = 5.0;
 	// init member variables that correspond to ctls
 	for ( const auto & ctl : ctls ) {
 		ctl_set( ctl.first, ctl.second, false );
@@ -485,7 +803,10 @@ void module_impl::load( const OpenMPT::FileCursor & file, const std::map< std::s
 		if ( !m_sndFile->Create( file, static_cast<OpenMPT::CSoundFile::ModLoadingFlags>( load_flags ) ) ) {
 			throw openmpt::exception("error loading file");
 		}
-		if ( !m_ctl_load_skip_subsongs_init ) {
+		if ( !m_ctl_load_subsongs.empty() && are_subsongs_valid( m_ctl_load_subsongs ) ) {
+			// Subsongs have been provided by the caller (e.g. from a cache)
+			m_subsongs = m_ctl_load_subsongs;
+		} else if ( !m_ctl_load_skip_subsongs_init ) {
 			init_subsongs( m_subsongs );
 		}
 		m_loaded = true;
@@ -505,6 +826,7 @@ bool module_impl::is_loaded() const {
 	return m_loaded;
 }
 std::size_t module_impl::read_wrapper( std::size_t count, std::int16_t * left, std::int16_t * right, std::int16_t * rear_left, std::int16_t * rear_right ) {
+	apply_queued_commands();
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
 	std::size_t count_read = 0;
@@ -520,6 +842,7 @@ std::size_t module_impl::read_wrapper( std::size_t count, std::int16_t * left, s
 		}
 		count -= count_chunk;
 		count_read += count_chunk;
+		m_rendered_frames.store( m_rendered_frames.load( std::memory_order_relaxed ) + count_chunk, std::memory_order_release );
 	}
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
@@ -528,6 +851,7 @@ std::size_t module_impl::read_wrapper( std::size_t count, std::int16_t * left, s
 	return count_read;
 }
 std::size_t module_impl::read_wrapper( std::size_t count, float * left, float * right, float * rear_left, float * rear_right ) {
+	apply_queued_commands();
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
 	std::size_t count_read = 0;
@@ -543,6 +867,7 @@ std::size_t module_impl::read_wrapper( std::size_t count, float * left, float *
 		}
 		count -= count_chunk;
 		count_read += count_chunk;
+		m_rendered_frames.store( m_rendered_frames.load( std::memory_order_relaxed ) + count_chunk, std::memory_order_release );
 	}
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
@@ -551,6 +876,7 @@ std::size_t module_impl::read_wrapper( std::size_t count, float * left, float *
 	return count_read;
 }
 std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_t channels, std::int16_t * interleaved ) {
+	apply_queued_commands();
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
 	std::size_t count_read = 0;
@@ -565,6 +891,7 @@ std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_
 		}
 		count -= count_chunk;
 		count_read += count_chunk;
+		m_rendered_frames.store( m_rendered_frames.load( std::memory_order_relaxed ) + count_chunk, std::memory_order_release );
 	}
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
@@ -573,6 +900,7 @@ std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_
 	return count_read;
 }
 std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_t channels, float * interleaved ) {
+	apply_queued_commands();
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
 	std::size_t count_read = 0;
@@ -587,6 +915,37 @@ std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_
 		}
 		count -= count_chunk;
 		count_read += count_chunk;
+		m_rendered_frames.store( m_rendered_frames.load( std::memory_order_relaxed ) + count_chunk, std::memory_order_release );
+	}
+	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
+		// This is the song end, but allow the song or loop to restart on the next call
+		m_sndFile->m_SongFlags.reset(OpenMPT::SONG_ENDREACHED);
+	}
+	return count_read;
+}
+std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_t channels, float * interleaved, std::size_t num_channel_buffers, float * const * channel_buffers ) {
+	apply_queued_commands();
+	m_sndFile->ResetMixStat();
+	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	std::size_t count_read = 0;
+	OpenMPT::AudioTargetBufferWithGain<mpt::audio_span_interleaved<float>> target( mpt::audio_span_interleaved<float>( interleaved, channels, count ), *m_Dithers, m_Gain );
+	OpenMPT::AudioChannelTargetBufferFloat channel_target( channel_buffers, num_channel_buffers, m_Gain );
+	OpenMPT::AudioSourceNone source;
+	while ( count > 0 ) {
+		std::size_t count_chunk = m_sndFile->Read(
+			static_cast<OpenMPT::CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( count ), static_cast<std::uint64_t>( std::numeric_limits<OpenMPT::CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			target,
+			source,
+			std::nullopt,
+			std::nullopt,
+			std::ref( channel_target )
+			);
+		if ( count_chunk == 0 ) {
+			break;
+		}
+		count -= count_chunk;
+		count_read += count_chunk;
+		m_rendered_frames.store( m_rendered_frames.load( std::memory_order_relaxed ) + count_chunk, std::memory_order_release );
 	}
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
@@ -916,6 +1275,12 @@ module_impl::module_impl( const void * data, std::size_t size, std::unique_ptr<l
 }
 module_impl::~module_impl() {
 	m_sndFile->Destroy();
+	queued_command * head = m_queued_commands.exchange( nullptr );
+	while ( head ) {
+		std::unique_ptr<queued_command> command( head );
+		head = command->next;
+	}
+	release_done_commands();
 }
 
 std::int32_t module_impl::get_render_param( int param ) const {
@@ -1121,8 +1486,14 @@ double module_impl::set_position_seconds( double seconds ) {
 	} else {
 		subsong = &subsongs[m_current_subsong];
 	}
+	OpenMPT::GetLengthTarget target = OpenMPT::GetLengthTarget( seconds ).StartPos( static_cast<OpenMPT::SEQUENCEINDEX>( subsong->sequence ), static_cast<OpenMPT::ORDERINDEX>( subsong->start_order ), static_cast<OpenMPT::ROWINDEX>( subsong->start_row ) );
+	// Checkpoints recorded on demand start out from the same state as seeking from the subsong start
 	m_sndFile->SetCurrentOrder( static_cast<OpenMPT::ORDERINDEX>( subsong->start_order ) );
-	OpenMPT::GetLengthType t = m_sndFile->GetLength( m_ctl_seek_sync_samples ? OpenMPT::eAdjustSamplePositions : OpenMPT::eAdjust, OpenMPT::GetLengthTarget( seconds ).StartPos( static_cast<OpenMPT::SEQUENCEINDEX>( subsong->sequence ), static_cast<OpenMPT::ORDERINDEX>( subsong->start_order ), static_cast<OpenMPT::ROWINDEX>( subsong->start_row ) ) ).back();
+	if ( const OpenMPT::SeekCheckpoint * checkpoint = find_seek_checkpoint( *subsong, seconds ) ) {
+		// Only fast-forward from the closest checkpoint instead of from the subsong start
+		target.StartFrom( *checkpoint );
+	}
+	OpenMPT::GetLengthType t = m_sndFile->GetLength( m_ctl_seek_sync_samples ? OpenMPT::eAdjustSamplePositions : OpenMPT::eAdjust, target ).back();
 	m_sndFile->m_PlayState.m_nNextOrder = m_sndFile->m_PlayState.m_nCurrentOrder = t.targetReached ? t.lastOrder : t.endOrder;
 	m_sndFile->m_PlayState.m_nNextRow = t.targetReached ? t.lastRow : t.endRow;
 	m_sndFile->m_PlayState.m_nTickCount = OpenMPT::CSoundFile::TICKS_ROW_FINISHED;
@@ -1640,14 +2011,22 @@ std::pair<const module_impl::ctl_info *, const module_impl::ctl_info *> module_i
 		{ "load.skip_patterns", ctl_type::boolean },
 		{ "load.skip_plugins", ctl_type::boolean },
 		{ "load.skip_subsongs_init", ctl_type::boolean },
+		{ "load.subsongs", ctl_type::text },
 		{ "seek.sync_samples", ctl_type::boolean },
+		{ "seek.checkpoint_interval", ctl_type::floatingpoint },
 		{ "subsong", ctl_type::integer },
 		{ "play.tempo_factor", ctl_type::floatingpoint },
 		{ "play.pitch_factor", ctl_type::floatingpoint },
 		{ "play.at_end", ctl_type::text },
 		{ "render.resampler.emulate_amiga", ctl_type::boolean },
 		{ "render.resampler.emulate_amiga_type", ctl_type::text },
+		{ "render.resampler.sample_pyramids", ctl_type::boolean },
 		{ "render.opl.volume_factor", ctl_type::floatingpoint },
+		{ "render.mixer.float", ctl_type::boolean },
+		{ "render.mixer.threads", ctl_type::integer },
+		{ "render.mixer.threads.min_voices", ctl_type::integer },
+		{ "render.mixer.block_size", ctl_type::integer },
+		{ "render.state_history", ctl_type::integer },
 		{ "dither", ctl_type::integer }
 	};
 	return std::make_pair(std::begin(ctl_infos), std::end(ctl_infos));
@@ -1745,6 +2124,10 @@ bool module_impl::ctl_get_boolean( std::string_view ctl, bool throw_if_unknown )
 		return m_ctl_seek_sync_samples;
 	} else if ( ctl == "render.resampler.emulate_amiga" ) {
 		return ( m_sndFile->m_Resampler.m_Settings.emulateAmiga != OpenMPT::Resampling::AmigaFilter::Off );
+	} else if ( ctl == "render.resampler.sample_pyramids" ) {
+		return m_sndFile->m_Resampler.m_Settings.samplePyramids;
+	} else if ( ctl == "render.mixer.float" ) {
+		return ( m_sndFile->m_MixerSettings.MixerFlags & SNDMIX_FLOATMIX ) != 0;
 	} else {
 		MPT_ASSERT_NOTREACHED();
 		return false;
@@ -1781,6 +2164,14 @@ std::int64_t module_impl::ctl_get_integer( std::string_view ctl, bool throw_if_u
 		throw openmpt::exception("empty ctl");
 	} else if ( ctl == "subsong" ) {
 		return get_selected_subsong();
+	} else if ( ctl == "render.mixer.threads" ) {
+		return m_sndFile->m_MixerSettings.m_nMixThreads;
+	} else if ( ctl == "render.mixer.threads.min_voices" ) {
+		return m_sndFile->m_MixerSettings.m_nMixThreadsMinVoices;
+	} else if ( ctl == "render.mixer.block_size" ) {
+		return m_sndFile->GetMixBlockSize();
+	} else if ( ctl == "render.state_history" ) {
+		return get_state_history_size();
 	} else if ( ctl == "dither" ) {
 		return static_cast<std::int64_t>( m_Dithers->GetMode() );
 	} else {
@@ -1817,6 +2208,8 @@ double module_impl::ctl_get_floatingpoint( std::string_view ctl, bool throw_if_u
 	}
 	if ( ctl == "" ) {
 		throw openmpt::exception("empty ctl");
+	} else if ( ctl == "seek.checkpoint_interval" ) {
+		return m_ctl_seek_checkpoint_interval;
 	} else if ( ctl == "play.tempo_factor" ) {
 		if ( !is_loaded() ) {
 			return 1.0;
@@ -1860,6 +2253,10 @@ std::string module_impl::ctl_get_text( std::string_view ctl, bool throw_if_unkno
 	}
 	if ( ctl == "" ) {
 		throw openmpt::exception("empty ctl");
+	} else if ( ctl == "load.subsongs" ) {
+		std::unique_ptr<subsongs_type> subsongs_temp = has_subsongs_inited() ? std::unique_ptr<subsongs_type>() : std::make_unique<subsongs_type>( get_subsongs() );
+		const subsongs_type & subsongs = has_subsongs_inited() ? m_subsongs : *subsongs_temp;
+		return format_subsongs( subsongs );
 	} else if ( ctl == "play.at_end" ) {
 		switch ( m_ctl_play_at_end )
 		{
@@ -1976,6 +2373,22 @@ void module_impl::ctl_set_boolean( std::string_view ctl, bool value, bool throw_
 		if ( newsettings != m_sndFile->m_Resampler.m_Settings ) {
 			m_sndFile->SetResamplerSettings( newsettings );
 		}
+	} else if ( ctl == "render.resampler.sample_pyramids" ) {
+		OpenMPT::CResamplerSettings newsettings = m_sndFile->m_Resampler.m_Settings;
+		newsettings.samplePyramids = value;
+		if ( newsettings != m_sndFile->m_Resampler.m_Settings ) {
+			m_sndFile->SetResamplerSettings( newsettings );
+		}
+	} else if ( ctl == "render.mixer.float" ) {
+		OpenMPT::MixerSettings newsettings = m_sndFile->m_MixerSettings;
+		if ( value ) {
+			newsettings.MixerFlags |= SNDMIX_FLOATMIX;
+		} else {
+			newsettings.MixerFlags &= ~SNDMIX_FLOATMIX;
+		}
+		if ( newsettings.MixerFlags != m_sndFile->m_MixerSettings.MixerFlags ) {
+			m_sndFile->SetMixerSettings( newsettings );
+		}
 	} else {
 		MPT_ASSERT_NOTREACHED();
 	}
@@ -2009,6 +2422,22 @@ void module_impl::ctl_set_integer( std::string_view ctl, std::int64_t value, boo
 		throw openmpt::exception("empty ctl: := " + mpt::format_value_default<std::string>( value ) );
 	} else if ( ctl == "subsong" ) {
 		select_subsong( mpt::saturate_cast<std::int32_t>( value ) );
+	} else if ( ctl == "render.mixer.threads" ) {
+		OpenMPT::MixerSettings newsettings = m_sndFile->m_MixerSettings;
+		newsettings.m_nMixThreads = std::clamp( mpt::saturate_cast<std::uint32_t>( value ), std::uint32_t( 1 ), std::uint32_t( 64 ) );
+		if ( newsettings.m_nMixThreads != m_sndFile->m_MixerSettings.m_nMixThreads ) {
+			m_sndFile->SetMixerSettings( newsettings );
+		}
+	} else if ( ctl == "render.mixer.threads.min_voices" ) {
+		m_sndFile->m_MixerSettings.m_nMixThreadsMinVoices = mpt::saturate_cast<std::uint32_t>( value );
+	} else if ( ctl == "render.mixer.block_size" ) {
+		OpenMPT::MixerSettings newsettings = m_sndFile->m_MixerSettings;
+		newsettings.m_nMixBlockSize = mpt::bit_floor( std::clamp( mpt::saturate_cast<std::uint32_t>( value ), std::uint32_t( MIXBUFFERSIZE_MIN ), std::uint32_t( MIXBUFFERSIZE_MAX ) ) );
+		if ( newsettings.m_nMixBlockSize != m_sndFile->m_MixerSettings.m_nMixBlockSize ) {
+			m_sndFile->SetMixerSettings( newsettings );
+		}
+	} else if ( ctl == "render.state_history" ) {
+		set_state_history_size( value );
 	} else if ( ctl == "dither" ) {
 		std::size_t dither = mpt::saturate_cast<std::size_t>( value );
 		if ( dither >= OpenMPT::DithersOpenMPT::GetNumDithers() ) {
@@ -2046,6 +2475,14 @@ void module_impl::ctl_set_floatingpoint( std::string_view ctl, double value, boo
 
 	if ( ctl == "" ) {
 		throw openmpt::exception("empty ctl: := " + mpt::format_value_default<std::string>( value ) );
+	} else if ( ctl == "seek.checkpoint_interval" ) {
+		if ( value < 0.0 ) {
+			throw openmpt::exception("invalid seek checkpoint interval");
+		}
+		if ( value != m_ctl_seek_checkpoint_interval ) {
+			m_ctl_seek_checkpoint_interval = value;
+			m_seek_index.reset();
+		}
 	} else if ( ctl == "play.tempo_factor" ) {
 		if ( !is_loaded() ) {
 			return;
@@ -2099,6 +2536,12 @@ void module_impl::ctl_set_text( std::string_view ctl, std::string_view value, bo
 
 	if ( ctl == "" ) {
 		throw openmpt::exception("empty ctl: := " + std::string( value ) );
+	} else if ( ctl == "load.subsongs" ) {
+		m_ctl_load_subsongs = parse_subsongs( value );
+		if ( m_loaded && !has_subsongs_inited() && are_subsongs_valid( m_ctl_load_subsongs ) ) {
+			// Sub-songs that were skipped when loading have been computed elsewhere (e.g. on another thread)
+			m_subsongs = m_ctl_load_subsongs;
+		}
 	} else if ( ctl == "play.at_end" ) {
 		if ( value == "fadeout" ) {
 			m_ctl_play_at_end = song_end_action::fadeout_song;
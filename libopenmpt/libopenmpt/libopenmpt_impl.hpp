@@ -13,6 +13,7 @@
 #include "libopenmpt_internal.h"
 #include "libopenmpt.hpp"
 
+#include <atomic>
 #include <iosfwd>
 #include <memory>
 #include <utility>
@@ -53,6 +54,7 @@ using PathString = mpt::BasicPathString<mpt::Utf8PathTraits, false>;
 } // namespace mpt
 using FileCursor = detail::FileCursor<mpt::IO::FileCursorTraitsFileData, mpt::IO::FileCursorFilenameTraits<mpt::PathString>>;
 class CSoundFile;
+struct SeekCheckpoint;
 struct DithersWrapperOpenMPT;
 } // namespace OpenMPT
 
@@ -112,6 +114,10 @@ protected:
 
 	typedef std::vector<subsong_data> subsongs_type;
 
+	struct seek_index;
+	struct queued_command;
+	struct state_history;
+
 	enum class song_end_action {
 		fadeout_song,
 		continue_song,
@@ -130,6 +136,15 @@ protected:
 		const char * name;
 		ctl_type type;
 	};
+	struct playback_state_frame {
+		std::uint64_t timestamp = 0;
+		std::int32_t order = 0;
+		std::int32_t pattern = 0;
+		std::int32_t row = 0;
+		std::int32_t speed = 0;
+		double tempo = 0.0;
+		std::size_t num_channels = 0;
+	};
 
 	std::unique_ptr<log_interface> m_Log;
 	std::unique_ptr<log_forwarder> m_LogForwarder;
@@ -147,7 +162,17 @@ protected:
 	bool m_ctl_load_skip_patterns;
 	bool m_ctl_load_skip_plugins;
 	bool m_ctl_load_skip_subsongs_init;
+	subsongs_type m_ctl_load_subsongs;
 	bool m_ctl_seek_sync_samples;
+	double m_ctl_seek_checkpoint_interval;
+	std::unique_ptr<seek_index> m_seek_index;
+	// Commands posted from other threads, most recently posted first
+	std::atomic<queued_command *> m_queued_commands;
+	// Commands already applied by the rendering thread, waiting to be freed by the posting side
+	std::atomic<queued_command *> m_done_commands;
+	// Frames rendered since loading, the time base of the state history
+	std::atomic<std::uint64_t> m_rendered_frames;
+	std::unique_ptr<state_history> m_state_history;
 	std::vector<std::string> m_loaderMessages;
 public:
 	void PushToCSoundFileLog( const std::string & text ) const;
@@ -156,9 +181,23 @@ protected:
 	std::string mod_string_to_utf8( const std::string & encoded ) const;
 	void apply_mixer_settings( std::int32_t samplerate, int channels );
 	void apply_libopenmpt_defaults();
-	subsongs_type get_subsongs() const;
+	subsongs_type get_subsongs( std::vector<OpenMPT::SeekCheckpoint> * checkpoints = nullptr ) const;
 	void init_subsongs( subsongs_type & subsongs ) const;
 	bool has_subsongs_inited() const;
+	void init_seek_index();
+	static std::string format_subsongs( const subsongs_type & subsongs );
+	static subsongs_type parse_subsongs( std::string_view text );
+	bool are_subsongs_valid( const subsongs_type & subsongs ) const;
+	const OpenMPT::SeekCheckpoint * find_seek_checkpoint( const subsong_data & subsong, double seconds );
+	void post_command( std::unique_ptr<queued_command> command );
+	void post_render_param( int param, std::int32_t value );
+	void post_ctl( std::string_view ctl, const std::string & value );
+	void apply_queued_commands();
+	void release_done_commands();
+	std::int32_t get_state_history_size() const;
+	void set_state_history_size( std::int64_t size );
+	bool get_state_at( std::uint64_t timestamp, playback_state_frame & frame, std::uint32_t * channels, std::size_t num_channels ) const;
+	std::uint64_t get_rendered_frames() const;
 	void ctor( const std::map< std::string, std::string > & ctls );
 	void load( const OpenMPT::FileCursor & file, const std::map< std::string, std::string > & ctls );
 	bool is_loaded() const;
@@ -166,6 +205,7 @@ protected:
 	std::size_t read_wrapper( std::size_t count, float * left, float * right, float * rear_left, float * rear_right );
 	std::size_t read_interleaved_wrapper( std::size_t count, std::size_t channels, std::int16_t * interleaved );
 	std::size_t read_interleaved_wrapper( std::size_t count, std::size_t channels, float * interleaved );
+	std::size_t read_interleaved_wrapper( std::size_t count, std::size_t channels, float * interleaved, std::size_t num_channel_buffers, float * const * channel_buffers );
 	std::string get_message_instruments() const;
 	std::string get_message_samples() const;
 	std::pair< std::string, std::string > format_and_highlight_pattern_row_channel_command( std::int32_t p, std::int32_t r, std::int32_t c, int command ) const;
@@ -403,7 +403,6 @@ void CReverb::Process(MixSampleInt *MixSoundBuffer, MixSampleInt *MixReverbBuffe
 		StereoFill(MixReverbBuffer, nSamples, gnRvbROfsVol, gnRvbLOfsVol);
 	}
 
-	uint32 nIn, nOut;
 	// Dynamically adjust reverb master gains
 	int32 lMasterGain;
 	lMasterGain = ((g_RefDelay.lMasterGain * m_Settings.m_nReverbDepth) >> 4);
@@ -423,6 +422,25 @@ void CReverb::Process(MixSampleInt *MixSoundBuffer, MixSampleInt *MixReverbBuffe
 	if (lDryVol < 8) lDryVol = 8;
 	if (lDryVol > 16) lDryVol = 16;
 	lDryVol = 16 - (((16-lDryVol) * lMaxRvbGain) >> 15);
+	for(uint32 offset = 0; offset < nSamples; offset += RVBMAXCHUNKSIZE)
+	{
+		ProcessChunk(MixSoundBuffer + offset * 2, MixReverbBuffer + offset * 2, lDryVol, std::min(nSamples - offset, uint32(RVBMAXCHUNKSIZE)));
+	}
+	// Automatically shut down if needed
+	if(gnReverbSend) gnReverbSamples = gnReverbDecaySamples; // reset decay counter
+	else if(gnReverbSamples > nSamples) gnReverbSamples -= nSamples; // decay
+	else // decayed
+	{
+		Shutdown(gnRvbROfsVol, gnRvbLOfsVol);
+		gnReverbSamples = 0;
+	}
+	gnReverbSend = false; // no input data in MixReverbBuffer
+}
+
+
+void CReverb::ProcessChunk(MixSampleInt *MixSoundBuffer, MixSampleInt *MixReverbBuffer, int32 lDryVol, uint32 nSamples)
+{
+	uint32 nIn, nOut;
 	ReverbDryMix(MixSoundBuffer, MixReverbBuffer, lDryVol, nSamples);
 	// Downsample 2x + 1st stage of lowpass filter
 	nIn = ReverbProcessPreFiltering1x(MixReverbBuffer, nSamples);
@@ -457,15 +475,6 @@ void CReverb::Process(MixSampleInt *MixSoundBuffer, MixSampleInt *MixReverbBuffe
 	g_RefDelay.nDelayPos = (g_RefDelay.nDelayPos - nOut + nIn) & SNDMIX_REFLECTIONS_DELAY_MASK;
 	// Upsample 2x
 	ReverbProcessPostFiltering1x(MixReverbBuffer, MixSoundBuffer, nSamples);
-	// Automatically shut down if needed
-	if(gnReverbSend) gnReverbSamples = gnReverbDecaySamples; // reset decay counter
-	else if(gnReverbSamples > nSamples) gnReverbSamples -= nSamples; // decay
-	else // decayed
-	{
-		Shutdown(gnRvbROfsVol, gnRvbLOfsVol);
-		gnReverbSamples = 0;
-	}
-	gnReverbSend = false; // no input data in MixReverbBuffer
 }
 
 
@@ -14,7 +14,7 @@
 
 #ifndef NO_REVERB
 
-#include "../soundlib/Mixer.h"	// For MIXBUFFERSIZE
+#include "../soundlib/Mixer.h"	// For MixSampleInt
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -77,6 +77,10 @@ struct SNDMIX_REVERB_PROPERTIES;
 // Min/Max reflections delay
 #define RVBMINREFDELAY		96		// 96 samples
 #define RVBMAXREFDELAY		7500	// 7500 samples
+// Maximum number of samples processed at once. Every chunk is written to the reflections delay buffer
+// before the reflections are read from it, so it must not overwrite what the longest reflection still needs.
+#define RVBMAXCHUNKSIZE		512
+static_assert(RVBMAXCHUNKSIZE + RVBMAXREFDELAY <= SNDMIX_REFLECTIONS_DELAY_MASK + 1, "Reverb chunks overwrite the reflections delay line");
 // Min/Max reverb delay
 #define RVBMINRVBDELAY		128		// 256 samples (11.6ms @ 22kHz)
 #define RVBMAXRVBDELAY		3800	// 1900 samples (86ms @ 24kHz)
@@ -173,6 +177,8 @@ public:
 
 private:
 	void Shutdown(MixSampleInt &gnRvbROfsVol, MixSampleInt &gnRvbLOfsVol);
+	// Dry/wet mix, pre-delay, reflections and late reverb for at most RVBMAXCHUNKSIZE samples
+	void ProcessChunk(MixSampleInt *MixSoundBuffer, MixSampleInt *MixReverbBuffer, int32 lDryVol, uint32 nSamples);
 	// Pre/Post resampling and filtering
 	uint32 ReverbProcessPreFiltering1x(int32 *pWet, uint32 nSamples);
 	uint32 ReverbProcessPreFiltering2x(int32 *pWet, uint32 nSamples);
@@ -18,8 +18,10 @@
 #include "openmpt/soundbase/Dither.hpp"
 #include "MixerLoops.h"
 #include "Mixer.h"
+#include "AudioReadTargetSIMD.h"
 #include "../common/Dither.h"
 
+#include <algorithm>
 #include <type_traits>
 
 
@@ -50,7 +52,10 @@ public:
 		std::visit(
 			[&](auto &ditherInstance)
 			{
-				ConvertBufferMixInternalFixedToBuffer<MixSampleIntTraits::mix_fractional_bits, false>(mpt::make_audio_span_with_offset(outputBuffer, countRendered), buffer, ditherInstance, buffer.size_channels(), buffer.size_frames());
+				if constexpr(AudioTargetSIMD::CanConvertFixed<typename Taudio_span::sample_type>)
+					ConvertFixed(buffer, ditherInstance);
+				else
+					ConvertBufferMixInternalFixedToBuffer<MixSampleIntTraits::mix_fractional_bits, false>(mpt::make_audio_span_with_offset(outputBuffer, countRendered), buffer, ditherInstance, buffer.size_channels(), buffer.size_frames());
 			},
 			dithers.Variant()
 		);
@@ -67,6 +72,40 @@ public:
 		);
 		countRendered += buffer.size_frames();
 	}
+private:
+	// Same result as ConvertBufferMixInternalFixedToBuffer, but dithers the mix buffer in-place and converts whole blocks at once
+	template <typename Tdither>
+	void ConvertFixed(mpt::audio_span_interleaved<MixSampleInt> buffer, Tdither &dither)
+	{
+		using TOutSample = typename Taudio_span::sample_type;
+		constexpr int ditherBits = SampleFormat(SampleFormatTraits<TOutSample>::sampleFormat()).IsInt()
+			? SampleFormat(SampleFormatTraits<TOutSample>::sampleFormat()).GetBitsPerSample()
+			: 0;
+		const std::size_t channels = buffer.size_channels(), frames = buffer.size_frames();
+		AudioTargetSIMD::DitherBuffer<ditherBits>(dither, buffer.data(), channels, frames);
+		const auto outBuf = mpt::make_audio_span_with_offset(outputBuffer, countRendered);
+		if(outBuf.is_contiguous() && outBuf.size_channels() == channels)
+		{
+			AudioTargetSIMD::ConvertFixed(outBuf.data(), buffer.data(), channels * frames);
+			return;
+		}
+		// Planar or otherwise strided output
+		TOutSample converted[256];
+		const std::size_t framesPerBlock = std::size(converted) / channels;
+		for(std::size_t frame = 0; frame < frames; frame += framesPerBlock)
+		{
+			const std::size_t blockFrames = std::min(frames - frame, framesPerBlock);
+			AudioTargetSIMD::ConvertFixed(converted, &buffer(0, frame), blockFrames * channels);
+			const TOutSample *in = converted;
+			for(std::size_t i = 0; i < blockFrames; i++)
+			{
+				for(std::size_t channel = 0; channel < channels; channel++)
+				{
+					outBuf(channel, frame + i) = *in++;
+				}
+			}
+		}
+	}
 };
 
 
@@ -96,13 +135,7 @@ public:
 			{
 				// only apply gain when != +/- 0dB
 				// no clipping prevention is done here
-				for(std::size_t frame = 0; frame < buffer.size_frames(); ++frame)
-				{
-					for(std::size_t channel = 0; channel < buffer.size_channels(); ++channel)
-					{
-						buffer(channel, frame) = Util::muldiv(buffer(channel, frame), gainFactor16_16, 1 << 16);
-					}
-				}
+				AudioTargetSIMD::ApplyGain(buffer.data(), buffer.size_channels() * buffer.size_frames(), gainFactor16_16);
 			}
 		}
 		Tbase::Process(buffer);
@@ -111,11 +144,20 @@ public:
 			if(gainFactor != MixSampleFloat(1.0))
 			{
 				// only apply gain when != +/- 0dB
+				const auto outBuf = mpt::make_audio_span_with_offset(Tbase::outputBuffer, countRendered_);
+				if constexpr(std::is_same<typename Taudio_span::sample_type, float>::value)
+				{
+					if(outBuf.is_contiguous() && outBuf.size_channels() == buffer.size_channels())
+					{
+						AudioTargetSIMD::ApplyGain(outBuf.data(), buffer.size_channels() * buffer.size_frames(), static_cast<float>(gainFactor));
+						return;
+					}
+				}
 				for(std::size_t frame = 0; frame < buffer.size_frames(); ++frame)
 				{
 					for(std::size_t channel = 0; channel < buffer.size_channels(); ++channel)
 					{
-						Tbase::outputBuffer(channel, countRendered_ + frame) *= static_cast<typename Taudio_span::sample_type>(gainFactor);
+						outBuf(channel, frame) *= static_cast<typename Taudio_span::sample_type>(gainFactor);
 					}
 				}
 			}
@@ -126,11 +168,17 @@ public:
 		if(gainFactor != MixSampleFloat(1.0))
 		{
 			// only apply gain when != +/- 0dB
-			for(std::size_t frame = 0; frame < buffer.size_frames(); ++frame)
+			if constexpr(std::is_same<MixSampleFloat, float>::value)
+			{
+				AudioTargetSIMD::ApplyGain(buffer.data(), buffer.size_channels() * buffer.size_frames(), gainFactor);
+			} else
 			{
-				for(std::size_t channel = 0; channel < buffer.size_channels(); ++channel)
+				for(std::size_t frame = 0; frame < buffer.size_frames(); ++frame)
 				{
-					buffer(channel, frame) *= gainFactor;
+					for(std::size_t channel = 0; channel < buffer.size_channels(); ++channel)
+					{
+						buffer(channel, frame) *= gainFactor;
+					}
 				}
 			}
 		}
@@ -139,4 +187,57 @@ public:
 };
 
 
+// Writes the per-channel output of CSoundFile::Read to planar float buffers. Null buffers are skipped.
+class AudioChannelTargetBufferFloat
+	: public IChannelOutput
+{
+private:
+	float * const *outputBuffers;
+	const std::size_t numOutputBuffers;
+	const float gainFactor;
+	std::size_t countRendered = 0;
+public:
+	AudioChannelTargetBufferFloat(float * const *buffers, std::size_t numBuffers, float gainFactor_)
+		: outputBuffers(buffers)
+		, numOutputBuffers(numBuffers)
+		, gainFactor(gainFactor_)
+	{
+		return;
+	}
+	std::size_t GetRenderedCount() const { return countRendered; }
+public:
+	void Process(mpt::audio_span_planar<const MixSampleInt> buffer) override
+	{
+		SC::ConvertFixedPoint<float, MixSampleInt, MixSampleIntTraits::mix_fractional_bits> conv;
+		const std::size_t channels = std::min(numOutputBuffers, buffer.size_channels());
+		for(std::size_t channel = 0; channel < channels; ++channel)
+		{
+			float *out = outputBuffers[channel];
+			if(!out)
+				continue;
+			for(std::size_t frame = 0; frame < buffer.size_frames(); ++frame)
+			{
+				out[countRendered + frame] = conv(buffer(channel, frame)) * gainFactor;
+			}
+		}
+		countRendered += buffer.size_frames();
+	}
+	void Process(mpt::audio_span_planar<const MixSampleFloat> buffer) override
+	{
+		const std::size_t channels = std::min(numOutputBuffers, buffer.size_channels());
+		for(std::size_t channel = 0; channel < channels; ++channel)
+		{
+			float *out = outputBuffers[channel];
+			if(!out)
+				continue;
+			for(std::size_t frame = 0; frame < buffer.size_frames(); ++frame)
+			{
+				out[countRendered + frame] = static_cast<float>(buffer(channel, frame) * gainFactor);
+			}
+		}
+		countRendered += buffer.size_frames();
+	}
+};
+
+
 OPENMPT_NAMESPACE_END
@@ -0,0 +1,302 @@
+/*
+ * AudioReadTargetSIMD.cpp
+ * -----------------------
+ * Purpose: Vectorized gain, dithering and sample format conversion for the output of CSoundFile::Read.
+ * Notes  : See AudioReadTargetSIMD.h
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "AudioReadTargetSIMD.h"
+#include "../common/mptCPU.h"
+#include "openmpt/soundbase/SampleConvertFixedPoint.hpp"
+
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+#include <immintrin.h>
+#endif
+
+#include <cstring>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace AudioTargetSIMD
+{
+
+static_assert(sizeof(MixSampleInt) == 4);
+
+using ConvertInt16 = SC::ConvertFixedPoint<int16, MixSampleInt, MixSampleIntTraits::mix_fractional_bits>;
+using ConvertInt24 = SC::ConvertFixedPoint<int24, MixSampleInt, MixSampleIntTraits::mix_fractional_bits>;
+using ConvertFloat = SC::ConvertFixedPoint<float, MixSampleInt, MixSampleIntTraits::mix_fractional_bits>;
+
+
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+
+static bool HasSSE4()
+{
+	// Not a global, as CPU feature detection might not have been set up during static initialization (see CPU::EnableAvailableFeatures)
+	static const bool hasSSE4 = CPU::HasFeatureSet(CPU::feature::sse4_1) && CPU::HasModesEnabled(CPU::mode::xmm128sse);
+	return hasSSE4;
+}
+
+
+// x * gain / 65536 rounded towards zero and saturated, computed exactly in double precision.
+// This requires |x * gain| < 2^53, i.e. |gain| < 2^22 for any 32-bit x.
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE __m128i MulDivGain2SSE4(__m128d x, __m128d gain)
+{
+	const __m128d scaled = _mm_mul_pd(_mm_mul_pd(x, gain), _mm_set1_pd(1.0 / 65536.0));
+	const __m128d clamped = _mm_min_pd(_mm_max_pd(scaled, _mm_set1_pd(-2147483648.0)), _mm_set1_pd(2147483647.0));
+	return _mm_cvttpd_epi32(clamped);
+}
+
+static MPT_ARCH_TARGET_SSE4 void ApplyGainSSE4(MixSampleInt *buffer, std::size_t count, int32 gainFactor16_16)
+{
+	const __m128d gain = _mm_set1_pd(gainFactor16_16);
+	for(; count >= 4; count -= 4, buffer += 4)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buffer));
+		const __m128i lo = MulDivGain2SSE4(_mm_cvtepi32_pd(x), gain);
+		const __m128i hi = MulDivGain2SSE4(_mm_cvtepi32_pd(_mm_unpackhi_epi64(x, x)), gain);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(buffer), _mm_unpacklo_epi64(lo, hi));
+	}
+	for(; count > 0; count--, buffer++)
+	{
+		*buffer = Util::muldiv(*buffer, gainFactor16_16, 1 << 16);
+	}
+}
+
+static MPT_ARCH_TARGET_SSE4 void ApplyGainSSE4(float *buffer, std::size_t count, float gainFactor)
+{
+	const __m128 gain = _mm_set1_ps(gainFactor);
+	for(; count >= 4; count -= 4, buffer += 4)
+	{
+		_mm_storeu_ps(buffer, _mm_mul_ps(_mm_loadu_ps(buffer), gain));
+	}
+	for(; count > 0; count--, buffer++)
+	{
+		*buffer *= gainFactor;
+	}
+}
+
+
+// (x + round) >> shift, as done by SC::ConvertFixedPoint before clamping
+template <int shift>
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE __m128i RoundShiftSSE4(const MixSampleInt *in)
+{
+	const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+	return _mm_srai_epi32(_mm_add_epi32(x, _mm_set1_epi32(1 << (shift - 1))), shift);
+}
+
+static MPT_ARCH_TARGET_SSE4 void ConvertFixedSSE4(int16 *out, const MixSampleInt *in, std::size_t count)
+{
+	constexpr int shift = ConvertInt16::shiftBits;
+	for(; count >= 8; count -= 8, in += 8, out += 8)
+	{
+		// packs saturates to the int16 range just like the scalar clamp does
+		const __m128i packed = _mm_packs_epi32(RoundShiftSSE4<shift>(in), RoundShiftSSE4<shift>(in + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out), packed);
+	}
+	ConvertInt16 conv;
+	for(; count > 0; count--)
+	{
+		*out++ = conv(*in++);
+	}
+}
+
+static MPT_ARCH_TARGET_SSE4 void ConvertFixedSSE4(int24 *out, const MixSampleInt *in, std::size_t count)
+{
+	constexpr int shift = ConvertInt24::shiftBits;
+	const __m128i minVal = _mm_set1_epi32(int24_min), maxVal = _mm_set1_epi32(int24_max);
+	// Keep the lower three bytes of each 32-bit value (int24 is stored in native byte order)
+	const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	std::byte *dst = reinterpret_cast<std::byte *>(out);
+	for(; count >= 4; count -= 4, in += 4, dst += 12)
+	{
+		const __m128i clamped = _mm_min_epi32(_mm_max_epi32(RoundShiftSSE4<shift>(in), minVal), maxVal);
+		alignas(16) std::byte packed[16];
+		_mm_store_si128(reinterpret_cast<__m128i *>(packed), _mm_shuffle_epi8(clamped, pack));
+		std::memcpy(dst, packed, 12);
+	}
+	out = reinterpret_cast<int24 *>(dst);
+	ConvertInt24 conv;
+	for(; count > 0; count--)
+	{
+		*out++ = conv(*in++);
+	}
+}
+
+static MPT_ARCH_TARGET_SSE4 void ConvertFixedSSE4(float *out, const MixSampleInt *in, std::size_t count)
+{
+	ConvertFloat conv;
+	const __m128 factor = _mm_set1_ps(conv.factor);
+	for(; count >= 4; count -= 4, in += 4, out += 4)
+	{
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+		_mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(x), factor));
+	}
+	for(; count > 0; count--)
+	{
+		*out++ = conv(*in++);
+	}
+}
+
+
+// Sixteen consecutive LCG states in four vectors, so that the latency of the multiplication is hidden.
+// Each lane advances by sixteen steps at once: s' = a^16 * s + c * (a^15 + ... + a + 1)
+static MPT_ARCH_TARGET_SSE4 void GenerateNoiseSSE4(mpt::lcg_msvc &rng, uint32 *noise, std::size_t count, int noiseBits)
+{
+	using lcg = mpt::lcg_msvc;
+	static_assert(lcg::modulus == 0);
+	constexpr uint32 a = lcg::multiplier, c = lcg::increment;
+	constexpr int lanes = 16;
+	uint32 aN = 1, cN = 0;
+	for(int i = 0; i < lanes; i++)
+	{
+		cN = a * cN + c;
+		aN *= a;
+	}
+
+	uint32 s = rng.get_state();
+	alignas(16) uint32 initial[lanes];
+	for(auto &lane : initial)
+	{
+		lane = s;
+		s = a * s + c;
+	}
+	__m128i state0 = _mm_load_si128(reinterpret_cast<const __m128i *>(initial) + 0);
+	__m128i state1 = _mm_load_si128(reinterpret_cast<const __m128i *>(initial) + 1);
+	__m128i state2 = _mm_load_si128(reinterpret_cast<const __m128i *>(initial) + 2);
+	__m128i state3 = _mm_load_si128(reinterpret_cast<const __m128i *>(initial) + 3);
+	const __m128i mul = _mm_set1_epi32(static_cast<int32>(aN)), add = _mm_set1_epi32(static_cast<int32>(cN));
+	// Result is (state & 0x7FFF0000) >> 16, of which only the lower noiseBits are used
+	const __m128i mask = _mm_set1_epi32((1 << noiseBits) - 1);
+	std::size_t i = 0;
+	for(; i + lanes <= count; i += lanes)
+	{
+		__m128i *out = reinterpret_cast<__m128i *>(noise + i);
+		_mm_storeu_si128(out + 0, _mm_and_si128(_mm_srli_epi32(state0, 16), mask));
+		_mm_storeu_si128(out + 1, _mm_and_si128(_mm_srli_epi32(state1, 16), mask));
+		_mm_storeu_si128(out + 2, _mm_and_si128(_mm_srli_epi32(state2, 16), mask));
+		_mm_storeu_si128(out + 3, _mm_and_si128(_mm_srli_epi32(state3, 16), mask));
+		state0 = _mm_add_epi32(_mm_mullo_epi32(state0, mul), add);
+		state1 = _mm_add_epi32(_mm_mullo_epi32(state1, mul), add);
+		state2 = _mm_add_epi32(_mm_mullo_epi32(state2, mul), add);
+		state3 = _mm_add_epi32(_mm_mullo_epi32(state3, mul), add);
+	}
+	s = static_cast<uint32>(_mm_cvtsi128_si32(state0));
+	for(; i < count; i++)
+	{
+		noise[i] = ((s & 0x7FFF0000u) >> 16) & ((1u << noiseBits) - 1u);
+		s = a * s + c;
+	}
+	rng.set_state(s);
+}
+
+#endif // MPT_ENABLE_ARCH_INTRINSICS_SSE4
+
+
+void ApplyGain(MixSampleInt *buffer, std::size_t count, int32 gainFactor16_16)
+{
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(HasSSE4() && gainFactor16_16 > -(1 << 22) && gainFactor16_16 < (1 << 22))
+	{
+		ApplyGainSSE4(buffer, count, gainFactor16_16);
+		return;
+	}
+#endif
+	for(std::size_t i = 0; i < count; i++)
+	{
+		buffer[i] = Util::muldiv(buffer[i], gainFactor16_16, 1 << 16);
+	}
+}
+
+
+void ApplyGain(float *buffer, std::size_t count, float gainFactor)
+{
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(HasSSE4())
+	{
+		ApplyGainSSE4(buffer, count, gainFactor);
+		return;
+	}
+#endif
+	for(std::size_t i = 0; i < count; i++)
+	{
+		buffer[i] *= gainFactor;
+	}
+}
+
+
+template <typename Tconv, typename Tout>
+static void ConvertFixedGeneric(Tout *out, const MixSampleInt *in, std::size_t count)
+{
+	Tconv conv;
+	for(std::size_t i = 0; i < count; i++)
+	{
+		out[i] = conv(in[i]);
+	}
+}
+
+
+void ConvertFixed(int16 *out, const MixSampleInt *in, std::size_t count)
+{
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(HasSSE4())
+	{
+		ConvertFixedSSE4(out, in, count);
+		return;
+	}
+#endif
+	ConvertFixedGeneric<ConvertInt16>(out, in, count);
+}
+
+
+void ConvertFixed(int24 *out, const MixSampleInt *in, std::size_t count)
+{
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(HasSSE4())
+	{
+		ConvertFixedSSE4(out, in, count);
+		return;
+	}
+#endif
+	ConvertFixedGeneric<ConvertInt24>(out, in, count);
+}
+
+
+void ConvertFixed(float *out, const MixSampleInt *in, std::size_t count)
+{
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(HasSSE4())
+	{
+		ConvertFixedSSE4(out, in, count);
+		return;
+	}
+#endif
+	ConvertFixedGeneric<ConvertFloat>(out, in, count);
+}
+
+
+void GenerateNoise(mpt::lcg_msvc &rng, uint32 *noise, std::size_t count, int noiseBits)
+{
+	MPT_ASSERT(noiseBits > 0 && noiseBits <= mpt::engine_traits<mpt::lcg_msvc>::result_bits());
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(HasSSE4())
+	{
+		GenerateNoiseSSE4(rng, noise, count, noiseBits);
+		return;
+	}
+#endif
+	for(std::size_t i = 0; i < count; i++)
+	{
+		noise[i] = mpt::random<uint32>(rng, noiseBits);
+	}
+}
+
+}  // namespace AudioTargetSIMD
+
+
+OPENMPT_NAMESPACE_END
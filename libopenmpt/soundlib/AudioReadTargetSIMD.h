@@ -0,0 +1,146 @@
+/*
+ * AudioReadTargetSIMD.h
+ * ---------------------
+ * Purpose: Vectorized gain, dithering and sample format conversion for the output of CSoundFile::Read.
+ * Notes  : Everything in here produces exactly the same output as the scalar code in openmpt/soundbase that it replaces,
+ *          including the dither noise sequence. The best implementation for the CPU is picked at runtime.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "mpt/random/default_engines.hpp"
+#include "openmpt/base/Int24.hpp"
+#include "openmpt/base/Types.hpp"
+#include "openmpt/soundbase/Dither.hpp"
+#include "openmpt/soundbase/DitherNone.hpp"
+#include "openmpt/soundbase/DitherSimple.hpp"
+#include "openmpt/soundbase/MixSample.hpp"
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+#include <cstddef>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace AudioTargetSIMD
+{
+
+// All functions work on count interleaved samples.
+
+// buffer[i] = Util::muldiv(buffer[i], gainFactor16_16, 1 << 16)
+void ApplyGain(MixSampleInt *buffer, std::size_t count, int32 gainFactor16_16);
+// buffer[i] *= gainFactor
+void ApplyGain(float *buffer, std::size_t count, float gainFactor);
+
+// Same as SC::ConvertFixedPoint<Tout, MixSampleInt, MixSampleIntTraits::mix_fractional_bits>
+void ConvertFixed(int16 *out, const MixSampleInt *in, std::size_t count);
+void ConvertFixed(int24 *out, const MixSampleInt *in, std::size_t count);
+void ConvertFixed(float *out, const MixSampleInt *in, std::size_t count);
+
+template <typename T>
+inline constexpr bool CanConvertFixed = std::is_same_v<T, int16> || std::is_same_v<T, int24> || std::is_same_v<T, float>;
+
+// Same as noise[i] = mpt::random<uint32>(rng, noiseBits) for i = 0...count-1, with noiseBits no larger than the engine's result bits
+void GenerateNoise(mpt::lcg_msvc &rng, uint32 *noise, std::size_t count, int noiseBits);
+
+
+template <typename Tdither>
+struct IsRectangularSimpleDither : std::false_type { };
+template <int ditherdepth, bool shaped>
+struct IsRectangularSimpleDither<Dither_SimpleImpl<ditherdepth, false, shaped>> : std::true_type { };
+
+
+template <uint32 targetbits, typename Tdither>
+void DitherBufferScalar(MultiChannelDither<Tdither> &dither, MixSampleInt *buffer, std::size_t channels, std::size_t frames)
+{
+	for(std::size_t frame = 0; frame < frames; frame++)
+	{
+		for(std::size_t channel = 0; channel < channels; channel++)
+		{
+			*buffer = dither.template process<targetbits>(channel, *buffer);
+			buffer++;
+		}
+	}
+}
+
+
+// Apply pre-generated noise to a block of frames, keeping the noise shaping state of all channels in registers.
+// With a constant channel count, the serial dependency chains of the channels can be interleaved.
+template <uint32 targetbits, std::size_t channels, typename Tdither>
+MPT_FORCEINLINE void ApplyDitherNoise(MultiChannelDither<Tdither> &dither, MixSampleInt *buffer, const uint32 *noise, std::size_t frames)
+{
+	std::array<Tdither, channels> state;
+	for(std::size_t channel = 0; channel < channels; channel++)
+		state[channel] = dither.GetChannelDither(channel);
+	for(std::size_t frame = 0; frame < frames; frame++)
+	{
+		for(std::size_t channel = 0; channel < channels; channel++)
+		{
+			*buffer = state[channel].template process_noise<targetbits>(*buffer, *noise++);
+			buffer++;
+		}
+	}
+	for(std::size_t channel = 0; channel < channels; channel++)
+		dither.GetChannelDither(channel) = state[channel];
+}
+
+
+// Dither an interleaved mix buffer in-place, with the same result as calling dither.process<targetbits>(channel, sample) for every sample in order.
+// For the simple rectangular dither, the PRNG output is generated in blocks, so only the noise shaping remains a serial dependency.
+template <uint32 targetbits, typename Tdither>
+void DitherBuffer(MultiChannelDither<Tdither> &dither, MixSampleInt *buffer, std::size_t channels, std::size_t frames)
+{
+	if constexpr(std::is_same_v<Tdither, Dither_None> || targetbits == 0)
+	{
+		MPT_UNUSED(dither);
+		MPT_UNUSED(buffer);
+		MPT_UNUSED(channels);
+		MPT_UNUSED(frames);
+	} else if constexpr(IsRectangularSimpleDither<Tdither>::value && std::is_same_v<typename Tdither::prng_type, mpt::lcg_msvc>)
+	{
+		constexpr int noiseBits = Tdither::template noise_bits<targetbits>();
+		if constexpr(noiseBits > 0 && noiseBits <= mpt::engine_traits<mpt::lcg_msvc>::result_bits())
+		{
+			if(channels != 1 && channels != 2 && channels != 4)
+			{
+				DitherBufferScalar<targetbits>(dither, buffer, channels, frames);
+				return;
+			}
+			uint32 noise[256];
+			const std::size_t framesPerBlock = std::size(noise) / channels;
+			while(frames > 0)
+			{
+				const std::size_t blockFrames = std::min(frames, framesPerBlock);
+				GenerateNoise(dither.GetPRNG(), noise, blockFrames * channels, noiseBits);
+				switch(channels)
+				{
+				case 1: ApplyDitherNoise<targetbits, 1>(dither, buffer, noise, blockFrames); break;
+				case 2: ApplyDitherNoise<targetbits, 2>(dither, buffer, noise, blockFrames); break;
+				case 4: ApplyDitherNoise<targetbits, 4>(dither, buffer, noise, blockFrames); break;
+				}
+				buffer += blockFrames * channels;
+				frames -= blockFrames;
+			}
+		} else
+		{
+			DitherBufferScalar<targetbits>(dither, buffer, channels, frames);
+		}
+	} else
+	{
+		DitherBufferScalar<targetbits>(dither, buffer, channels, frames);
+	}
+}
+
+}  // namespace AudioTargetSIMD
+
+
+OPENMPT_NAMESPACE_END
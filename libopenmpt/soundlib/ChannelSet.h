@@ -0,0 +1,83 @@
+/*
+ * ChannelSet.h
+ * ------------
+ * Purpose: Fixed-size set of channel indices with ordered iteration, used to keep track of live background (NNA) channels
+ *          and of the pattern channels that contain data on a row.
+ * Notes  : Iteration and searches cost O(number of channels / 64 + number of elements) rather than O(number of channels),
+ *          and always visit channels in ascending order, so that code iterating over the set processes channels
+ *          in the same order as a plain loop over all channels would.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "Snd_defs.h"
+
+#include <array>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+template<std::size_t numChannels>
+class BasicChannelSet
+{
+public:
+	void set(CHANNELINDEX chn) noexcept { m_words[chn / 64u] |= Bit(chn); }
+	void reset(CHANNELINDEX chn) noexcept { m_words[chn / 64u] &= ~Bit(chn); }
+	void reset() noexcept { m_words.fill(0); }
+	bool test(CHANNELINDEX chn) const noexcept { return (m_words[chn / 64u] & Bit(chn)) != 0; }
+
+	// Returns the lowest channel index >= first that is in the set, or CHANNELINDEX_INVALID if there is none.
+	CHANNELINDEX FindFirstSet(CHANNELINDEX first) const noexcept { return Find(first, 0); }
+	// Returns the lowest channel index >= first that is not in the set, or CHANNELINDEX_INVALID if there is none.
+	CHANNELINDEX FindFirstUnset(CHANNELINDEX first) const noexcept { return Find(first, ~uint64(0)); }
+
+private:
+	static constexpr std::size_t NumWords = (numChannels + 63u) / 64u;
+
+	static constexpr uint64 Bit(CHANNELINDEX chn) noexcept { return uint64(1) << (chn % 64u); }
+
+	CHANNELINDEX Find(CHANNELINDEX first, uint64 invert) const noexcept
+	{
+		if(first >= numChannels)
+			return CHANNELINDEX_INVALID;
+		std::size_t word = first / 64u;
+		uint64 bits = (m_words[word] ^ invert) & (~uint64(0) << (first % 64u));
+		while(!bits)
+		{
+			if(++word == NumWords)
+				return CHANNELINDEX_INVALID;
+			bits = m_words[word] ^ invert;
+		}
+		const std::size_t chn = word * 64u + LowestBit(bits);
+		return (chn < numChannels) ? static_cast<CHANNELINDEX>(chn) : CHANNELINDEX_INVALID;
+	}
+
+	// De Bruijn bit scan. mpt::countr_zero is only usable for 64-bit types with C++20, the fallback tests one bit at a time.
+	static constexpr int LowestBit(uint64 bits) noexcept
+	{
+		constexpr uint8 index[64] =
+		{
+			 0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+			62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+			63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+			46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6,
+		};
+		return index[((bits & (0 - bits)) * 0x03F79D71B4CB0A89ull) >> 58];
+	}
+
+	std::array<uint64, NumWords> m_words = {};
+};
+
+// All mixing channels
+using ChannelSet = BasicChannelSet<MAX_CHANNELS>;
+// Pattern channels
+using PatternChannelSet = BasicChannelSet<MAX_BASECHANNELS>;
+
+
+OPENMPT_NAMESPACE_END
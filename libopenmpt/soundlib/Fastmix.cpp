@@ -20,6 +20,8 @@
 #include "Sndfile.h"
 #include "MixerLoops.h"
 #include "MixFuncTable.h"
+#include "ParallelMix.h"
+#include "SamplePyramid.h"
 #include "plugins/PlugInterface.h"
 #include <cfloat>  // For FLT_EPSILON
 #include <algorithm>
@@ -303,10 +305,9 @@ struct MixLoopState
 
 
 // Render count * number of channels samples
-void CSoundFile::CreateStereoMix(int count)
+// If channelOutput is set, each channel is additionally rendered into m_channelOutputPointers (planar, left and right per pattern channel)
+void CSoundFile::CreateStereoMix(int count, bool channelOutput)
 {
-	mixsample_t *pOfsL, *pOfsR;
-
 	if(!count)
 		return;
 
@@ -314,6 +315,15 @@ void CSoundFile::CreateStereoMix(int count)
 	StereoFill(MixSoundBuffer, count, m_dryROfsVol, m_dryLOfsVol);
 	if(m_MixerSettings.gnChannels > 2)
 		StereoFill(MixRearBuffer, count, m_surroundROfsVol, m_surroundLOfsVol);
+	if(channelOutput)
+	{
+		for(mixsample_t *channelBuffer : m_channelOutputPointers)
+			InitMixBuffer(channelBuffer, count);
+	}
+	else if(CreateStereoMixParallel(count))
+	{
+		return;
+	}
 
 	CHANNELINDEX nchmixed = 0;
 
@@ -324,217 +334,422 @@ void CSoundFile::CreateStereoMix(int count)
 		if(!chn.pCurrentSample && !chn.nLOfs && !chn.nROfs)
 			continue;
 
-		pOfsR = &m_dryROfsVol;
-		pOfsL = &m_dryLOfsVol;
+		mixsample_t *pOfsR, *pOfsL;
+		PLUGINDEX nMixPlugin;
+		mixsample_t *pbuffer = GetChannelMixTarget(m_PlayState.ChnMix[nChn], chn, count, pOfsR, pOfsL, nMixPlugin);
 
-		uint32 functionNdx = MixFuncTable::ResamplingModeToMixFlags(static_cast<ResamplingMode>(chn.resamplingMode));
-		if(chn.dwFlags[CHN_16BIT]) functionNdx |= MixFuncTable::ndx16Bit;
-		if(chn.dwFlags[CHN_STEREO]) functionNdx |= MixFuncTable::ndxStereo;
-#ifndef NO_FILTER
-		if(chn.dwFlags[CHN_FILTER]) functionNdx |= MixFuncTable::ndxFilter;
-#endif
-
-		mixsample_t *pbuffer = MixSoundBuffer;
-#ifndef NO_REVERB
-		if(((m_MixerSettings.DSPMask & SNDDSP_REVERB) && !chn.dwFlags[CHN_NOREVERB]) || chn.dwFlags[CHN_REVERB])
+		// For per-channel output, render into a scratch buffer first which is then added to both the actual mix buffer and the
+		// output buffer of the pattern channel. NNA channels are attributed to the channel they were spawned from.
+		mixsample_t *pChannelMixTarget = nullptr;
+		CHANNELINDEX outputChannel = CHANNELINDEX_INVALID;
+		if(channelOutput)
 		{
-			m_Reverb.TouchReverbSendBuffer(ReverbSendBuffer, m_RvbROfsVol, m_RvbLOfsVol, count);
-			pbuffer = ReverbSendBuffer;
-			pOfsR = &m_RvbROfsVol;
-			pOfsL = &m_RvbLOfsVol;
+			const CHANNELINDEX mixChn = m_PlayState.ChnMix[nChn];
+			if(mixChn < GetNumChannels())
+				outputChannel = mixChn;
+			else if(chn.nMasterChn > 0 && chn.nMasterChn <= GetNumChannels())
+				outputChannel = chn.nMasterChn - 1;
+			if(outputChannel != CHANNELINDEX_INVALID && outputChannel * 2u + 1u < m_channelOutputPointers.size())
+			{
+				pChannelMixTarget = pbuffer;
+				pbuffer = MixChannelScratchBuffer;
+				InitMixBuffer(pbuffer, count * 2);
+			}
 		}
-#endif
-		if(chn.dwFlags[CHN_SURROUND] && m_MixerSettings.gnChannels > 2)
+
+		const CHANNELINDEX naddmix = MixChannel(chn, pbuffer, *pOfsR, *pOfsL, count, nchmixed >= m_MixerSettings.m_nMaxMixChannels);
+		nchmixed += naddmix;
+
+		if(pChannelMixTarget)
+			AddStereoMixSplit(MixChannelScratchBuffer, pChannelMixTarget, m_channelOutputPointers[outputChannel * 2], m_channelOutputPointers[outputChannel * 2 + 1], count);
+
+#ifndef NO_PLUGINS
+		if(naddmix && nMixPlugin > 0 && nMixPlugin <= MAX_MIXPLUGINS && m_MixPlugins[nMixPlugin - 1].pMixPlugin)
 		{
-			pbuffer = MixRearBuffer;
-			pOfsR = &m_surroundROfsVol;
-			pOfsL = &m_surroundLOfsVol;
+			m_MixPlugins[nMixPlugin - 1].pMixPlugin->ResetSilence();
 		}
+#endif // NO_PLUGINS
+	}
+	m_nMixStat = std::max(m_nMixStat, nchmixed);
+}
 
-		//Look for plugins associated with this implicit tracker channel.
-#ifndef NO_PLUGINS
-		PLUGINDEX nMixPlugin = GetBestPlugin(m_PlayState, m_PlayState.ChnMix[nChn], PrioritiseInstrument, RespectMutes);
 
-		if ((nMixPlugin > 0) && (nMixPlugin <= MAX_MIXPLUGINS) && m_MixPlugins[nMixPlugin - 1].pMixPlugin != nullptr)
+// Distribute the active voices over the mixer threads, if there are enough of them.
+// Every worker but the first one mixes into private buffers, which are summed up in worker order afterwards, so the result does not depend on thread timing.
+// Returns false if the voices have to be mixed serially.
+bool CSoundFile::CreateStereoMixParallel(int count)
+{
+	if(!m_parallelMix)
+		return false;
+	ParallelMixState &state = *m_parallelMix;
+	const uint32 numThreads = state.pool.GetNumThreads();
+	// Voices are skipped once the mix limit is reached, which depends on the order in which they are mixed
+	if(numThreads < 2 || m_nMixChannels > m_MixerSettings.m_nMaxMixChannels)
+		return false;
+#ifdef MODPLUG_TRACKER
+	if(m_SamplePlayLengths != nullptr)
+		return false;
+#endif
+	uint32 activeVoices = 0;
+	for(uint32 nChn = 0; nChn < m_nMixChannels; nChn++)
+	{
+		const ModChannel &chn = m_PlayState.Chn[m_PlayState.ChnMix[nChn]];
+		if(chn.pCurrentSample || chn.nLOfs || chn.nROfs)
+			activeVoices++;
+	}
+	if(activeVoices < std::max(m_MixerSettings.m_nMixThreadsMinVoices, numThreads))
+		return false;
+
+	// Routing has side effects on the target buffers (clearing them on first use), so it is done up-front on this thread.
+	state.targets.clear();
+	state.voices.clear();
+	for(uint32 nChn = 0; nChn < m_nMixChannels; nChn++)
+	{
+		const CHANNELINDEX mixChn = m_PlayState.ChnMix[nChn];
+		const ModChannel &chn = m_PlayState.Chn[mixChn];
+		if(!chn.pCurrentSample && !chn.nLOfs && !chn.nROfs)
+			continue;
+		mixsample_t *pOfsR, *pOfsL;
+		PLUGINDEX nMixPlugin;
+		mixsample_t *pbuffer = GetChannelMixTarget(mixChn, chn, count, pOfsR, pOfsL, nMixPlugin);
+		state.voices.push_back({mixChn, state.FindOrAddTarget(pbuffer, pOfsR, pOfsL), nMixPlugin, false});
+	}
+
+	const uint32 numVoices = static_cast<uint32>(state.voices.size());
+	const uint32 bufferSize = static_cast<uint32>(state.targets.size()) * count * 2;
+	for(uint32 worker = 0; worker < numThreads; worker++)
+	{
+		ParallelMixState::Worker &w = state.workers[worker];
+		w.firstVoice = numVoices * worker / numThreads;
+		w.lastVoice = numVoices * (worker + 1) / numThreads;
+		if(worker == 0)
+			continue;
+		// Reserved by SetMixerSettings, this only grows if plugins have been added since then
+		if(w.buffers.size() < bufferSize)
+			w.buffers.resize(bufferSize);
+		w.ofs.assign(state.targets.size() * 2, 0);
+		w.used.assign(state.targets.size(), false);
+	}
+
+	struct Job
+	{
+		CSoundFile &sndFile;
+		ParallelMixState &state;
+		int count;
+
+		static void Run(void *context, uint32 worker)
 		{
-			// Render into plugin buffer instead of global buffer
-			SNDMIXPLUGINSTATE &mixState = m_MixPlugins[nMixPlugin - 1].pMixPlugin->m_MixState;
-			if (mixState.pMixBuffer)
-			{
-				pbuffer = mixState.pMixBuffer;
-				pOfsR = &mixState.nVolDecayR;
-				pOfsL = &mixState.nVolDecayL;
-				if (!(mixState.dwFlags & SNDMIXPLUGINSTATE::psfMixReady))
+			Job &job = *static_cast<Job *>(context);
+			ParallelMixState &state = job.state;
+			ParallelMixState::Worker &w = state.workers[worker];
+			for(uint32 v = w.firstVoice; v < w.lastVoice; v++)
+			{
+				ParallelMixState::Voice &voice = state.voices[v];
+				const ParallelMixState::Target &target = state.targets[voice.target];
+				mixsample_t *pbuffer = target.buffer, *pOfsR = target.ofsR, *pOfsL = target.ofsL;
+				if(worker != 0)
 				{
-					StereoFill(pbuffer, count, *pOfsR, *pOfsL);
-					mixState.dwFlags |= SNDMIXPLUGINSTATE::psfMixReady;
+					pbuffer = w.buffers.data() + voice.target * job.count * 2;
+					pOfsR = &w.ofs[voice.target * 2];
+					pOfsL = &w.ofs[voice.target * 2 + 1];
+					if(!w.used[voice.target])
+					{
+						InitMixBuffer(pbuffer, job.count * 2);
+						w.used[voice.target] = true;
+					}
 				}
+				voice.mixed = job.sndFile.MixChannel(job.sndFile.m_PlayState.Chn[voice.channel], pbuffer, *pOfsR, *pOfsL, job.count, false) != 0;
 			}
 		}
-#endif // NO_PLUGINS
+	};
+	Job job{*this, state, count};
+	state.pool.Run(&Job::Run, &job);
 
-		if(chn.isPaused)
+	for(uint32 worker = 1; worker < numThreads; worker++)
+	{
+		const ParallelMixState::Worker &w = state.workers[worker];
+		for(size_t t = 0; t < state.targets.size(); t++)
 		{
-			EndChannelOfs(chn, pbuffer, count);
-			*pOfsR += chn.nROfs;
-			*pOfsL += chn.nLOfs;
-			chn.nROfs = chn.nLOfs = 0;
+			if(!w.used[t])
+				continue;
+			const ParallelMixState::Target &target = state.targets[t];
+			AddStereoMix(w.buffers.data() + t * count * 2, target.buffer, count);
+			*target.ofsR += w.ofs[t * 2];
+			*target.ofsL += w.ofs[t * 2 + 1];
+		}
+	}
+
+	CHANNELINDEX nchmixed = 0;
+	for(const auto &voice : state.voices)
+	{
+		if(!voice.mixed)
 			continue;
+		nchmixed++;
+#ifndef NO_PLUGINS
+		if(voice.plugin > 0 && voice.plugin <= MAX_MIXPLUGINS && m_MixPlugins[voice.plugin - 1].pMixPlugin)
+		{
+			m_MixPlugins[voice.plugin - 1].pMixPlugin->ResetSilence();
 		}
+#endif // NO_PLUGINS
+	}
+	m_nMixStat = std::max(m_nMixStat, nchmixed);
+	return true;
+}
+
 
-		MixLoopState mixLoopState(*this, chn);
+// Find the buffer that a voice is mixed into (dry, rear, reverb send or plugin input) and clear it if this is the first voice rendered into it.
+// mixPlugin receives the plugin that the voice is routed to, if any.
+mixsample_t *CSoundFile::GetChannelMixTarget(CHANNELINDEX mixChn, const ModChannel &chn, int count, mixsample_t *&pOfsR, mixsample_t *&pOfsL, PLUGINDEX &mixPlugin)
+{
+	mixPlugin = 0;
+	pOfsR = &m_dryROfsVol;
+	pOfsL = &m_dryLOfsVol;
+	mixsample_t *pbuffer = MixSoundBuffer;
+#ifndef NO_REVERB
+	if(((m_MixerSettings.DSPMask & SNDDSP_REVERB) && !chn.dwFlags[CHN_NOREVERB]) || chn.dwFlags[CHN_REVERB])
+	{
+		m_Reverb.TouchReverbSendBuffer(ReverbSendBuffer, m_RvbROfsVol, m_RvbLOfsVol, count);
+		pbuffer = ReverbSendBuffer;
+		pOfsR = &m_RvbROfsVol;
+		pOfsL = &m_RvbLOfsVol;
+	}
+#endif
+	if(chn.dwFlags[CHN_SURROUND] && m_MixerSettings.gnChannels > 2)
+	{
+		pbuffer = MixRearBuffer;
+		pOfsR = &m_surroundROfsVol;
+		pOfsL = &m_surroundLOfsVol;
+	}
 
-		////////////////////////////////////////////////////
-		CHANNELINDEX naddmix = 0;
-		int nsamples = count;
-		// Keep mixing this sample until the buffer is filled.
-		do
+	//Look for plugins associated with this implicit tracker channel.
+#ifndef NO_PLUGINS
+	PLUGINDEX nMixPlugin = GetBestPlugin(m_PlayState, mixChn, PrioritiseInstrument, RespectMutes);
+	mixPlugin = nMixPlugin;
+
+	if ((nMixPlugin > 0) && (nMixPlugin <= MAX_MIXPLUGINS) && m_MixPlugins[nMixPlugin - 1].pMixPlugin != nullptr)
+	{
+		// Render into plugin buffer instead of global buffer
+		SNDMIXPLUGINSTATE &mixState = m_MixPlugins[nMixPlugin - 1].pMixPlugin->m_MixState;
+		if (mixState.pMixBuffer)
 		{
-			uint32 nrampsamples = nsamples;
-			int32 nSmpCount;
-			if(chn.nRampLength > 0)
+			pbuffer = mixState.pMixBuffer;
+			pOfsR = &mixState.nVolDecayR;
+			pOfsL = &mixState.nVolDecayL;
+			if (!(mixState.dwFlags & SNDMIXPLUGINSTATE::psfMixReady))
 			{
-				if (nrampsamples > chn.nRampLength) nrampsamples = chn.nRampLength;
+				StereoFill(pbuffer, count, *pOfsR, *pOfsL);
+				mixState.dwFlags |= SNDMIXPLUGINSTATE::psfMixReady;
 			}
+		}
+	}
+#else
+	MPT_UNREFERENCED_PARAMETER(mixChn);
+#endif // NO_PLUGINS
+	return pbuffer;
+}
 
-			if((nSmpCount = mixLoopState.GetSampleCount(chn, nrampsamples)) <= 0)
-			{
-				// Stopping the channel
-				chn.pCurrentSample = nullptr;
-				chn.nLength = 0;
-				chn.position.Set(0);
-				chn.nRampLength = 0;
-				EndChannelOfs(chn, pbuffer, nsamples);
-				*pOfsR += chn.nROfs;
-				*pOfsL += chn.nLOfs;
-				chn.nROfs = chn.nLOfs = 0;
-				chn.dwFlags.reset(CHN_PINGPONGFLAG);
-				break;
-			}
 
-			// Should we mix this channel ?
-			if((nchmixed >= m_MixerSettings.m_nMaxMixChannels)				// Too many channels
-				|| (!chn.nRampLength && !(chn.leftVol | chn.rightVol)))		// Channel is completely silent
+// Render count samples of a single voice into pbuffer, adding its click removal tail to ofsR / ofsL.
+// If overMixLimit is set, the voice is advanced without being mixed.
+// Returns 1 if the voice was audible, 0 otherwise.
+CHANNELINDEX CSoundFile::MixChannel(ModChannel &chn, mixsample_t *pbuffer, mixsample_t &ofsR, mixsample_t &ofsL, int count, bool overMixLimit)
+{
+	if(chn.isPaused)
+	{
+		EndChannelOfs(chn, pbuffer, count);
+		ofsR += chn.nROfs;
+		ofsL += chn.nLOfs;
+		chn.nROfs = chn.nLOfs = 0;
+		return 0;
+	}
+
+	const MixFuncInterface *mixFunctions = MixFuncTable::GetFunctions();
+	uint32 functionNdx = MixFuncTable::ResamplingModeToMixFlags(static_cast<ResamplingMode>(chn.resamplingMode));
+	if(chn.dwFlags[CHN_16BIT]) functionNdx |= MixFuncTable::ndx16Bit;
+	if(chn.dwFlags[CHN_STEREO]) functionNdx |= MixFuncTable::ndxStereo;
+#ifndef NO_FILTER
+	if(chn.dwFlags[CHN_FILTER]) functionNdx |= MixFuncTable::ndxFilter;
+#endif
+
+	MixLoopState mixLoopState(*this, chn);
+
+	// Voices that are pitched up by an octave or more can be mixed from a band-limited copy of the sample at a lower rate,
+	// as long as they play the same loop that the copy was made for.
+	const SamplePyramid *pyramid = nullptr;
+	uint8 pyramidLevel = 0;
+	if(m_Resampler.m_Settings.samplePyramids && SamplePyramid::IsSupportedMode(chn.resamplingMode)
+		&& chn.pModSample != nullptr && chn.pModSample->pyramid && chn.pCurrentSample == chn.pModSample->samplev())
+	{
+		pyramid = chn.pModSample->pyramid.get();
+		const bool sameLoop = chn.dwFlags[CHN_LOOP]
+			? (pyramid->looped && chn.nLoopStart == pyramid->loopStart && chn.nLoopEnd == pyramid->loopEnd && chn.dwFlags[CHN_PINGPONGLOOP] == pyramid->pingPong)
+			: (!pyramid->looped && chn.nLength <= chn.pModSample->nLength);
+		if(sameLoop)
+			pyramidLevel = std::min(SamplePyramid::LevelForIncrement(chn.increment), pyramid->numLevels);
+	}
+
+	////////////////////////////////////////////////////
+	CHANNELINDEX naddmix = 0;
+	int nsamples = count;
+	// Keep mixing this sample until the buffer is filled.
+	do
+	{
+		uint32 nrampsamples = nsamples;
+		int32 nSmpCount;
+		if(chn.nRampLength > 0)
+		{
+			if (nrampsamples > chn.nRampLength) nrampsamples = chn.nRampLength;
+		}
+
+		if((nSmpCount = mixLoopState.GetSampleCount(chn, nrampsamples)) <= 0)
+		{
+			// Stopping the channel
+			chn.pCurrentSample = nullptr;
+			chn.nLength = 0;
+			chn.position.Set(0);
+			chn.nRampLength = 0;
+			EndChannelOfs(chn, pbuffer, nsamples);
+			ofsR += chn.nROfs;
+			ofsL += chn.nLOfs;
+			chn.nROfs = chn.nLOfs = 0;
+			chn.dwFlags.reset(CHN_PINGPONGFLAG);
+			break;
+		}
+
+		// Should we mix this channel ?
+		if(overMixLimit													// Too many channels
+			|| (!chn.nRampLength && !(chn.leftVol | chn.rightVol)))		// Channel is completely silent
+		{
+			chn.position += chn.increment * nSmpCount;
+			chn.nROfs = chn.nLOfs = 0;
+			pbuffer += nSmpCount * 2;
+			naddmix = 0;
+		}
+#ifdef MODPLUG_TRACKER
+		else if(m_SamplePlayLengths != nullptr)
+		{
+			// Detecting the longest play time for each sample for optimization
+			SmpLength pos = chn.position.GetUInt();
+			chn.position += chn.increment * nSmpCount;
+			if(!chn.increment.IsNegative())
 			{
-				chn.position += chn.increment * nSmpCount;
-				chn.nROfs = chn.nLOfs = 0;
-				pbuffer += nSmpCount * 2;
-				naddmix = 0;
+				pos = chn.position.GetUInt();
 			}
-#ifdef MODPLUG_TRACKER
-			else if(m_SamplePlayLengths != nullptr)
+			size_t smp = std::distance(static_cast<const ModSample*>(static_cast<std::decay<decltype(Samples)>::type>(Samples)), chn.pModSample);
+			if(smp < m_SamplePlayLengths->size())
 			{
-				// Detecting the longest play time for each sample for optimization
-				SmpLength pos = chn.position.GetUInt();
-				chn.position += chn.increment * nSmpCount;
-				if(!chn.increment.IsNegative())
-				{
-					pos = chn.position.GetUInt();
-				}
-				size_t smp = std::distance(static_cast<const ModSample*>(static_cast<std::decay<decltype(Samples)>::type>(Samples)), chn.pModSample);
-				if(smp < m_SamplePlayLengths->size())
-				{
-					(*m_SamplePlayLengths)[smp] = std::max((*m_SamplePlayLengths)[smp], pos);
-				}
+				(*m_SamplePlayLengths)[smp] = std::max((*m_SamplePlayLengths)[smp], pos);
 			}
+		}
 #endif
-			else
-			{
-				// Do mixing
-				mixsample_t *pbufmax = pbuffer + (nSmpCount * 2);
-				chn.nROfs = -*(pbufmax - 2);
-				chn.nLOfs = -*(pbufmax - 1);
+		else
+		{
+			// Do mixing
+			mixsample_t *pbufmax = pbuffer + (nSmpCount * 2);
+			chn.nROfs = -*(pbufmax - 2);
+			chn.nLOfs = -*(pbufmax - 1);
 
 #ifdef MPT_BUILD_DEBUG
-				SamplePosition targetpos = chn.position + chn.increment * nSmpCount;
+			SamplePosition targetpos = chn.position + chn.increment * nSmpCount;
 #endif
-				MixFuncTable::Functions[functionNdx | (chn.nRampLength ? MixFuncTable::ndxRamp : 0)](chn, m_Resampler, pbuffer, nSmpCount);
+			const MixFuncInterface mixFunction = mixFunctions[functionNdx | (chn.nRampLength ? MixFuncTable::ndxRamp : 0)];
+			// Right after wrapping around to the loop start, the interpolation has to see the loop end behind the loop start,
+			// which only the original sample provides. Everywhere else, the levels already continue the sample around the loop end.
+			if(pyramidLevel && (chn.pCurrentSample == mixLoopState.samplePointer || chn.pCurrentSample == mixLoopState.lookaheadPointer))
+			{
+				// Loop and sample end handling stays on the original sample, only the resampler sees the lower rate
+				const SamplePosition position = chn.position, increment = chn.increment;
+				const void *samplePointer = chn.pCurrentSample;
+				chn.position = SamplePosition(position.GetRaw() >> pyramidLevel);
+				chn.increment = SamplePosition(increment.GetRaw() >> pyramidLevel);
+				chn.pCurrentSample = pyramid->GetLevel(pyramidLevel);
+				mixFunction(chn, m_Resampler, pbuffer, nSmpCount);
+				chn.position = position + increment * nSmpCount;
+				chn.increment = increment;
+				chn.pCurrentSample = samplePointer;
+			} else
+			{
+				mixFunction(chn, m_Resampler, pbuffer, nSmpCount);
+			}
 #ifdef MPT_BUILD_DEBUG
-				MPT_ASSERT(chn.position.GetUInt() == targetpos.GetUInt());
+			MPT_ASSERT(chn.position.GetUInt() == targetpos.GetUInt());
 #endif
 
-				chn.nROfs += *(pbufmax - 2);
-				chn.nLOfs += *(pbufmax - 1);
-				pbuffer = pbufmax;
-				naddmix = 1;
-			}
+			chn.nROfs += *(pbufmax - 2);
+			chn.nLOfs += *(pbufmax - 1);
+			pbuffer = pbufmax;
+			naddmix = 1;
+		}
 
-			nsamples -= nSmpCount;
-			if (chn.nRampLength)
+		nsamples -= nSmpCount;
+		if (chn.nRampLength)
+		{
+			if (chn.nRampLength <= static_cast<uint32>(nSmpCount))
 			{
-				if (chn.nRampLength <= static_cast<uint32>(nSmpCount))
-				{
-					// Ramping is done
-					chn.nRampLength = 0;
-					chn.leftVol = chn.newLeftVol;
-					chn.rightVol = chn.newRightVol;
-					chn.rightRamp = chn.leftRamp = 0;
-					if(chn.dwFlags[CHN_NOTEFADE] && !chn.nFadeOutVol)
-					{
-						chn.nLength = 0;
-						chn.pCurrentSample = nullptr;
-					}
-				} else
+				// Ramping is done
+				chn.nRampLength = 0;
+				chn.leftVol = chn.newLeftVol;
+				chn.rightVol = chn.newRightVol;
+				chn.rightRamp = chn.leftRamp = 0;
+				if(chn.dwFlags[CHN_NOTEFADE] && !chn.nFadeOutVol)
 				{
-					chn.nRampLength -= nSmpCount;
+					chn.nLength = 0;
+					chn.pCurrentSample = nullptr;
 				}
+			} else
+			{
+				chn.nRampLength -= nSmpCount;
 			}
+		}
 
-			const bool pastLoopEnd = chn.position.GetUInt() >= chn.nLoopEnd && chn.dwFlags[CHN_LOOP];
-			const bool pastSampleEnd = chn.position.GetUInt() >= chn.nLength && !chn.dwFlags[CHN_LOOP] && chn.nLength && !chn.nMasterChn;
-			const bool doSampleSwap = m_playBehaviour[kMODSampleSwap] && chn.nNewIns && chn.nNewIns <= GetNumSamples() && chn.pModSample != &Samples[chn.nNewIns];
-			if((pastLoopEnd || pastSampleEnd) && doSampleSwap)
-			{
-				// ProTracker compatibility: Instrument changes without a note do not happen instantly, but rather when the sample loop has finished playing.
-				// Test case: PTInstrSwap.mod, PTSwapNoLoop.mod
+		const bool pastLoopEnd = chn.position.GetUInt() >= chn.nLoopEnd && chn.dwFlags[CHN_LOOP];
+		const bool pastSampleEnd = chn.position.GetUInt() >= chn.nLength && !chn.dwFlags[CHN_LOOP] && chn.nLength && !chn.nMasterChn;
+		const bool doSampleSwap = m_playBehaviour[kMODSampleSwap] && chn.nNewIns && chn.nNewIns <= GetNumSamples() && chn.pModSample != &Samples[chn.nNewIns];
+		if((pastLoopEnd || pastSampleEnd) && doSampleSwap)
+		{
+			// ProTracker compatibility: Instrument changes without a note do not happen instantly, but rather when the sample loop has finished playing.
+			// Test case: PTInstrSwap.mod, PTSwapNoLoop.mod
 #ifdef MODPLUG_TRACKER
-				if(m_SamplePlayLengths != nullptr)
+			if(m_SamplePlayLengths != nullptr)
+			{
+				// Even if the sample was playing at zero volume, we need to retain its full length for correct sample swap timing
+				size_t smp = std::distance(static_cast<const ModSample *>(static_cast<std::decay<decltype(Samples)>::type>(Samples)), chn.pModSample);
+				if(smp < m_SamplePlayLengths->size())
 				{
-					// Even if the sample was playing at zero volume, we need to retain its full length for correct sample swap timing
-					size_t smp = std::distance(static_cast<const ModSample *>(static_cast<std::decay<decltype(Samples)>::type>(Samples)), chn.pModSample);
-					if(smp < m_SamplePlayLengths->size())
-					{
-						(*m_SamplePlayLengths)[smp] = std::max((*m_SamplePlayLengths)[smp], std::min(chn.nLength, chn.position.GetUInt()));
-					}
+					(*m_SamplePlayLengths)[smp] = std::max((*m_SamplePlayLengths)[smp], std::min(chn.nLength, chn.position.GetUInt()));
 				}
+			}
 #endif
-				const ModSample &smp = Samples[chn.nNewIns];
-				chn.pModSample = &smp;
-				chn.pCurrentSample = smp.samplev();
-				chn.dwFlags = (chn.dwFlags & CHN_CHANNELFLAGS) | smp.uFlags;
-				chn.nLength = smp.uFlags[CHN_LOOP] ? smp.nLoopEnd : 0; // non-looping sample continue in oneshot mode (i.e. they will most probably just play silence)
-				chn.nLoopStart = smp.nLoopStart;
-				chn.nLoopEnd = smp.nLoopEnd;
-				chn.position.SetInt(chn.nLoopStart);
-				mixLoopState.UpdateLookaheadPointers(chn);
-				if(!chn.pCurrentSample)
-				{
-					break;
-				}
-			} else if(pastLoopEnd && !doSampleSwap && m_playBehaviour[kMODOneShotLoops] && chn.nLoopStart == 0)
+			const ModSample &smp = Samples[chn.nNewIns];
+			chn.pModSample = &smp;
+			chn.pCurrentSample = smp.samplev();
+			chn.dwFlags = (chn.dwFlags & CHN_CHANNELFLAGS) | smp.uFlags;
+			chn.nLength = smp.uFlags[CHN_LOOP] ? smp.nLoopEnd : 0; // non-looping sample continue in oneshot mode (i.e. they will most probably just play silence)
+			chn.nLoopStart = smp.nLoopStart;
+			chn.nLoopEnd = smp.nLoopEnd;
+			chn.position.SetInt(chn.nLoopStart);
+			mixLoopState.UpdateLookaheadPointers(chn);
+			pyramidLevel = 0;
+			if(!chn.pCurrentSample)
 			{
-				// ProTracker "oneshot" loops (if loop start is 0, play the whole sample once and then repeat until loop end)
-				chn.position.SetInt(0);
-				chn.nLoopEnd = chn.nLength = chn.pModSample->nLoopEnd;
+				break;
 			}
-		} while(nsamples > 0);
-
-		// Restore sample pointer in case it got changed through loop wrap-around
-		chn.pCurrentSample = mixLoopState.samplePointer;
-		nchmixed += naddmix;
-	
-#ifndef NO_PLUGINS
-		if(naddmix && nMixPlugin > 0 && nMixPlugin <= MAX_MIXPLUGINS && m_MixPlugins[nMixPlugin - 1].pMixPlugin)
+		} else if(pastLoopEnd && !doSampleSwap && m_playBehaviour[kMODOneShotLoops] && chn.nLoopStart == 0)
 		{
-			m_MixPlugins[nMixPlugin - 1].pMixPlugin->ResetSilence();
+			// ProTracker "oneshot" loops (if loop start is 0, play the whole sample once and then repeat until loop end)
+			chn.position.SetInt(0);
+			chn.nLoopEnd = chn.nLength = chn.pModSample->nLoopEnd;
+			pyramidLevel = 0;
 		}
-#endif // NO_PLUGINS
-	}
-	m_nMixStat = std::max(m_nMixStat, nchmixed);
+	} while(nsamples > 0);
+
+	// Restore sample pointer in case it got changed through loop wrap-around
+	chn.pCurrentSample = mixLoopState.samplePointer;
+	return naddmix;
 }
 
 
-void CSoundFile::ProcessPlugins(uint32 nCount)
+void CSoundFile::ProcessPlugins(uint32 nCount, bool floatMix)
 {
 #ifndef NO_PLUGINS
 	// If any sample channels are active or any plugin has some input, possibly suspended master plugins need to be woken up.
@@ -597,12 +812,15 @@ void CSoundFile::ProcessPlugins(uint32 nCount)
 			}
 		}
 	}
-	// Convert mix buffer
+	// Convert mix buffer (with SNDMIX_FLOATMIX, the master mix is already in MixFloatBuffer)
+	if(!floatMix)
+	{
 #ifdef MPT_INTMIXER
-	StereoMixToFloat(MixSoundBuffer, MixFloatBuffer[0], MixFloatBuffer[1], nCount, IntToFloat);
+		StereoMixToFloat(MixSoundBuffer, MixFloatBuffer[0], MixFloatBuffer[1], nCount, IntToFloat);
 #else
-	DeinterleaveStereo(MixSoundBuffer, MixFloatBuffer[0], MixFloatBuffer[1], nCount);
+		DeinterleaveStereo(MixSoundBuffer, MixFloatBuffer[0], MixFloatBuffer[1], nCount);
 #endif // MPT_INTMIXER
+	}
 	float *pMixL = MixFloatBuffer[0];
 	float *pMixR = MixFloatBuffer[1];
 
@@ -755,14 +973,25 @@ void CSoundFile::ProcessPlugins(uint32 nCount)
 			state.dwFlags &= ~SNDMIXPLUGINSTATE::psfHasInput;
 		}
 	}
+	if(floatMix)
+	{
+		if(pMixL != MixFloatBuffer[0])
+		{
+			std::copy(pMixL, pMixL + nCount, MixFloatBuffer[0]);
+			std::copy(pMixR, pMixR + nCount, MixFloatBuffer[1]);
+		}
+	} else
+	{
 #ifdef MPT_INTMIXER
-	FloatToStereoMix(pMixL, pMixR, MixSoundBuffer, nCount, FloatToInt);
+		FloatToStereoMix(pMixL, pMixR, MixSoundBuffer, nCount, FloatToInt);
 #else
-	InterleaveStereo(pMixL, pMixR, MixSoundBuffer, nCount);
+		InterleaveStereo(pMixL, pMixR, MixSoundBuffer, nCount);
 #endif // MPT_INTMIXER
+	}
 
 #else
 	MPT_UNREFERENCED_PARAMETER(nCount);
+	MPT_UNREFERENCED_PARAMETER(floatMix);
 #endif // NO_PLUGINS
 }
 
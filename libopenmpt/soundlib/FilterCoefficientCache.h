@@ -0,0 +1,77 @@
+/*
+ * FilterCoefficientCache.h
+ * ------------------------
+ * Purpose: Cache for the resonant filter coefficients computed by CSoundFile::SetupChannelFilter.
+ * Notes  : Filter envelopes and Zxx macros cause the coefficients of every filtered channel to be recomputed
+ *          on every tick, but a song only ever uses a small number of distinct cutoff / resonance combinations.
+ *          All inputs of the calculation are integers, so a cached entry is exactly what would be computed.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "../common/mptBaseTypes.h"
+
+#include <array>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+class FilterCoefficientCache
+{
+public:
+	struct Coefficients
+	{
+		float fg, fb0, fb1;
+	};
+
+	// cutoffProduct = cutoff * (envModifier + 256), in [0, 127 * 512]; resonance in [0, 127];
+	// variant describes the filter range and behaviour flags that the coefficients depend on (up to 3 bits).
+	static constexpr uint32 MakeKey(uint32 cutoffProduct, uint32 resonance, uint32 variant) noexcept
+	{
+		return cutoffProduct | (resonance << 16) | (variant << 23);
+	}
+
+	// Returns nullptr if the coefficients for this key are not cached. Entries for other mixing rates are discarded.
+	const Coefficients *Lookup(uint32 mixingRate, uint32 key) noexcept
+	{
+		if(mixingRate != m_mixingRate)
+		{
+			m_keys.fill(InvalidKey);
+			m_mixingRate = mixingRate;
+			return nullptr;
+		}
+		const std::size_t slot = Slot(key);
+		return (m_keys[slot] == key) ? &m_coefficients[slot] : nullptr;
+	}
+
+	// Must only be called after Lookup with the same mixing rate
+	void Insert(uint32 key, const Coefficients &coefficients) noexcept
+	{
+		const std::size_t slot = Slot(key);
+		m_keys[slot] = key;
+		m_coefficients[slot] = coefficients;
+	}
+
+private:
+	static constexpr std::size_t NumSlotsLog2 = 10;
+	static constexpr uint32 InvalidKey = uint32_max;
+
+	static constexpr std::size_t Slot(uint32 key) noexcept
+	{
+		// Fibonacci hashing, so that neighbouring cutoff values of an envelope end up in different slots
+		return static_cast<uint32>(key * 0x9E3779B1u) >> (32 - NumSlotsLog2);
+	}
+
+	uint32 m_mixingRate = 0;
+	std::array<uint32, std::size_t(1) << NumSlotsLog2> m_keys;
+	std::array<Coefficients, std::size_t(1) << NumSlotsLog2> m_coefficients;
+};
+
+
+OPENMPT_NAMESPACE_END
@@ -57,7 +57,7 @@ struct AmigaBlepInterpolation
 
 	MPT_FORCEINLINE AmigaBlepInterpolation(ModChannel &chn, const CResampler &resampler, unsigned int numSamples)
 		: paula{chn.paulaState}
-		, WinSincIntegral{resampler.blepTables.GetAmigaTable(resampler.m_Settings.emulateAmiga, chn.dwFlags[CHN_AMIGAFILTER])}
+		, WinSincIntegral{resampler.m_SincTables->blepTables.GetAmigaTable(resampler.m_Settings.emulateAmiga, chn.dwFlags[CHN_AMIGAFILTER])}
 		, numSteps{chn.paulaState.numSteps}
 	{
 		if(numSteps)
@@ -169,7 +169,7 @@ struct PolyphaseInterpolation
 			MPT_UNREFERENCED_PARAMETER(resampler);
 		#endif // MODPLUG_TRACKER
 		sinc = (((chn.increment > SamplePosition(0x130000000ll)) || (chn.increment < SamplePosition(-0x130000000ll))) ?
-			(((chn.increment > SamplePosition(0x180000000ll)) || (chn.increment < SamplePosition(-0x180000000ll))) ? resampler.gDownsample2x : resampler.gDownsample13x) : resampler.gKaiserSinc);
+			(((chn.increment > SamplePosition(0x180000000ll)) || (chn.increment < SamplePosition(-0x180000000ll))) ? resampler.m_SincTables->gDownsample2x : resampler.m_SincTables->gDownsample13x) : resampler.m_SincTables->gKaiserSinc);
 	}
 
 	MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
@@ -200,7 +200,7 @@ struct FIRFilterInterpolation
 
 	MPT_FORCEINLINE FIRFilterInterpolation(const ModChannel &, const CResampler &resampler, unsigned int)
 	{
-		WFIRlut = resampler.m_WindowedFIR.lut;
+		WFIRlut = resampler.m_WindowedFIR->lut;
 	}
 
 	MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
@@ -0,0 +1,398 @@
+/*
+ * IntMixerSIMD.h
+ * --------------
+ * Purpose: SSE4.1 / AVX2 variants of the fixed point interpolation and filter classes
+ * Notes  : All variants produce exactly the same output as their scalar counterparts in IntMixer.h.
+ *          The 16-bit products and their 32-bit sums are computed with madd, which wraps around
+ *          just like the scalar integer arithmetic does. Divisions by powers of two round towards zero
+ *          like the scalar code does.
+ *          Everything in here must only be called after checking the CPU features, see MixFuncTable.cpp.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "IntMixer.h"
+#include "../common/mptCPU.h"
+
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+#include <immintrin.h>
+#endif
+
+#include <cstring>
+#include <type_traits>
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+
+namespace SIMD
+{
+
+// The sampling points are converted to the 16-bit mix precision (see IntToIntTraits) while loading.
+template<class Traits>
+static constexpr int ConvertShift = 16 - static_cast<int>(sizeof(typename Traits::input_t)) * 8;
+
+template<class Traits>
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE __m128i Load4SSE4(const typename Traits::input_t *p)
+{
+	static_assert(Traits::Convert(1) == (1 << ConvertShift<Traits>));
+	if constexpr(sizeof(typename Traits::input_t) == 1)
+	{
+		int32 v;
+		std::memcpy(&v, p, 4);
+		return _mm_slli_epi16(_mm_cvtepi8_epi16(_mm_cvtsi32_si128(v)), ConvertShift<Traits>);
+	} else
+	{
+		return _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+	}
+}
+
+template<class Traits>
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE __m128i Load8SSE4(const typename Traits::input_t *p)
+{
+	static_assert(Traits::Convert(1) == (1 << ConvertShift<Traits>));
+	if constexpr(sizeof(typename Traits::input_t) == 1)
+		return _mm_slli_epi16(_mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))), ConvertShift<Traits>);
+	else
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// [L0 R0 L1 R1 L2 R2 L3 R3] -> [L0 L1 R0 R1 L2 L3 R2 R3], so that madd sums up two taps of the same channel
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE __m128i PairChannelsSSE4(__m128i x)
+{
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+// Same as x / (1 << shift) for each signed 32-bit element
+template<int shift>
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE __m128i DivPow2SSE4(__m128i x)
+{
+	const __m128i bias = _mm_srli_epi32(_mm_srai_epi32(x, 31), 32 - shift);
+	return _mm_srai_epi32(_mm_add_epi32(x, bias), shift);
+}
+
+template<class Traits>
+static MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE void StoreStereoSSE4(typename Traits::outbuf_t &outSample, __m128i x)
+{
+	outSample[0] = _mm_cvtsi128_si32(x);
+	outSample[1] = _mm_extract_epi32(x, 1);
+}
+
+} // namespace SIMD
+
+
+//////////////////////////////////////////////////////////////////////////
+// SSE4.1 interpolation templates
+
+template<class Traits>
+struct LinearInterpolationSSE4 : public LinearInterpolation<Traits>
+{
+	using LinearInterpolation<Traits>::LinearInterpolation;
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
+	{
+		if constexpr(Traits::numChannelsIn == 1)
+		{
+			// A single multiplication, nothing to gain here
+			LinearInterpolation<Traits>::operator()(outSample, inBuffer, posLo);
+		} else
+		{
+			const __m128i fract = _mm_set1_epi32(static_cast<int32>(posLo >> 18u));
+			const __m128i vol = _mm_cvtepi16_epi32(SIMD::Load4SSE4<Traits>(inBuffer));  // [srcL srcR destL destR]
+			const __m128i delta = _mm_mullo_epi32(fract, _mm_sub_epi32(_mm_srli_si128(vol, 8), vol));
+			SIMD::StoreStereoSSE4<Traits>(outSample, _mm_add_epi32(vol, SIMD::DivPow2SSE4<14>(delta)));
+		}
+	}
+};
+
+
+template<class Traits>
+struct FastSincInterpolationSSE4 : public FastSincInterpolation<Traits>
+{
+	using FastSincInterpolation<Traits>::FastSincInterpolation;
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
+	{
+		const __m128i lut = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(CResampler::FastSincTable + ((posLo >> 22) & 0x3FC)));
+
+		if constexpr(Traits::numChannelsIn == 1)
+		{
+			__m128i sum = _mm_madd_epi16(SIMD::Load4SSE4<Traits>(inBuffer - 1), lut);
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+			outSample[0] = _mm_cvtsi128_si32(sum) / 16384;
+		} else
+		{
+			const __m128i samples = SIMD::PairChannelsSSE4(SIMD::Load8SSE4<Traits>(inBuffer - 2));
+			__m128i sum = _mm_madd_epi16(samples, _mm_shuffle_epi32(lut, _MM_SHUFFLE(1, 1, 0, 0)));
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+			SIMD::StoreStereoSSE4<Traits>(outSample, SIMD::DivPow2SSE4<14>(sum));
+		}
+	}
+};
+
+
+template<class Traits>
+struct PolyphaseInterpolationSSE4 : public PolyphaseInterpolation<Traits>
+{
+	using PolyphaseInterpolation<Traits>::PolyphaseInterpolation;
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
+	{
+		const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i *>(this->sinc + ((posLo >> (32 - SINC_PHASES_BITS)) & SINC_MASK) * SINC_WIDTH));
+
+		if constexpr(Traits::numChannelsIn == 1)
+		{
+			__m128i sum = _mm_madd_epi16(SIMD::Load8SSE4<Traits>(inBuffer - 3), lut);
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+			outSample[0] = _mm_cvtsi128_si32(sum) / (1 << SINC_QUANTSHIFT);
+		} else
+		{
+			const __m128i samplesLo = SIMD::PairChannelsSSE4(SIMD::Load8SSE4<Traits>(inBuffer - 6));
+			const __m128i samplesHi = SIMD::PairChannelsSSE4(SIMD::Load8SSE4<Traits>(inBuffer + 2));
+			__m128i sum = _mm_add_epi32(
+				_mm_madd_epi16(samplesLo, _mm_shuffle_epi32(lut, _MM_SHUFFLE(1, 1, 0, 0))),
+				_mm_madd_epi16(samplesHi, _mm_shuffle_epi32(lut, _MM_SHUFFLE(3, 3, 2, 2))));
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+			SIMD::StoreStereoSSE4<Traits>(outSample, SIMD::DivPow2SSE4<SINC_QUANTSHIFT>(sum));
+		}
+	}
+};
+
+
+template<class Traits>
+struct FIRFilterInterpolationSSE4 : public FIRFilterInterpolation<Traits>
+{
+	using FIRFilterInterpolation<Traits>::FIRFilterInterpolation;
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
+	{
+		const __m128i lut = _mm_loadu_si128(reinterpret_cast<const __m128i *>(this->WFIRlut + ((((posLo >> 16) + WFIR_FRACHALVE) >> WFIR_FRACSHIFT) & WFIR_FRACMASK)));
+
+		if constexpr(Traits::numChannelsIn == 1)
+		{
+			__m128i sum = _mm_madd_epi16(SIMD::Load8SSE4<Traits>(inBuffer - 3), lut);
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+			const int32 vol1 = _mm_cvtsi128_si32(sum), vol2 = _mm_extract_epi32(sum, 2);
+			outSample[0] = ((vol1 / 2) + (vol2 / 2)) / (1 << (WFIR_16BITSHIFT - 1));
+		} else
+		{
+			const __m128i samplesLo = SIMD::PairChannelsSSE4(SIMD::Load8SSE4<Traits>(inBuffer - 6));
+			const __m128i samplesHi = SIMD::PairChannelsSSE4(SIMD::Load8SSE4<Traits>(inBuffer + 2));
+			__m128i vol1 = _mm_madd_epi16(samplesLo, _mm_shuffle_epi32(lut, _MM_SHUFFLE(1, 1, 0, 0)));
+			__m128i vol2 = _mm_madd_epi16(samplesHi, _mm_shuffle_epi32(lut, _MM_SHUFFLE(3, 3, 2, 2)));
+			vol1 = SIMD::DivPow2SSE4<1>(_mm_add_epi32(vol1, _mm_srli_si128(vol1, 8)));
+			vol2 = SIMD::DivPow2SSE4<1>(_mm_add_epi32(vol2, _mm_srli_si128(vol2, 8)));
+			SIMD::StoreStereoSSE4<Traits>(outSample, SIMD::DivPow2SSE4<WFIR_16BITSHIFT - 1>(_mm_add_epi32(vol1, vol2)));
+		}
+	}
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// SSE4.1 filter templates
+
+// The filter is recursive, so consecutive samples cannot be computed in parallel without changing the result.
+// Instead, both channels of a stereo sample are filtered at once, in the even 32-bit lanes so that
+// pmuldq can compute the 64-bit products. The filter history and coefficients stay in registers for the whole loop.
+template<class Traits>
+struct ResonantFilterStereoSSE4
+{
+	static_assert(Traits::numChannelsIn == 2);
+	static_assert(std::is_same<typename Traits::output_t, int32>::value);
+
+	ModChannel &channel;
+	// Filter history [L - R -]
+	__m128i fy0, fy1;
+	__m128i a0, b0, b1, hp;
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE ResonantFilterStereoSSE4(ModChannel &chn)
+		: channel{chn}
+		, fy0{_mm_setr_epi32(chn.nFilter_Y[0][0], 0, chn.nFilter_Y[1][0], 0)}
+		, fy1{_mm_setr_epi32(chn.nFilter_Y[0][1], 0, chn.nFilter_Y[1][1], 0)}
+		, a0{_mm_set1_epi32(chn.nFilter_A0)}
+		, b0{_mm_set1_epi32(chn.nFilter_B0)}
+		, b1{_mm_set1_epi32(chn.nFilter_B1)}
+		, hp{_mm_set1_epi32(chn.nFilter_HP)}
+	{ }
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE ~ResonantFilterStereoSSE4()
+	{
+		channel.nFilter_Y[0][0] = _mm_cvtsi128_si32(fy0);
+		channel.nFilter_Y[1][0] = _mm_extract_epi32(fy0, 2);
+		channel.nFilter_Y[0][1] = _mm_cvtsi128_si32(fy1);
+		channel.nFilter_Y[1][1] = _mm_extract_epi32(fy1, 2);
+	}
+
+	MPT_ARCH_TARGET_SSE4 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const ModChannel &)
+	{
+		const __m128i clipMin = _mm_set1_epi32(int16_min * 2 * MIXING_FILTER_PREAMP), clipMax = _mm_set1_epi32(int16_max * 2 * MIXING_FILTER_PREAMP);
+		const __m128i inputAmp = _mm_slli_epi32(_mm_setr_epi32(outSample[0], 0, outSample[1], 0), 8);
+		static_assert(MIXING_FILTER_PREAMP == (1 << 8));
+		// The low 32 bits of a logical and an arithmetic shift are the same, and only those are kept
+		__m128i sum = _mm_add_epi64(_mm_mul_epi32(inputAmp, a0), _mm_set1_epi64x(1 << (MIXING_FILTER_PRECISION - 1)));
+		sum = _mm_add_epi64(sum, _mm_mul_epi32(_mm_min_epi32(_mm_max_epi32(fy1, clipMin), clipMax), b1));
+		sum = _mm_add_epi64(sum, _mm_mul_epi32(_mm_min_epi32(_mm_max_epi32(fy0, clipMin), clipMax), b0));
+		const __m128i val = _mm_srli_epi64(sum, MIXING_FILTER_PRECISION);
+		fy1 = fy0;
+		fy0 = _mm_sub_epi32(val, _mm_and_si128(inputAmp, hp));
+		const __m128i out = SIMD::DivPow2SSE4<8>(val);
+		outSample[0] = _mm_cvtsi128_si32(out);
+		outSample[1] = _mm_extract_epi32(out, 2);
+	}
+};
+
+template<class Traits>
+using ResonantFilterSSE4 = std::conditional_t<Traits::numChannelsIn == 2, ResonantFilterStereoSSE4<Traits>, ResonantFilter<Traits>>;
+
+
+// Same as SampleLoop in MixerInterface.h, but compiled for SSE4.1 so that the interpolation functors can be inlined
+template<class Traits, class InterpolationFunc, class FilterFunc, class MixFunc>
+static MPT_ARCH_TARGET_SSE4 void SampleLoopSSE4(ModChannel &chn, const CResampler &resampler, typename Traits::output_t * MPT_RESTRICT outBuffer, unsigned int numSamples)
+{
+	ModChannel &c = chn;
+	const typename Traits::input_t * MPT_RESTRICT inSample = static_cast<const typename Traits::input_t *>(c.pCurrentSample);
+
+	InterpolationFunc interpolate{c, resampler, numSamples};
+	FilterFunc filter{c};
+	MixFunc mix{c};
+
+	unsigned int samples = numSamples;
+	SamplePosition smpPos = c.position;            // Fixed-point sample position
+	const SamplePosition increment = c.increment;  // Fixed-point sample increment
+
+	while(samples--)
+	{
+		typename Traits::outbuf_t outSample;
+		interpolate(outSample, inSample + smpPos.GetInt() * Traits::numChannelsIn, smpPos.GetFract());
+		filter(outSample, c);
+		mix(outSample, c, outBuffer);
+		outBuffer += Traits::numChannelsOut;
+
+		smpPos += increment;
+	}
+
+	c.position = smpPos;
+}
+
+#endif // MPT_ENABLE_ARCH_INTRINSICS_SSE4
+
+
+#if defined(MPT_ENABLE_ARCH_INTRINSICS_AVX2)
+
+namespace SIMD
+{
+
+template<class Traits>
+static MPT_ARCH_TARGET_AVX2 MPT_FORCEINLINE __m256i Load16AVX2(const typename Traits::input_t *p)
+{
+	static_assert(Traits::Convert(1) == (1 << ConvertShift<Traits>));
+	if constexpr(sizeof(typename Traits::input_t) == 1)
+		return _mm256_slli_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))), ConvertShift<Traits>);
+	else
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+// Loads all 16 sampling points of a stereo 8-tap filter into one register, paired up like PairChannelsSSE4,
+// and multiplies them with the coefficients: [L01 R01 L23 R23 | L45 R45 L67 R67]
+template<class Traits>
+static MPT_ARCH_TARGET_AVX2 MPT_FORCEINLINE __m256i MulStereo8TapAVX2(const typename Traits::input_t *inBuffer, const int16 *lut)
+{
+	__m256i samples = Load16AVX2<Traits>(inBuffer - 6);
+	samples = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(samples, _MM_SHUFFLE(3, 1, 2, 0)), _MM_SHUFFLE(3, 1, 2, 0));
+	const __m256i coeffs = _mm256_permutevar8x32_epi32(
+		_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lut))),
+		_mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+	return _mm256_madd_epi16(samples, coeffs);
+}
+
+} // namespace SIMD
+
+
+//////////////////////////////////////////////////////////////////////////
+// AVX2 interpolation templates
+// With only eight taps, there is nothing to gain for mono samples or smaller filters, so those use the SSE4.1 code.
+
+template<class Traits>
+struct PolyphaseInterpolationAVX2 : public PolyphaseInterpolationSSE4<Traits>
+{
+	using PolyphaseInterpolationSSE4<Traits>::PolyphaseInterpolationSSE4;
+
+	MPT_ARCH_TARGET_AVX2 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
+	{
+		if constexpr(Traits::numChannelsIn == 1)
+		{
+			PolyphaseInterpolationSSE4<Traits>::operator()(outSample, inBuffer, posLo);
+		} else
+		{
+			const __m256i products = SIMD::MulStereo8TapAVX2<Traits>(inBuffer, this->sinc + ((posLo >> (32 - SINC_PHASES_BITS)) & SINC_MASK) * SINC_WIDTH);
+			__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(products), _mm256_extracti128_si256(products, 1));
+			sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+			SIMD::StoreStereoSSE4<Traits>(outSample, SIMD::DivPow2SSE4<SINC_QUANTSHIFT>(sum));
+		}
+	}
+};
+
+
+template<class Traits>
+struct FIRFilterInterpolationAVX2 : public FIRFilterInterpolationSSE4<Traits>
+{
+	using FIRFilterInterpolationSSE4<Traits>::FIRFilterInterpolationSSE4;
+
+	MPT_ARCH_TARGET_AVX2 MPT_FORCEINLINE void operator() (typename Traits::outbuf_t &outSample, const typename Traits::input_t * const MPT_RESTRICT inBuffer, const uint32 posLo)
+	{
+		if constexpr(Traits::numChannelsIn == 1)
+		{
+			FIRFilterInterpolationSSE4<Traits>::operator()(outSample, inBuffer, posLo);
+		} else
+		{
+			const __m256i products = SIMD::MulStereo8TapAVX2<Traits>(inBuffer, this->WFIRlut + ((((posLo >> 16) + WFIR_FRACHALVE) >> WFIR_FRACSHIFT) & WFIR_FRACMASK));
+			__m128i vol1 = _mm256_castsi256_si128(products);
+			__m128i vol2 = _mm256_extracti128_si256(products, 1);
+			vol1 = SIMD::DivPow2SSE4<1>(_mm_add_epi32(vol1, _mm_srli_si128(vol1, 8)));
+			vol2 = SIMD::DivPow2SSE4<1>(_mm_add_epi32(vol2, _mm_srli_si128(vol2, 8)));
+			SIMD::StoreStereoSSE4<Traits>(outSample, SIMD::DivPow2SSE4<WFIR_16BITSHIFT - 1>(_mm_add_epi32(vol1, vol2)));
+		}
+	}
+};
+
+
+// Same as SampleLoop in MixerInterface.h, but compiled for AVX2 so that the interpolation functors can be inlined
+template<class Traits, class InterpolationFunc, class FilterFunc, class MixFunc>
+static MPT_ARCH_TARGET_AVX2 void SampleLoopAVX2(ModChannel &chn, const CResampler &resampler, typename Traits::output_t * MPT_RESTRICT outBuffer, unsigned int numSamples)
+{
+	ModChannel &c = chn;
+	const typename Traits::input_t * MPT_RESTRICT inSample = static_cast<const typename Traits::input_t *>(c.pCurrentSample);
+
+	InterpolationFunc interpolate{c, resampler, numSamples};
+	FilterFunc filter{c};
+	MixFunc mix{c};
+
+	unsigned int samples = numSamples;
+	SamplePosition smpPos = c.position;            // Fixed-point sample position
+	const SamplePosition increment = c.increment;  // Fixed-point sample increment
+
+	while(samples--)
+	{
+		typename Traits::outbuf_t outSample;
+		interpolate(outSample, inSample + smpPos.GetInt() * Traits::numChannelsIn, smpPos.GetFract());
+		filter(outSample, c);
+		mix(outSample, c, outBuffer);
+		outBuffer += Traits::numChannelsOut;
+
+		smpPos += increment;
+	}
+
+	c.position = smpPos;
+}
+
+#endif // MPT_ENABLE_ARCH_INTRINSICS_AVX2
+
+
+OPENMPT_NAMESPACE_END
@@ -398,4 +398,83 @@ void MIDIMacroConfig::Macro::UpgradeLegacyMacro() noexcept
 }
 
 
+void MIDIMacroProgram::Compile(const MIDIMacroConfigData::Macro &macro) noexcept
+{
+	// Whether the output position is known to be at a byte boundary (no pending nibble) or in the middle of a byte when reaching an op.
+	// This cannot be known after a checksum that follows a pending nibble, as the checksum is only emitted if there is a valid SysEx header.
+	enum class Alignment { Byte, Nibble, Unknown };
+	Alignment alignment = Alignment::Byte;
+
+	m_numOps = 0;
+	for(const char c : mpt::span<const char>(macro))
+	{
+		Op op;
+		bool isNibble = false;
+		if(c >= '0' && c <= '9')
+		{
+			op = {OpCode::ConstNibble, static_cast<uint8>(c - '0')};
+			isNibble = true;
+		} else if(c >= 'A' && c <= 'F')
+		{
+			op = {OpCode::ConstNibble, static_cast<uint8>(c - 'A' + 0x0A)};
+			isNibble = true;
+		} else
+		{
+			switch(c)
+			{
+			case 'c': op.code = OpCode::Channel; isNibble = true; break;
+			case 'n': op.code = OpCode::Note; break;
+			case 'v': op.code = OpCode::Velocity; break;
+			case 'u': op.code = OpCode::CalcVolume; break;
+			case 'x': op.code = OpCode::Pan; break;
+			case 'y': op.code = OpCode::CalcPan; break;
+			case 'a': op.code = OpCode::BankHigh; break;
+			case 'b': op.code = OpCode::BankLow; break;
+			case 'o': op.code = OpCode::Offset; break;
+			case 'h': op.code = OpCode::HostChannel; break;
+			case 'm': op.code = OpCode::LoopDirection; break;
+			case 'p': op.code = OpCode::Program; break;
+			case 'z': op.code = OpCode::Param; break;
+			case 's': op.code = OpCode::Checksum; break;
+			default: continue;  // Unrecognized byte (e.g. space char)
+			}
+		}
+
+		if(isNibble)
+		{
+			if(op.code == OpCode::ConstNibble && alignment == Alignment::Nibble && m_ops[m_numOps - 1].code == OpCode::ConstNibble)
+			{
+				// Two hex digits starting at a byte boundary
+				m_ops[m_numOps - 1] = {OpCode::ConstByte, static_cast<uint8>((m_ops[m_numOps - 1].value << 4) | op.value)};
+				alignment = Alignment::Byte;
+				continue;
+			}
+			if(alignment != Alignment::Unknown)
+				alignment = (alignment == Alignment::Byte) ? Alignment::Nibble : Alignment::Byte;
+		} else if(op.code == OpCode::Checksum)
+		{
+			if(alignment != Alignment::Byte)
+				alignment = Alignment::Unknown;
+		} else
+		{
+			alignment = Alignment::Byte;
+		}
+		m_ops[m_numOps++] = op;
+	}
+}
+
+
+void MIDIMacroPrograms::Compile(const MIDIMacroConfigData &config) noexcept
+{
+	for(size_t i = 0; i < SFx.size(); i++)
+	{
+		SFx[i].Compile(config.SFx[i]);
+	}
+	for(size_t i = 0; i < Zxx.size(); i++)
+	{
+		Zxx[i].Compile(config.Zxx[i]);
+	}
+}
+
+
 OPENMPT_NAMESPACE_END
@@ -227,4 +227,61 @@ public:
 static_assert(sizeof(MIDIMacroConfig) == sizeof(MIDIMacroConfigData)); // this is directly written to files, so the size must be correct!
 
 
+// A macro string translated into a sequence of operations, so that the mixer does not need to parse the string again every time the macro is sent.
+// Characters without meaning (e.g. spaces) are dropped, and pairs of hex digits that are known to form a complete byte are merged.
+class MIDIMacroProgram
+{
+public:
+	enum class OpCode : uint8
+	{
+		ConstByte,      // Complete byte, only emitted where no nibble is pending
+		ConstNibble,    // Hex digit
+		Channel,        // c: MIDI channel (nibble)
+		Note,           // n: Last triggered note
+		Velocity,       // v: Velocity
+		CalcVolume,     // u: Calculated volume
+		Pan,            // x: Pan set
+		CalcPan,        // y: Calculated pan
+		BankHigh,       // a: High byte of bank select
+		BankLow,        // b: Low byte of bank select
+		Offset,         // o: Sample offset
+		HostChannel,    // h: Host channel number
+		LoopDirection,  // m: Loop direction
+		Program,        // p: Program select
+		Param,          // z: Zxx parameter
+		Checksum,       // s: SysEx checksum
+	};
+
+	struct Op
+	{
+		OpCode code = OpCode::ConstByte;
+		uint8 value = 0;
+	};
+
+	// Maximum number of bytes a macro can evaluate to, including a terminating SysEx byte that may have to be inserted
+	static constexpr size_t MaxOutputLength = kMacroLength + 1;
+
+	MIDIMacroProgram() = default;
+	explicit MIDIMacroProgram(const MIDIMacroConfigData::Macro &macro) noexcept { Compile(macro); }
+
+	void Compile(const MIDIMacroConfigData::Macro &macro) noexcept;
+
+	mpt::span<const Op> Ops() const noexcept { return {m_ops.data(), m_numOps}; }
+
+private:
+	std::array<Op, kMacroLength> m_ops;
+	uint8 m_numOps = 0;
+};
+
+
+// Compiled versions of all macros that can be triggered from pattern data
+struct MIDIMacroPrograms
+{
+	std::array<MIDIMacroProgram, kSFxMacros> SFx;
+	std::array<MIDIMacroProgram, kZxxMacros> Zxx;
+
+	void Compile(const MIDIMacroConfigData &config) noexcept;
+};
+
+
 OPENMPT_NAMESPACE_END
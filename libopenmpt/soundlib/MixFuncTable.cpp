@@ -20,6 +20,7 @@
 
 #ifdef MPT_INTMIXER
 #include "IntMixer.h"
+#include "IntMixerSIMD.h"
 #else
 #include "FloatMixer.h"
 #endif // MPT_INTMIXER
@@ -40,38 +41,88 @@ using I8S = Int8SToFloatS;
 using I16S = Int16SToFloatS;
 #endif // MPT_INTMIXER
 
-// Build mix function table for given resampling, filter and ramping settings: One function each for 8-Bit / 16-Bit Mono / Stereo
-#define BuildMixFuncTableRamp(resampling, filter, ramp) \
-	SampleLoop<I8M, resampling<I8M>, filter<I8M>, MixMono ## ramp<I8M> >, \
-	SampleLoop<I16M, resampling<I16M>, filter<I16M>, MixMono ## ramp<I16M> >, \
-	SampleLoop<I8S, resampling<I8S>, filter<I8S>, MixStereo ## ramp<I8S> >, \
-	SampleLoop<I16S, resampling<I16S>, filter<I16S>, MixStereo ## ramp<I16S> >
+// Build mix function table for given sample loop, resampling, filter and ramping settings: One function each for 8-Bit / 16-Bit Mono / Stereo
+#define BuildMixFuncTableRamp(loop, resampling, filter, ramp) \
+	loop<I8M, resampling<I8M>, filter<I8M>, MixMono ## ramp<I8M> >, \
+	loop<I16M, resampling<I16M>, filter<I16M>, MixMono ## ramp<I16M> >, \
+	loop<I8S, resampling<I8S>, filter<I8S>, MixStereo ## ramp<I8S> >, \
+	loop<I16S, resampling<I16S>, filter<I16S>, MixStereo ## ramp<I16S> >
 
-// Build mix function table for given resampling, filter settings: With and without ramping
-#define BuildMixFuncTableFilter(resampling, filter) \
-	BuildMixFuncTableRamp(resampling, filter, NoRamp), \
-	BuildMixFuncTableRamp(resampling, filter, Ramp)
+// Build mix function table for given sample loop, resampling, filter settings: With and without ramping
+#define BuildMixFuncTableFilter(loop, resampling, filter) \
+	BuildMixFuncTableRamp(loop, resampling, filter, NoRamp), \
+	BuildMixFuncTableRamp(loop, resampling, filter, Ramp)
 
-// Build mix function table for given resampling settings: With and without filter
-#define BuildMixFuncTable(resampling) \
-	BuildMixFuncTableFilter(resampling, NoFilter), \
-	BuildMixFuncTableFilter(resampling, ResonantFilter)
+// Build mix function table for given sample loop, resampling and resonant filter implementation: With and without filter
+#define BuildMixFuncTableWithFilter(loop, resampling, filter) \
+	BuildMixFuncTableFilter(loop, resampling, NoFilter), \
+	BuildMixFuncTableFilter(loop, resampling, filter)
 
-const MixFuncInterface Functions[6 * 16] =
+// Build mix function table for given sample loop and resampling settings: With and without filter
+#define BuildMixFuncTable(loop, resampling) \
+	BuildMixFuncTableWithFilter(loop, resampling, ResonantFilter)
+
+static const MixFuncInterface FunctionsGeneric[6 * 16] =
+{
+	BuildMixFuncTable(SampleLoop, NoInterpolation),        // No SRC
+	BuildMixFuncTable(SampleLoop, LinearInterpolation),    // Linear SRC
+	BuildMixFuncTable(SampleLoop, FastSincInterpolation),  // Fast Sinc (Cubic Spline) SRC
+	BuildMixFuncTable(SampleLoop, PolyphaseInterpolation), // Kaiser SRC
+	BuildMixFuncTable(SampleLoop, FIRFilterInterpolation), // FIR SRC
+	BuildMixFuncTable(SampleLoop, AmigaBlepInterpolation), // Amiga emulation
+};
+
+#if defined(MPT_INTMIXER) && defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+static const MixFuncInterface FunctionsSSE4[6 * 16] =
+{
+	BuildMixFuncTable(SampleLoop, NoInterpolation),
+	BuildMixFuncTableWithFilter(SampleLoopSSE4, LinearInterpolationSSE4, ResonantFilterSSE4),
+	BuildMixFuncTableWithFilter(SampleLoopSSE4, FastSincInterpolationSSE4, ResonantFilterSSE4),
+	BuildMixFuncTableWithFilter(SampleLoopSSE4, PolyphaseInterpolationSSE4, ResonantFilterSSE4),
+	BuildMixFuncTableWithFilter(SampleLoopSSE4, FIRFilterInterpolationSSE4, ResonantFilterSSE4),
+	BuildMixFuncTable(SampleLoop, AmigaBlepInterpolation),
+};
+#endif // MPT_INTMIXER && MPT_ENABLE_ARCH_INTRINSICS_SSE4
+
+#if defined(MPT_INTMIXER) && defined(MPT_ENABLE_ARCH_INTRINSICS_AVX2)
+static const MixFuncInterface FunctionsAVX2[6 * 16] =
 {
-	BuildMixFuncTable(NoInterpolation),        // No SRC
-	BuildMixFuncTable(LinearInterpolation),    // Linear SRC
-	BuildMixFuncTable(FastSincInterpolation),  // Fast Sinc (Cubic Spline) SRC
-	BuildMixFuncTable(PolyphaseInterpolation), // Kaiser SRC
-	BuildMixFuncTable(FIRFilterInterpolation), // FIR SRC
-	BuildMixFuncTable(AmigaBlepInterpolation), // Amiga emulation
+	BuildMixFuncTable(SampleLoop, NoInterpolation),
+	BuildMixFuncTableWithFilter(SampleLoopAVX2, LinearInterpolationSSE4, ResonantFilterSSE4),
+	BuildMixFuncTableWithFilter(SampleLoopAVX2, FastSincInterpolationSSE4, ResonantFilterSSE4),
+	BuildMixFuncTableWithFilter(SampleLoopAVX2, PolyphaseInterpolationAVX2, ResonantFilterSSE4),
+	BuildMixFuncTableWithFilter(SampleLoopAVX2, FIRFilterInterpolationAVX2, ResonantFilterSSE4),
+	BuildMixFuncTable(SampleLoop, AmigaBlepInterpolation),
 };
+#endif // MPT_INTMIXER && MPT_ENABLE_ARCH_INTRINSICS_AVX2
 
 #undef BuildMixFuncTableRamp
 #undef BuildMixFuncTableFilter
+#undef BuildMixFuncTableWithFilter
 #undef BuildMixFuncTable
 
 
+static const MixFuncInterface *SelectFunctions()
+{
+#if defined(MPT_INTMIXER) && defined(MPT_ENABLE_ARCH_INTRINSICS_AVX2)
+	if(CPU::HasFeatureSet(CPU::feature::avx2) && CPU::HasModesEnabled(CPU::mode::ymm256avx))
+		return FunctionsAVX2;
+#endif
+#if defined(MPT_INTMIXER) && defined(MPT_ENABLE_ARCH_INTRINSICS_SSE4)
+	if(CPU::HasFeatureSet(CPU::feature::sse4_1) && CPU::HasModesEnabled(CPU::mode::xmm128sse))
+		return FunctionsSSE4;
+#endif
+	return FunctionsGeneric;
+}
+
+const MixFuncInterface *GetFunctions()
+{
+	// Not a global, as CPU feature detection might not have been set up during static initialization (see CPU::EnableAvailableFeatures)
+	static const MixFuncInterface * const functions = SelectFunctions();
+	return functions;
+}
+
+
 ResamplingIndex ResamplingModeToMixFlags(ResamplingMode resamplingMode)
 {
 	switch(resamplingMode)
@@ -44,7 +44,8 @@ namespace MixFuncTable
 		ndxAmigaBlep       = 0x50,
 	};
 
-	extern const MixFuncInterface Functions[6 * 16];
+	// Returns the 6 * 16 mix functions for the best instruction set supported by the CPU, chosen on first use
+	const MixFuncInterface *GetFunctions();
 
 	ResamplingIndex ResamplingModeToMixFlags(ResamplingMode resamplingMode);
 }
@@ -41,7 +41,11 @@ static_assert(MIXING_SCALEF == 134217728.0f);
 static_assert(sizeof(mixsample_t) == 4);
 #endif
 
+// Default number of frames rendered per mix block; see MixerSettings::m_nMixBlockSize
 #define MIXBUFFERSIZE 512
+// Allowed range for the mix block size (must be a power of two)
+#define MIXBUFFERSIZE_MIN 64
+#define MIXBUFFERSIZE_MAX 4096
 #define NUMMIXINPUTBUFFERS 4
 
 #define VOLUMERAMPPRECISION 12	// Fractional bits in volume ramp variables
@@ -70,6 +70,59 @@ void MonoFromStereo(mixsample_t *pMixBuf, uint32 nSamples)
 }
 
 
+// Same as above, for the non-interleaved floating point mix buffers. The result is written to pMixL.
+void MonoFromStereo(float *pMixL, const float *pMixR, uint32 nSamples)
+{
+	for(uint32 i=0; i<nSamples; ++i)
+	{
+		pMixL[i] = (pMixL[i] + pMixR[i]) * 0.5f;
+	}
+}
+
+
+// Interleave the non-interleaved floating point mix buffers into the mono or stereo output buffer
+void FloatToOutputMix(const float *pIn1, const float *pIn2, float *pOut, uint32 nChannels, uint32 nCount, const float gain)
+{
+	if(nChannels == 1)
+	{
+		for(uint32 i=0; i<nCount; ++i)
+		{
+			pOut[i] = pIn1[i] * gain;
+		}
+	} else
+	{
+		for(uint32 i=0; i<nCount; ++i)
+		{
+			pOut[i*2] = pIn1[i] * gain;
+			pOut[i*2+1] = pIn2[i] * gain;
+		}
+	}
+}
+
+
+
+// Add an interleaved stereo buffer to the interleaved mix buffer and to a pair of planar buffers
+void AddStereoMix(const mixsample_t *pSrc, mixsample_t *pMix, uint32 nFrames)
+{
+	for(uint32 i=0; i<nFrames*2; ++i)
+	{
+		pMix[i] += pSrc[i];
+	}
+}
+
+
+void AddStereoMixSplit(const mixsample_t *pSrc, mixsample_t *pMix, mixsample_t *pOut1, mixsample_t *pOut2, uint32 nFrames)
+{
+	for(uint32 i=0; i<nFrames; ++i)
+	{
+		pMix[i*2] += pSrc[i*2];
+		pMix[i*2+1] += pSrc[i*2+1];
+		pOut1[i] += pSrc[i*2];
+		pOut2[i] += pSrc[i*2+1];
+	}
+}
+
+
 
 #define OFSDECAYSHIFT	8
 #define OFSDECAYMASK	0xFF
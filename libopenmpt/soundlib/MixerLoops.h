@@ -24,12 +24,17 @@ void FloatToStereoMix(const float *pIn1, const float *pIn2, int32 *pOut, uint32
 void InitMixBuffer(mixsample_t *pBuffer, uint32 nSamples);
 void InterleaveFrontRear(mixsample_t *pFrontBuf, mixsample_t *pRearBuf, uint32 nFrames);
 void MonoFromStereo(mixsample_t *pMixBuf, uint32 nSamples);
+void MonoFromStereo(float *pMixL, const float *pMixR, uint32 nSamples);
+void FloatToOutputMix(const float *pIn1, const float *pIn2, float *pOut, uint32 nChannels, uint32 nCount, const float gain);
 
 #ifndef MPT_INTMIXER
 void InterleaveStereo(const mixsample_t * MPT_RESTRICT inputL, const mixsample_t * MPT_RESTRICT inputR, mixsample_t * MPT_RESTRICT output, size_t numSamples);
 void DeinterleaveStereo(const mixsample_t * MPT_RESTRICT input, mixsample_t * MPT_RESTRICT outputL, mixsample_t * MPT_RESTRICT outputR, size_t numSamples);
 #endif
 
+void AddStereoMix(const mixsample_t *pSrc, mixsample_t *pMix, uint32 nFrames);
+void AddStereoMixSplit(const mixsample_t *pSrc, mixsample_t *pMix, mixsample_t *pOut1, mixsample_t *pOut2, uint32 nFrames);
+
 void EndChannelOfs(ModChannel &chn, mixsample_t *pBuffer, uint32 nSamples);
 void StereoFill(mixsample_t *pBuffer, uint32 nSamples, mixsample_t &rofs, mixsample_t &lofs);
 
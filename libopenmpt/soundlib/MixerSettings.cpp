@@ -10,6 +10,7 @@
 #include "stdafx.h"
 #include "MixerSettings.h"
 #include "Snd_defs.h"
+#include "Mixer.h"
 #include "../common/misc_util.h"
 
 OPENMPT_NAMESPACE_BEGIN
@@ -35,6 +36,16 @@ MixerSettings::MixerSettings()
 
 	NumInputChannels = 0;
 
+	m_nMixThreads = 1;
+	m_nMixThreadsMinVoices = 64;
+
+	m_nMixBlockSize = MIXBUFFERSIZE;
+
+}
+
+bool MixerSettings::IsValidMixBlockSize(uint32 frames)
+{
+	return frames >= MIXBUFFERSIZE_MIN && frames <= MIXBUFFERSIZE_MAX && mpt::has_single_bit(frames);
 }
 
 int32 MixerSettings::GetVolumeRampUpSamples() const
@@ -29,6 +29,14 @@ struct MixerSettings
 	uint32 m_nPreAmp;
 	std::size_t NumInputChannels;
 
+	// Number of threads to mix voices on (1 = mix on the calling thread only)
+	uint32 m_nMixThreads;
+	// Voices are only distributed over threads if at least this many of them are active
+	uint32 m_nMixThreadsMinVoices;
+
+	// Maximum number of frames rendered in one go, determines the size of all mix buffers (power of two in [MIXBUFFERSIZE_MIN, MIXBUFFERSIZE_MAX])
+	uint32 m_nMixBlockSize;
+
 	int32 VolumeRampUpMicroseconds;
 	int32 VolumeRampDownMicroseconds;
 	int32 GetVolumeRampUpMicroseconds() const { return VolumeRampUpMicroseconds; }
@@ -44,9 +52,11 @@ struct MixerSettings
 	
 	bool IsValid() const
 	{
-		return (gdwMixingFreq > 0) && (gnChannels == 1 || gnChannels == 2 || gnChannels == 4) && (NumInputChannels == 0 || NumInputChannels == 1 || NumInputChannels == 2 || NumInputChannels == 4);
+		return (gdwMixingFreq > 0) && (gnChannels == 1 || gnChannels == 2 || gnChannels == 4) && (NumInputChannels == 0 || NumInputChannels == 1 || NumInputChannels == 2 || NumInputChannels == 4) && IsValidMixBlockSize(m_nMixBlockSize);
 	}
 	
+	static bool IsValidMixBlockSize(uint32 frames);
+
 	MixerSettings();
 
 };
@@ -19,6 +19,7 @@ OPENMPT_NAMESPACE_BEGIN
 // Convert envelope data between various formats.
 void InstrumentEnvelope::Convert(MODTYPE fromType, MODTYPE toType)
 {
+	ClearLookupTable();
 	if(!(fromType & MOD_TYPE_XM) && (toType & MOD_TYPE_XM))
 	{
 		// IT / MPTM -> XM: Expand loop by one tick, convert sustain loops to sustain points, remove carry flag.
@@ -73,8 +74,19 @@ int32 InstrumentEnvelope::GetValueFromPosition(int position, int32 rangeOut, int
 	if(empty())
 		return 0;
 
+	int32 value;
+	if(rangeIn == ENVELOPE_MAX && position >= 0 && !m_lookupTable.empty())
+		value = m_lookupTable[std::min(static_cast<size_t>(position), m_lookupTable.size() - 1u)];
+	else
+		value = GetPreciseValueFromPosition(position, rangeIn);
+
+	return (value * rangeOut + ENV_PRECISION / 2) / ENV_PRECISION;
+}
+
+
+int32 InstrumentEnvelope::GetPreciseValueFromPosition(int position, int32 rangeIn) const
+{
 	uint32 pt = size() - 1u;
-	const int32 ENV_PRECISION = 1 << 16;
 
 	// Checking where current 'tick' is relative to the envelope points.
 	for(uint32 i = 0; i < size() - 1u; i++)
@@ -114,12 +126,37 @@ int32 InstrumentEnvelope::GetValueFromPosition(int position, int32 rangeOut, int
 	}
 
 	Limit(value, int32(0), ENV_PRECISION);
-	return (value * rangeOut + ENV_PRECISION / 2) / ENV_PRECISION;
+	return value;
+}
+
+
+void InstrumentEnvelope::UpdateLookupTable()
+{
+	m_lookupTable.clear();
+	if(empty())
+		return;
+
+	// Past the node with the highest tick, the value of the last node is returned.
+	// Node ticks are not required to be sorted here, so that the table is exact for any envelope.
+	uint32 maxTick = 0;
+	for(const auto &node : *this)
+	{
+		maxTick = std::max(maxTick, static_cast<uint32>(node.tick));
+	}
+	if(maxTick + 2u > MAX_LOOKUP_TABLE_LENGTH)
+		return;
+
+	m_lookupTable.resize(maxTick + 2u);
+	for(uint32 tick = 0; tick < m_lookupTable.size(); tick++)
+	{
+		m_lookupTable[tick] = GetPreciseValueFromPosition(static_cast<int>(tick), ENVELOPE_MAX);
+	}
 }
 
 
 void InstrumentEnvelope::Sanitize(uint8 maxValue)
 {
+	ClearLookupTable();
 	if(!empty())
 	{
 		front().tick = 0;
@@ -59,10 +59,26 @@ struct InstrumentEnvelope : public std::vector<EnvelopeNode>
 	// Ensure that ticks are ordered in increasing order and values are within the allowed range.
 	void Sanitize(uint8 maxValue = ENVELOPE_MAX);
 
+	// Precompute the envelope value of every tick, so that GetValueFromPosition does not have to search and interpolate nodes.
+	// Must be called again after modifying the envelope, or the table must be discarded using ClearLookupTable().
+	void UpdateLookupTable();
+	void ClearLookupTable() { m_lookupTable.clear(); }
+
 	uint32 size() const { return static_cast<uint32>(std::vector<EnvelopeNode>::size()); }
 
 	using std::vector<EnvelopeNode>::push_back;
 	void push_back(EnvelopeNode::tick_t tick, EnvelopeNode::value_t value) { emplace_back(tick, value); }
+
+private:
+	static constexpr int32 ENV_PRECISION = 1 << 16;
+	// Longer envelopes are rare and are evaluated without lookup table to limit memory usage.
+	static constexpr uint32 MAX_LOOKUP_TABLE_LENGTH = 4096;
+
+	// Envelope value in range [0, ENV_PRECISION] for rangeIn = ENVELOPE_MAX
+	int32 GetPreciseValueFromPosition(int position, int32 rangeIn) const;
+
+	// Precise value of every tick up to one tick after the last node, after which the value no longer changes
+	std::vector<int32> m_lookupTable;
 };
 
 // Instrument Struct
@@ -192,6 +208,14 @@ struct ModInstrument
 	// Sanitize all instrument data.
 	void Sanitize(MODTYPE modType);
 
+	// Precompute the values of all envelopes for playback. Must be called again after editing any envelope.
+	void UpdateEnvelopeLookupTables()
+	{
+		VolEnv.UpdateLookupTable();
+		PanEnv.UpdateLookupTable();
+		PitchEnv.UpdateLookupTable();
+	}
+
 };
 
 OPENMPT_NAMESPACE_END
@@ -257,6 +257,7 @@ void ModSample::FreeSample()
 {
 	FreeSample(pData.pSample);
 	pData.pSample = nullptr;
+	pyramid.reset();
 }
 
 
@@ -434,6 +435,7 @@ void ModSample::PrecomputeLoops(CSoundFile &sndFile, bool updateChannels)
 		return;
 
 	SanitizeLoops();
+	pyramid.reset();
 
 	// Update channels with possibly changed loop values
 	if(updateChannels)
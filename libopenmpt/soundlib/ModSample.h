@@ -12,9 +12,12 @@
 
 #include "openmpt/all/BuildSettings.hpp"
 
+#include <memory>
+
 OPENMPT_NAMESPACE_BEGIN
 
 class CSoundFile;
+struct SamplePyramid;
 
 // Sample Struct
 struct ModSample
@@ -51,6 +54,9 @@ struct ModSample
 		OPLPatch adlib;
 	};
 
+	// Band-limited half-rate copies of the sample data, built by CSoundFile::UpdateSamplePyramids (see SamplePyramid.h)
+	std::shared_ptr<const SamplePyramid> pyramid;
+
 	ModSample(MODTYPE type = MOD_TYPE_NONE)
 	{
 		pData.pSample = nullptr;
@@ -0,0 +1,121 @@
+/*
+ * ParallelMix.cpp
+ * ---------------
+ * Purpose: Worker pool and scratch state for mixing voices on several threads.
+ * Notes  : Only used when render.mixer.threads is set; see CSoundFile::CreateStereoMix.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "ParallelMix.h"
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+MixerThreadPool::MixerThreadPool(uint32 numThreads)
+{
+#if MPT_PLATFORM_MULTITHREADED
+	m_numThreads = std::max(numThreads, uint32(1));
+	m_threads.reserve(m_numThreads - 1);
+	for(uint32 worker = 1; worker < m_numThreads; worker++)
+	{
+		m_threads.emplace_back(&MixerThreadPool::WorkerMain, this, worker);
+	}
+#else
+	MPT_UNREFERENCED_PARAMETER(numThreads);
+#endif
+}
+
+
+MixerThreadPool::~MixerThreadPool()
+{
+#if MPT_PLATFORM_MULTITHREADED
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_start.notify_all();
+	for(auto &thread : m_threads)
+	{
+		thread.join();
+	}
+#endif
+}
+
+
+void MixerThreadPool::Run(JobFunc job, void *context)
+{
+#if MPT_PLATFORM_MULTITHREADED
+	if(!m_threads.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = job;
+			m_context = context;
+			m_pending = static_cast<uint32>(m_threads.size());
+			m_generation++;
+		}
+		m_start.notify_all();
+		job(context, 0);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending == 0; });
+		return;
+	}
+#endif
+	job(context, 0);
+}
+
+
+#if MPT_PLATFORM_MULTITHREADED
+void MixerThreadPool::WorkerMain(uint32 worker)
+{
+	uint64 generation = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(true)
+	{
+		m_start.wait(lock, [&] { return m_quit || m_generation != generation; });
+		if(m_quit)
+			return;
+		generation = m_generation;
+		JobFunc job = m_job;
+		void *context = m_context;
+		lock.unlock();
+		job(context, worker);
+		lock.lock();
+		if(--m_pending == 0)
+			m_done.notify_one();
+	}
+}
+#endif
+
+
+void ParallelMixState::Reserve(uint32 blockSize, uint32 maxTargets)
+{
+	targets.reserve(maxTargets);
+	voices.reserve(MAX_CHANNELS);
+	for(size_t worker = 1; worker < workers.size(); worker++)
+	{
+		Worker &w = workers[worker];
+		w.buffers.resize(static_cast<size_t>(maxTargets) * blockSize * 2);
+		w.ofs.reserve(maxTargets * 2);
+		w.used.reserve(maxTargets);
+	}
+}
+
+
+uint16 ParallelMixState::FindOrAddTarget(mixsample_t *buffer, mixsample_t *ofsR, mixsample_t *ofsL)
+{
+	for(size_t i = 0; i < targets.size(); i++)
+	{
+		if(targets[i].buffer == buffer)
+			return static_cast<uint16>(i);
+	}
+	targets.push_back({buffer, ofsR, ofsL});
+	return static_cast<uint16>(targets.size() - 1);
+}
+
+
+OPENMPT_NAMESPACE_END
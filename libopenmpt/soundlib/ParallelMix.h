@@ -0,0 +1,113 @@
+/*
+ * ParallelMix.h
+ * -------------
+ * Purpose: Worker pool and scratch state for mixing voices on several threads.
+ * Notes  : Only used when render.mixer.threads is set; see CSoundFile::CreateStereoMix.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "Mixer.h"
+#include "Snd_defs.h"
+
+#include <vector>
+
+#if MPT_PLATFORM_MULTITHREADED
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+// A fixed set of threads that run one job at a time.
+// The calling thread takes part in every job as worker 0, so a pool with N threads only spawns N - 1 of them.
+class MixerThreadPool
+{
+public:
+	using JobFunc = void (*)(void *context, uint32 worker);
+
+	explicit MixerThreadPool(uint32 numThreads);
+	~MixerThreadPool();
+
+	MixerThreadPool(const MixerThreadPool &) = delete;
+	MixerThreadPool &operator=(const MixerThreadPool &) = delete;
+
+	uint32 GetNumThreads() const { return m_numThreads; }
+
+	// Calls job(context, worker) for every worker in [0, GetNumThreads()) and returns once all of them have finished.
+	void Run(JobFunc job, void *context);
+
+protected:
+#if MPT_PLATFORM_MULTITHREADED
+	void WorkerMain(uint32 worker);
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	JobFunc m_job = nullptr;
+	void *m_context = nullptr;
+	uint64 m_generation = 0;
+	uint32 m_pending = 0;
+	bool m_quit = false;
+#endif
+	uint32 m_numThreads = 1;
+};
+
+
+// State of CSoundFile::CreateStereoMix while mixing on several threads
+struct ParallelMixState
+{
+	// A buffer that voices are mixed into, along with its click removal accumulators
+	struct Target
+	{
+		mixsample_t *buffer;
+		mixsample_t *ofsR;
+		mixsample_t *ofsL;
+	};
+
+	struct Voice
+	{
+		CHANNELINDEX channel;
+		uint16 target;
+		PLUGINDEX plugin;
+		bool mixed;
+	};
+
+	// Private accumulation buffers of one worker, one stereo buffer per target.
+	// Worker 0 (the calling thread) mixes straight into the targets instead.
+	struct Worker
+	{
+		std::vector<mixsample_t> buffers;
+		std::vector<mixsample_t> ofs;
+		std::vector<bool> used;
+		uint32 firstVoice = 0, lastVoice = 0;
+	};
+
+	explicit ParallelMixState(uint32 numThreads)
+		: pool(numThreads)
+		, workers(numThreads)
+	{ }
+
+	// Allocate all scratch state for mix blocks of up to blockSize frames routed into up to maxTargets buffers,
+	// so that CreateStereoMixParallel does not have to allocate on the audio thread.
+	void Reserve(uint32 blockSize, uint32 maxTargets);
+
+	uint16 FindOrAddTarget(mixsample_t *buffer, mixsample_t *ofsR, mixsample_t *ofsL);
+
+	MixerThreadPool pool;
+	std::vector<Target> targets;
+	std::vector<Voice> voices;
+	std::vector<Worker> workers;
+};
+
+
+OPENMPT_NAMESPACE_END
@@ -288,7 +288,7 @@ void State::InputSample(int16 sample)
 		firstBlep = (firstBlep - 1u) % MAX_BLEPS;
 		if(activeBleps < std::size(blepState))
 			activeBleps++;
-		blepState[firstBlep].age = 0;
+		blepState[firstBlep].start = clock;
 		blepState[firstBlep].level = sample - globalOutputLevel;
 		globalOutputLevel = sample;
 	}
@@ -303,7 +303,7 @@ int State::OutputSample(const BlepArray &WinSincIntegral)
 	for(uint32 i = firstBlep; i != lastBlep; i++)
 	{
 		const auto &blep = blepState[i % MAX_BLEPS];
-		output -= WinSincIntegral[blep.age] * blep.level;
+		output -= WinSincIntegral[Age(blep)] * blep.level;
 	}
 #ifdef MPT_INTMIXER
 	output /= (1 << (Paula::BLEP_SCALE - 2));	// - 2 to compensate for the fact that we reduced the input sample bit depth
@@ -316,16 +316,11 @@ int State::OutputSample(const BlepArray &WinSincIntegral)
 // Advance the simulation by given number of clock ticks
 void State::Clock(int cycles)
 {
-	uint32 lastBlep = firstBlep + activeBleps;
-	for(uint32 i = firstBlep; i != lastBlep; i++)
+	clock += static_cast<uint16>(cycles);
+	// Bleps are ordered from newest to oldest, so expired bleps are always at the end
+	while(activeBleps && Age(blepState[(firstBlep + activeBleps - 1u) % MAX_BLEPS]) >= Paula::BLEP_SIZE)
 	{
-		auto &blep = blepState[i % MAX_BLEPS];
-		blep.age += static_cast<uint16>(cycles);
-		if(blep.age >= Paula::BLEP_SIZE)
-		{
-			activeBleps = static_cast<uint16>(i - firstBlep);
-			return;
-		}
+		activeBleps--;
 	}
 }
 
@@ -58,10 +58,13 @@ class State
 	// Hence 128 is chosen as a tradeoff between quality and memory consumption.
 	static constexpr uint16 MAX_BLEPS = 128;
 
+	// Instead of aging every blep on each clock tick, bleps remember the clock at which they started.
+	// Clocking is then independent of the number of active bleps, and only the oldest blep has to be checked for expiry.
+	// Ages never exceed BLEP_SIZE + MINIMUM_INTERVAL, so a wrapping 16-bit clock is sufficient.
 	struct Blep
 	{
 		int16 level;
-		uint16 age;
+		uint16 start;
 	};
 
 public:
@@ -70,8 +73,11 @@ public:
 private:
 	uint16 activeBleps = 0, firstBlep = 0;  // Count of simultaneous bleps to keep track of
 	int16 globalOutputLevel = 0;            // The instantenous value of Paula output
+	uint16 clock = 0;                       // Amiga clock ticks since an arbitrary point in time
 	Blep blepState[MAX_BLEPS];
 
+	uint16 Age(const Blep &blep) const { return static_cast<uint16>(clock - blep.start); }
+
 public:
 	State(uint32 sampleRate = 48000);
 
@@ -17,26 +17,17 @@
 #include "MixerSettings.h"
 #include "Paula.h"
 
-
-OPENMPT_NAMESPACE_BEGIN
+#include <memory>
 
 
-#ifdef LIBOPENMPT_BUILD
-// All these optimizations are not applicable to the tracker
-// because cutoff and firtype are configurable there.
+OPENMPT_NAMESPACE_BEGIN
 
-// Cache resampler tables across resampler object creation.
-// A C++11-style function-static singleton is holding the cached values.
-#define MPT_RESAMPLER_TABLES_CACHED
 
-// Prime the tables cache when the library is loaded.
-// Caching gets triggered via a global object that primes the cache during
+// Prime the shared resampler tables when the library is loaded.
+// Caching gets triggered via a global object that fetches the tables during
 //  construction.
-// This is only really useful with MPT_RESAMPLER_TABLES_CACHED.
 //#define MPT_RESAMPLER_TABLES_CACHED_ONSTARTUP
 
-#endif // LIBOPENMPT_BUILD
-
 
 #define SINC_WIDTH       8
 
@@ -58,9 +49,10 @@ class CResamplerSettings
 {
 public:
 	ResamplingMode SrcMode = Resampling::Default();
-	double gdWFIRCutoff = 0.97;
-	uint8 gbWFIRType = WFIR_KAISER4T;
+	double gdWFIRCutoff = WFIR_DEFAULT_CUTOFF;
+	uint8 gbWFIRType = WFIR_DEFAULT_TYPE;
 	Resampling::AmigaFilter emulateAmiga = Resampling::AmigaFilter::Off;
+	bool samplePyramids = false;  // Mix voices that are pitched up by an octave or more from band-limited half-rate copies of the sample
 public:
 	constexpr CResamplerSettings() = default;
 	bool operator == (const CResamplerSettings &cmp) const
@@ -69,7 +61,7 @@ public:
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wfloat-equal"
 #endif // MPT_COMPILER_CLANG
-		return SrcMode == cmp.SrcMode && gdWFIRCutoff == cmp.gdWFIRCutoff && gbWFIRType == cmp.gbWFIRType && emulateAmiga == cmp.emulateAmiga;
+		return SrcMode == cmp.SrcMode && gdWFIRCutoff == cmp.gdWFIRCutoff && gbWFIRType == cmp.gbWFIRType && emulateAmiga == cmp.emulateAmiga && samplePyramids == cmp.samplePyramids;
 #if MPT_COMPILER_CLANG
 #pragma clang diagnostic pop
 #endif // MPT_COMPILER_CLANG
@@ -78,65 +70,49 @@ public:
 };
 
 
+// Tables that do not depend on any settings.
+// They are computed on first use and shared by all resamplers until the process exits.
+struct CResamplerSincTables
+{
+	SINC_TYPE gKaiserSinc[SINC_PHASES * 8];     // Upsampling
+	SINC_TYPE gDownsample13x[SINC_PHASES * 8];  // Downsample 1.333x
+	SINC_TYPE gDownsample2x[SINC_PHASES * 8];   // Downsample 2x
+	Paula::BlepTables blepTables;               // Amiga BLEP resampler
+
+	CResamplerSincTables();
+
+	static std::shared_ptr<const CResamplerSincTables> Get();
+};
+
+
 class CResampler
 {
 public:
 	CResamplerSettings m_Settings;
-	CWindowedFIR m_WindowedFIR;
+	// Immutable tables, shared with all other resamplers using the same settings
+	std::shared_ptr<const CResamplerSincTables> m_SincTables;
+	std::shared_ptr<const CWindowedFIR> m_WindowedFIR;
 	static const int16 FastSincTable[256 * 4];
 
-#ifdef MODPLUG_TRACKER
-	static bool StaticTablesInitialized;
-	#define RESAMPLER_TABLE static
-#else
-	// no global data which has to be initialized by hand in the library
-	#define RESAMPLER_TABLE 
-#endif // MODPLUG_TRACKER
-
-	RESAMPLER_TABLE SINC_TYPE gKaiserSinc[SINC_PHASES * 8];     // Upsampling
-	RESAMPLER_TABLE SINC_TYPE gDownsample13x[SINC_PHASES * 8];  // Downsample 1.333x
-	RESAMPLER_TABLE SINC_TYPE gDownsample2x[SINC_PHASES * 8];   // Downsample 2x
-	RESAMPLER_TABLE Paula::BlepTables blepTables;               // Amiga BLEP resampler
-
 #ifndef MPT_INTMIXER
-	RESAMPLER_TABLE mixsample_t FastSincTablef[256 * 4];	// Cubic spline LUT
-	RESAMPLER_TABLE mixsample_t LinearTablef[256];		// Linear interpolation LUT
+	static mixsample_t FastSincTablef[256 * 4];	// Cubic spline LUT
+	static mixsample_t LinearTablef[256];		// Linear interpolation LUT
 #endif // !defined(MPT_INTMIXER)
 
-#undef RESAMPLER_TABLE
-
-private:
-	CResamplerSettings m_OldSettings;
 public:
-	CResampler(bool fresh_generate=false)
+	CResampler()
 	{
-		if(fresh_generate)
-		{
-			InitializeTablesFromScratch(true);
-		} else
-		{
-			InitializeTables();
-		}
+		InitializeTables();
 	}
 	void InitializeTables()
 	{
-		#if defined(MPT_RESAMPLER_TABLES_CACHED)
-			InitializeTablesFromCache();
-		#else
-			InitializeTablesFromScratch(true);
-		#endif
+		m_SincTables = CResamplerSincTables::Get();
+		m_WindowedFIR = CWindowedFIR::Get(m_Settings.gdWFIRCutoff, m_Settings.gbWFIRType);
 	}
 	void UpdateTables()
 	{
-		InitializeTablesFromScratch(false);
+		InitializeTables();
 	}
-
-private:
-	void InitFloatmixerTables();
-	void InitializeTablesFromScratch(bool force=false);
-#ifdef MPT_RESAMPLER_TABLES_CACHED
-	void InitializeTablesFromCache();
-#endif
 };
 
 
@@ -69,6 +69,14 @@ void RowVisitor::MoveVisitedRowsFrom(RowVisitor &other) noexcept
 }
 
 
+void RowVisitor::CopyVisitedRowsFrom(const RowVisitor &other)
+{
+	m_visitedRows = other.m_visitedRows;
+	m_visitedLoopStates = other.m_visitedLoopStates;
+	m_rowsSpentInLoops = other.m_rowsSpentInLoops;
+}
+
+
 const ModSequence &RowVisitor::Order() const
 {
 	if(m_sequence >= m_sndFile.Order.GetNumSequences())
@@ -83,6 +83,7 @@ public:
 	RowVisitor(const CSoundFile &sndFile, SEQUENCEINDEX sequence = SEQUENCEINDEX_INVALID);
 	
 	void MoveVisitedRowsFrom(RowVisitor &other) noexcept;
+	void CopyVisitedRowsFrom(const RowVisitor &other);
 
 	// Resize / Clear the row vector.
 	// If reset is true, the vector is not only resized to the required dimensions, but also completely cleared (i.e. all visited rows are unset).
@@ -0,0 +1,145 @@
+/*
+ * SamplePyramid.cpp
+ * -----------------
+ * Purpose: Band-limited half-rate copies of sample data for voices that are played far above the mix rate.
+ * Notes  : (currently none)
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "SamplePyramid.h"
+#include "ModSample.h"
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace
+{
+
+// 11-tap half-band lowpass, sum is 512
+constexpr int HalfBandRadius = 5;
+constexpr int32 HalfBandTaps[HalfBandRadius + 1] = {256, 150, 0, -25, 0, 3};
+
+// Source frames of one level, extended beyond both ends according to the loop
+template <typename T>
+class LevelReader
+{
+	const T *data;
+	const SmpLength length, loopStart, loopEnd;
+	const bool looped, pingPong;
+	const int numChannels;
+
+public:
+	LevelReader(const T *data, SmpLength length, SmpLength loopStart, SmpLength loopEnd, bool looped, bool pingPong, int numChannels)
+		: data{data}, length{length}, loopStart{loopStart}, loopEnd{loopEnd}, looped{looped}, pingPong{pingPong}, numChannels{numChannels}
+	{ }
+
+	int32 operator() (int64 frame, int chn) const
+	{
+		if(frame >= 0 && frame < static_cast<int64>(length))
+			return data[frame * numChannels + chn];
+		if(!looped)
+			return 0;
+		const int64 loopLength = loopEnd - loopStart;
+		if(frame >= static_cast<int64>(loopEnd))
+		{
+			const int64 offset = (frame - loopEnd) % loopLength;
+			frame = pingPong ? (loopEnd - 1 - offset) : (loopStart + offset);
+		} else if(loopStart == 0)
+		{
+			// Frames before a loop that starts at the sample start are only read after the loop has wrapped around
+			const int64 offset = (-frame - 1) % loopLength;
+			frame = pingPong ? offset : (loopEnd - 1 - offset);
+		} else
+		{
+			return 0;
+		}
+		return data[frame * numChannels + chn];
+	}
+};
+
+
+template <typename T>
+void BuildLevels(SamplePyramid &pyramid, const ModSample &smp)
+{
+	const int numChannels = smp.GetNumChannels();
+	SmpLength length = pyramid.looped ? smp.nLoopEnd : smp.nLength;
+	SmpLength loopStart = pyramid.loopStart, loopEnd = pyramid.loopEnd;
+	const T *source = static_cast<const T *>(smp.samplev());
+
+	for(uint8 level = 1; level <= SamplePyramid::MaxLevels; level++)
+	{
+		const SmpLength levelLength = (length + 1) / 2;
+		if(pyramid.looped && ((loopStart | loopEnd) & 1))
+			break;
+		if(pyramid.looped ? (loopEnd - loopStart < 8) : (levelLength < 8))
+			break;
+
+		const LevelReader<T> reader{source, length, loopStart, loopEnd, pyramid.looped, pyramid.pingPong, numChannels};
+		length = levelLength;
+		loopStart /= 2;
+		loopEnd /= 2;
+
+		std::vector<std::byte> &buffer = pyramid.levels[level - 1];
+		buffer.resize((length + 2 * SamplePyramid::PadFrames) * pyramid.bytesPerFrame);
+		T *dest = reinterpret_cast<T *>(buffer.data()) + SamplePyramid::PadFrames * numChannels;
+		for(SmpLength i = 0; i < length; i++)
+		{
+			const int64 center = int64(2) * i;
+			for(int chn = 0; chn < numChannels; chn++)
+			{
+				int32 sum = HalfBandTaps[0] * reader(center, chn);
+				for(int tap = 1; tap <= HalfBandRadius; tap++)
+				{
+					if(HalfBandTaps[tap])
+						sum += HalfBandTaps[tap] * (reader(center - tap, chn) + reader(center + tap, chn));
+				}
+				dest[i * numChannels + chn] = mpt::saturate_cast<T>((sum + 256) >> 9);
+			}
+		}
+
+		// Extend the new level beyond its ends so that the interpolation filters read the right frames around the loop
+		const LevelReader<T> padReader{dest, length, loopStart, loopEnd, pyramid.looped, pyramid.pingPong, numChannels};
+		for(SmpLength i = 1; i <= SamplePyramid::PadFrames; i++)
+		{
+			for(int chn = 0; chn < numChannels; chn++)
+			{
+				dest[-static_cast<std::ptrdiff_t>(i * numChannels) + chn] = static_cast<T>(padReader(-static_cast<int64>(i), chn));
+				dest[(length - 1 + i) * numChannels + chn] = static_cast<T>(padReader(length - 1 + i, chn));
+			}
+		}
+
+		source = dest;
+		pyramid.numLevels = level;
+	}
+}
+
+}  // namespace
+
+
+std::shared_ptr<const SamplePyramid> SamplePyramid::Create(const ModSample &smp)
+{
+	auto pyramid = std::make_shared<SamplePyramid>();
+	if(!smp.HasSampleData() || smp.uFlags[CHN_ADLIB])
+		return pyramid;
+
+	pyramid->looped = smp.HasLoop();
+	pyramid->pingPong = smp.HasPingPongLoop();
+	if(pyramid->looped)
+	{
+		pyramid->loopStart = smp.nLoopStart;
+		pyramid->loopEnd = smp.nLoopEnd;
+	}
+	pyramid->bytesPerFrame = smp.GetBytesPerSample();
+	if(smp.uFlags[CHN_16BIT])
+		BuildLevels<int16>(*pyramid, smp);
+	else
+		BuildLevels<int8>(*pyramid, smp);
+	return pyramid;
+}
+
+
+OPENMPT_NAMESPACE_END
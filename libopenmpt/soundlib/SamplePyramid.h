@@ -0,0 +1,74 @@
+/*
+ * SamplePyramid.h
+ * ---------------
+ * Purpose: Band-limited half-rate copies of sample data for voices that are played far above the mix rate.
+ * Notes  : Each level halves the sample rate of the previous one, so a voice with an increment of 2^n or more
+ *          can be mixed from level n with an increment below 2, which keeps the interpolation filters effective
+ *          and reduces the number of source frames that have to be read.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "Snd_defs.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+struct ModSample;
+
+struct SamplePyramid
+{
+	// Up to 64x downsampling
+	static constexpr uint8 MaxLevels = 6;
+	// Frames before and after every level that continue the sample according to its loop (or are silent)
+	static constexpr SmpLength PadFrames = 16;
+
+	// Loop of the original sample that the levels were built for
+	SmpLength loopStart = 0, loopEnd = 0;
+	bool looped = false;
+	bool pingPong = false;
+	// Number of usable levels (not counting the original sample)
+	uint8 numLevels = 0;
+	uint8 bytesPerFrame = 0;
+	std::array<std::vector<std::byte>, MaxLevels> levels;
+
+	// Sample data of the given level (1...numLevels), to be indexed like the original sample data
+	const void *GetLevel(uint8 level) const
+	{
+		return levels[level - 1].data() + PadFrames * bytesPerFrame;
+	}
+
+	// Build all levels that preserve the sample's loop points exactly.
+	// If the sample has a loop, the levels end at the loop end and can only be used while the voice is looping.
+	static std::shared_ptr<const SamplePyramid> Create(const ModSample &smp);
+
+	// Pyramids only make sense for interpolation modes that are meant to be band-limited
+	static constexpr bool IsSupportedMode(ResamplingMode mode)
+	{
+		return mode == SRCMODE_CUBIC || mode == SRCMODE_SINC8 || mode == SRCMODE_SINC8LP;
+	}
+
+	// The level at which a voice's increment drops below 2
+	static uint8 LevelForIncrement(SamplePosition increment)
+	{
+		uint64 inc = static_cast<uint64>(increment.IsNegative() ? -increment.GetRaw() : increment.GetRaw()) >> 33;
+		uint8 level = 0;
+		while(inc && level < MaxLevels)
+		{
+			inc >>= 1;
+			level++;
+		}
+		return level;
+	}
+};
+
+OPENMPT_NAMESPACE_END
@@ -297,6 +297,7 @@ DECLARE_FLAGSET(SongFlags)
 // Misc Flags (can safely be turned on or off)
 #define SNDMIX_MAXDEFAULTPAN  0x80000  // Currently unused (should be used by Amiga MOD loaders)
 #define SNDMIX_MUTECHNMODE    0x100000 // Notes are not played on muted channels
+#define SNDMIX_FLOATMIX       0x200000 // Process the master mix (plugins, global volume, stereo separation) in floating point
 
 
 #define MAX_GLOBAL_VOLUME 256u
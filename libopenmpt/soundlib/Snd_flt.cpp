@@ -88,6 +88,37 @@ void CSoundFile::UpdateInstrumentFilter(const ModInstrument &ins, bool updateMod
 }
 
 
+// Coefficients of the 2-poles resonant filter before conversion to the mixer format, cutoff and resonance in [0, 127]
+FilterCoefficientCache::Coefficients CSoundFile::ComputeFilterCoefficients(int cutoff, int resonance, int envModifier) const
+{
+	// 2 * damping factor
+	const float dmpfac = std::pow(10.0f, static_cast<float>(-resonance) * ((24.0f / 128.0f) / 20.0f));
+	const float fc = CutOffToFrequency(cutoff, envModifier) * (2.0f * mpt::numbers::pi_v<float>);
+	float d, e;
+	if(m_playBehaviour[kITFilterBehaviour] && !m_SongFlags[SONG_EXFILTERRANGE])
+	{
+		const float r = static_cast<float>(m_MixerSettings.gdwMixingFreq) / fc;
+
+		d = dmpfac * r + dmpfac - 1.0f;
+		e = r * r;
+	} else
+	{
+		const float r = fc / static_cast<float>(m_MixerSettings.gdwMixingFreq);
+
+		d = (1.0f - 2.0f * dmpfac) * r;
+		LimitMax(d, 2.0f);
+		d = (2.0f * dmpfac - d) / r;
+		e = 1.0f / (r * r);
+	}
+
+	FilterCoefficientCache::Coefficients coeffs;
+	coeffs.fg = 1.0f / (1.0f + d + e);
+	coeffs.fb0 = (d + e + e) / (1 + d + e);
+	coeffs.fb1 = -e / (1.0f + d + e);
+	return coeffs;
+}
+
+
 // Simple 2-poles resonant filter. Returns computed cutoff in range [0, 254] or -1 if filter is not applied.
 int CSoundFile::SetupChannelFilter(ModChannel &chn, bool bReset, int envModifier) const
 {
@@ -122,29 +153,20 @@ int CSoundFile::SetupChannelFilter(ModChannel &chn, bool bReset, int envModifier
 
 	chn.dwFlags.set(CHN_FILTER);
 
-	// 2 * damping factor
-	const float dmpfac = std::pow(10.0f, static_cast<float>(-resonance) * ((24.0f / 128.0f) / 20.0f));
-	const float fc = CutOffToFrequency(cutoff, envModifier) * (2.0f * mpt::numbers::pi_v<float>);
-	float d, e;
-	if(m_playBehaviour[kITFilterBehaviour] && !m_SongFlags[SONG_EXFILTERRANGE])
+	// The coefficients only depend on these parameters and the mixing rate, which the cache keeps track of
+	MPT_ASSERT(envModifier >= -256 && envModifier <= 256);
+	const uint32 variant = (m_SongFlags[SONG_EXFILTERRANGE] ? 1 : 0) | (m_playBehaviour[kITFilterBehaviour] ? 2 : 0) | (GetType() == MOD_TYPE_IMF ? 4 : 0);
+	const uint32 cacheKey = FilterCoefficientCache::MakeKey(static_cast<uint32>(cutoff * (envModifier + 256)), static_cast<uint32>(resonance), variant);
+	FilterCoefficientCache::Coefficients coeffs;
+	if(const auto cached = m_filterCoefficients.Lookup(m_MixerSettings.gdwMixingFreq, cacheKey); cached != nullptr)
 	{
-		const float r = static_cast<float>(m_MixerSettings.gdwMixingFreq) / fc;
-
-		d = dmpfac * r + dmpfac - 1.0f;
-		e = r * r;
+		coeffs = *cached;
 	} else
 	{
-		const float r = fc / static_cast<float>(m_MixerSettings.gdwMixingFreq);
-
-		d = (1.0f - 2.0f * dmpfac) * r;
-		LimitMax(d, 2.0f);
-		d = (2.0f * dmpfac - d) / r;
-		e = 1.0f / (r * r);
+		coeffs = ComputeFilterCoefficients(cutoff, resonance, envModifier);
+		m_filterCoefficients.Insert(cacheKey, coeffs);
 	}
-
-	float fg = 1.0f / (1.0f + d + e);
-	float fb0 = (d + e + e) / (1 + d + e);
-	float fb1 = -e / (1.0f + d + e);
+	const float fg = coeffs.fg, fb0 = coeffs.fb0, fb1 = coeffs.fb1;
 
 #if defined(MPT_INTMIXER)
 #define MPT_FILTER_CONVERT(x) mpt::saturate_round<mixsample_t>((x) * (1 << MIXING_FILTER_PRECISION))
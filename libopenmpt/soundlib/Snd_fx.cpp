@@ -57,12 +57,7 @@ protected:
 
 public:
 	std::unique_ptr<CSoundFile::PlayState> state;
-	struct ChnSettings
-	{
-		uint32 ticksToRender = 0;	// When using sample sync, we still need to render this many ticks
-		bool incChanged = false;	// When using sample sync, note frequency has changed
-		uint8 vol = 0xFF;
-	};
+	using ChnSettings = GetLengthChnSettings;
 
 	std::vector<ChnSettings> chnSettings;
 	double elapsedTime;
@@ -72,6 +67,9 @@ public:
 		: sndFile(sf)
 		, state(std::make_unique<CSoundFile::PlayState>(sf.m_PlayState))
 	{
+		// Start out with the effect memory of a freshly loaded module rather than that of the current play position,
+		// so that the result does not depend on where playback was before (and seek checkpoints stay valid).
+		std::fill(std::begin(state->Chn), std::begin(state->Chn) + sf.GetNumChannels(), ModChannel{});
 		Reset();
 	}
 
@@ -95,6 +93,28 @@ public:
 		}
 	}
 
+	// Store current state in a seek checkpoint
+	void SaveCheckpoint(SeekCheckpoint &checkpoint) const
+	{
+		checkpoint.globals = *state;
+		checkpoint.channels.assign(std::begin(state->Chn), std::begin(state->Chn) + sndFile.GetNumChannels());
+		checkpoint.chnSettings = chnSettings;
+		checkpoint.midiMacroEvaluationResults = state->m_midiMacroEvaluationResults;
+		checkpoint.elapsedTime = elapsedTime;
+	}
+
+	// Restore state from a seek checkpoint
+	void LoadCheckpoint(const SeekCheckpoint &checkpoint)
+	{
+		// The remaining samples of the current tick belong to the mixer, not to the song position
+		static_cast<CSoundFile::PlayStateGlobals &>(*state) = checkpoint.globals.WithBufferCountOf(*state);
+		std::copy(checkpoint.channels.begin(), checkpoint.channels.end(), std::begin(state->Chn));
+		chnSettings = checkpoint.chnSettings;
+		if(state->m_midiMacroEvaluationResults && checkpoint.midiMacroEvaluationResults)
+			state->m_midiMacroEvaluationResults = checkpoint.midiMacroEvaluationResults;
+		elapsedTime = checkpoint.elapsedTime;
+	}
+
 	// Increment playback position of sample and envelopes on a channel
 	void RenderChannel(CHANNELINDEX channel, uint32 tickDuration, uint32 portaStart = uint32_max)
 	{
@@ -288,7 +308,10 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 
 	// Are we trying to reach a certain pattern position?
 	const bool hasSearchTarget = target.mode != GetLengthTarget::NoTarget && target.mode != GetLengthTarget::GetAllSubsongs;
-	const bool adjustSamplePos = (adjustMode & eAdjustSamplePositions) == eAdjustSamplePositions;
+	// Checkpoints need the complete channel state, so they are recorded as if we were seeking in the mode they are meant for
+	const bool recordCheckpoints = target.recordCheckpoints != nullptr && target.checkpointInterval > 0.0;
+	const bool adjustChannels = (adjustMode & eAdjust) || recordCheckpoints;
+	const bool adjustSamplePos = (adjustMode & eAdjustSamplePositions) == eAdjustSamplePositions || (recordCheckpoints && target.checkpointSamplePositions);
 
 	SEQUENCEINDEX sequence = target.sequence;
 	if(sequence >= Order.GetNumSequences()) sequence = Order.GetCurrentSequenceIndex();
@@ -322,9 +345,10 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 			const PATTERNINDEX seekPat = orderList[target.pos.order];
 			if(Patterns.IsValidPat(seekPat) && Patterns[seekPat].IsValidRow(target.pos.row))
 			{
-				const ModCommand *m = Patterns[seekPat].GetpModCommand(target.pos.row, 0);
-				for(CHANNELINDEX i = 0; i < GetNumChannels(); i++, m++)
+				const PatternChannelSet occupiedChannels = Patterns[seekPat].GetOccupiedChannels(target.pos.row);
+				for(CHANNELINDEX i = occupiedChannels.FindFirstSet(0); i != CHANNELINDEX_INVALID; i = occupiedChannels.FindFirstSet(i + 1))
 				{
+					const ModCommand *m = Patterns[seekPat].GetpModCommand(target.pos.row, i);
 					if(m->note == NOTE_NOTECUT || m->note == NOTE_KEYOFF || (m->note == NOTE_FADE && GetNumInstruments())
 						|| (m->IsNote() && m->instr && !m->IsPortamento()))
 					{
@@ -335,15 +359,48 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 		}
 	}
 
-	if(adjustMode & eAdjust)
+	if(adjustChannels)
 		playState.m_midiMacroEvaluationResults.emplace();
 
 	// If samples are being synced, force them to resync if tick duration changes
 	uint32 oldTickDuration = 0;
 	bool breakToRow = false;
+	double nextCheckpointTime = target.checkpointInterval;
+
+	if(target.resumeCheckpoint != nullptr)
+	{
+		const SeekCheckpoint &checkpoint = *target.resumeCheckpoint;
+		MPT_ASSERT(checkpoint.sequence == sequence && checkpoint.channels.size() == GetNumChannels());
+		memory.LoadCheckpoint(checkpoint);
+		visitedRows.CopyVisitedRowsFrom(checkpoint.visitedRows);
+		oldTickDuration = checkpoint.tickDuration;
+		breakToRow = checkpoint.breakToRow;
+		retval.startOrder = checkpoint.subsongStartOrder;
+		retval.startRow = checkpoint.subsongStartRow;
+	}
+
+	// Channels whose row command may be non-empty. Row commands of all other channels are known to be empty,
+	// so that the row loop only needs to visit channels that contain data on the current row.
+	PatternChannelSet rowCommandChannels;
+	for(CHANNELINDEX nChn = 0; nChn < GetNumChannels(); nChn++)
+		rowCommandChannels.set(nChn);
 
 	for (;;)
 	{
+		if(recordCheckpoints && memory.elapsedTime >= nextCheckpointTime)
+		{
+			// Sample positions are not brought up to date here: The ticks that still have to be rendered are part of the
+			// snapshot, so that resuming from it renders them at exactly the same point as seeking from the start would.
+			SeekCheckpoint &checkpoint = target.recordCheckpoints->emplace_back(visitedRows);
+			memory.SaveCheckpoint(checkpoint);
+			checkpoint.tickDuration = oldTickDuration;
+			checkpoint.subsongStartOrder = retval.startOrder;
+			checkpoint.subsongStartRow = retval.startRow;
+			checkpoint.sequence = sequence;
+			checkpoint.breakToRow = breakToRow;
+			nextCheckpointTime = memory.elapsedTime + target.checkpointInterval;
+		}
+
 		const bool ignoreRow = NextRow(playState, breakToRow).first;
 
 		// Time target reached.
@@ -397,6 +454,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 					retval.startRow = playState.m_nRow;
 					retval.startOrder = playState.m_nNextOrder;
 					memory.Reset();
+					nextCheckpointTime = target.checkpointInterval;
 
 					playState.m_nCurrentOrder = playState.m_nNextOrder;
 					playState.m_nPattern = orderList[playState.m_nCurrentOrder];
@@ -429,6 +487,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 					retval.startRow = playState.m_nRow;
 					retval.startOrder = playState.m_nNextOrder;
 					memory.Reset();
+					nextCheckpointTime = target.checkpointInterval;
 					playState.m_nNextRow = playState.m_nRow;
 					continue;
 				}
@@ -478,6 +537,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 				retval.startRow = playState.m_nRow;
 				retval.startOrder = playState.m_nNextOrder;
 				memory.Reset();
+				nextCheckpointTime = target.checkpointInterval;
 				playState.m_nNextRow = playState.m_nRow;
 				continue;
 			}
@@ -499,14 +559,23 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 			continue;
 
 		// For various effects, we need to know first how many ticks there are in this row.
-		const ModCommand *p = Patterns[playState.m_nPattern].GetpModCommand(playState.m_nRow, 0);
+		const CPattern &pattern = Patterns[playState.m_nPattern];
+		const PatternChannelSet occupiedChannels = pattern.GetOccupiedChannels(playState.m_nRow);
+		for(CHANNELINDEX nChn = rowCommandChannels.FindFirstSet(0); nChn != CHANNELINDEX_INVALID; nChn = rowCommandChannels.FindFirstSet(nChn + 1))
+		{
+			if(!occupiedChannels.test(nChn))
+				playState.Chn[nChn].rowCommand.Clear();
+		}
+		rowCommandChannels = occupiedChannels;
 		const bool ignoreMutedChn = m_playBehaviour[kST3NoMutedChannels];
-		for(CHANNELINDEX nChn = 0; nChn < GetNumChannels(); nChn++, p++)
+		for(CHANNELINDEX nChn = occupiedChannels.FindFirstSet(0); nChn != CHANNELINDEX_INVALID; nChn = occupiedChannels.FindFirstSet(nChn + 1))
 		{
 			ModChannel &chn = playState.Chn[nChn];
-			if(p->IsEmpty() || (ignoreMutedChn && ChnSettings[nChn].dwFlags[CHN_MUTE]))  // not even effects are processed on muted S3M channels
+			const ModCommand *p = pattern.GetpModCommand(playState.m_nRow, nChn);
+			if(ignoreMutedChn && ChnSettings[nChn].dwFlags[CHN_MUTE])  // not even effects are processed on muted S3M channels
 			{
 				chn.rowCommand.Clear();
+				rowCommandChannels.reset(nChn);
 				continue;
 			}
 			if(p->IsPcNote())
@@ -518,6 +587,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 				}
 #endif // NO_PLUGINS
 				chn.rowCommand.Clear();
+				rowCommandChannels.reset(nChn);
 				continue;
 			}
 			chn.rowCommand = *p;
@@ -575,7 +645,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 		playState.m_breakRow = ROWINDEX_INVALID;
 		playState.m_posJump = ORDERINDEX_INVALID;
 
-		for(CHANNELINDEX nChn = 0; nChn < GetNumChannels(); nChn++)
+		for(CHANNELINDEX nChn = rowCommandChannels.FindFirstSet(0); nChn != CHANNELINDEX_INVALID; nChn = rowCommandChannels.FindFirstSet(nChn + 1))
 		{
 			ModChannel &chn = playState.Chn[nChn];
 			if(chn.rowCommand.IsEmpty())
@@ -584,7 +654,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 			ModCommand::PARAM param = chn.rowCommand.param;
 			ModCommand::NOTE note = chn.rowCommand.note;
 
-			if(adjustMode & eAdjust)
+			if(adjustChannels)
 			{
 				if(chn.rowCommand.instr)
 				{
@@ -672,7 +742,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 				if(!m_playBehaviour[kMODVBlankTiming])
 				{
 					TEMPO tempo(CalculateXParam(playState.m_nPattern, playState.m_nRow, nChn), 0);
-					if ((adjustMode & eAdjust) && (GetType() & (MOD_TYPE_S3M | MOD_TYPE_IT | MOD_TYPE_MPT)))
+					if (adjustChannels && (GetType() & (MOD_TYPE_S3M | MOD_TYPE_IT | MOD_TYPE_MPT)))
 					{
 						if (tempo.GetInt()) chn.nOldTempo = static_cast<uint8>(tempo.GetInt()); else tempo.Set(chn.nOldTempo);
 					}
@@ -758,7 +828,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 			}
 
 			// The following calculations are not interesting if we just want to get the song length.
-			if(!(adjustMode & eAdjust))
+			if(!adjustChannels)
 				continue;
 			switch(command)
 			{
@@ -909,9 +979,9 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 			case CMD_MIDI:
 			case CMD_SMOOTHMIDI:
 				if(param < 0x80)
-					ProcessMIDIMacro(playState, nChn, false, m_MidiCfg.SFx[chn.nActiveMacro], chn.rowCommand.param, 0);
+					ProcessMIDIMacro(playState, nChn, false, m_midiMacroPrograms.SFx[chn.nActiveMacro], chn.rowCommand.param, 0);
 				else
-					ProcessMIDIMacro(playState, nChn, false, m_MidiCfg.Zxx[param & 0x7F], chn.rowCommand.param, 0);
+					ProcessMIDIMacro(playState, nChn, false, m_midiMacroPrograms.Zxx[param & 0x7F], chn.rowCommand.param, 0);
 				break;
 
 			default:
@@ -945,7 +1015,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 			case CMD_VIBRATO:
 			case CMD_FINEVIBRATO:
 			case CMD_VIBRATOVOL:
-				if(adjustMode & eAdjust)
+				if(adjustChannels)
 				{
 					uint32 vibTicks = ((GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) && !m_SongFlags[SONG_ITOLDEFFECTS]) ? numTicks : nonRowTicks;
 					uint32 inc = chn.nVibratoSpeed * vibTicks;
@@ -956,7 +1026,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 				break;
 
 			case CMD_TREMOLO:
-				if(adjustMode & eAdjust)
+				if(adjustChannels)
 				{
 					uint32 tremTicks = ((GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) && !m_SongFlags[SONG_ITOLDEFFECTS]) ? numTicks : nonRowTicks;
 					uint32 inc = chn.nTremoloSpeed * tremTicks;
@@ -967,7 +1037,7 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 				break;
 
 			case CMD_PANBRELLO:
-				if(adjustMode & eAdjust)
+				if(adjustChannels)
 				{
 					// Panbrello effect is permanent in compatible mode, so actually apply panbrello for the last tick of this row
 					chn.nPanbrelloPos += static_cast<uint8>(chn.nPanbrelloSpeed * (numTicks - 1));
@@ -2116,7 +2186,9 @@ void CSoundFile::ApplyInstrumentPanning(ModChannel &chn, const ModInstrument *in
 }
 
 
-CHANNELINDEX CSoundFile::GetNNAChannel(CHANNELINDEX nChn) const
+#ifdef MPT_VERIFY_VOICEALLOCATOR
+// Reference implementation of GetNNAChannel, looking at every channel
+CHANNELINDEX CSoundFile::GetNNAChannelLinear(CHANNELINDEX nChn) const
 {
 	// Check for empty channel
 	for(CHANNELINDEX i = m_nChannels; i < MAX_CHANNELS; i++)
@@ -2150,9 +2222,6 @@ CHANNELINDEX CSoundFile::GetNNAChannel(CHANNELINDEX nChn) const
 		const ModChannel &c = m_PlayState.Chn[i];
 		if(c.nLength && !c.nFadeOutVol)
 			return i;
-		// Use a combination of real volume [14 bit] (which includes volume envelopes, but also potentially global volume) and note volume [9 bit].
-		// Rationale: We need volume envelopes in case e.g. all NNA channels are playing at full volume but are looping on a 0-volume envelope node.
-		// But if global volume is not applied to master and the global volume temporarily drops to 0, we would kill arbitrary channels. Hence, add the note volume as well.
 		uint32 v = (c.nRealVolume << 9) | c.nVolume;
 		if(c.dwFlags[CHN_LOOP])
 			v /= 2;
@@ -2165,6 +2234,51 @@ CHANNELINDEX CSoundFile::GetNNAChannel(CHANNELINDEX nChn) const
 	}
 	return result;
 }
+#endif // MPT_VERIFY_VOICEALLOCATOR
+
+
+CHANNELINDEX CSoundFile::GetNNAChannel(CHANNELINDEX nChn)
+{
+	m_PlayState.BackgroundVoices.Refresh(m_PlayState.Chn);
+	const VoiceAllocator &voices = m_PlayState.BackgroundVoices;
+	const CHANNELINDEX best = voices.Best();
+
+	// Check for empty channel: Either a channel that is not used as a background voice at all,
+	// a voice whose sample has stopped and that has no plugin note playing, or a voice with a stopped OPL note.
+	CHANNELINDEX result = voices.FirstInactive(m_nChannels);
+	if(best < result && voices.GetKey(best).priority == VoiceAllocator::Priority::Stopped)
+		result = best;
+	for(CHANNELINDEX i = voices.OPLVoices().FindFirstSet(m_nChannels); i < result; i = voices.OPLVoices().FindFirstSet(i + 1))
+	{
+		if(!m_opl || !m_opl->IsActive(i))
+		{
+			result = i;
+			break;
+		}
+	}
+
+	uint32 vol = 0x800000;
+	if(result == CHANNELINDEX_INVALID && nChn < MAX_CHANNELS)
+	{
+		const ModChannel &srcChn = m_PlayState.Chn[nChn];
+		if(!srcChn.nFadeOutVol && srcChn.nLength)
+			return CHANNELINDEX_INVALID;
+		vol = (srcChn.nRealVolume << 9) | srcChn.nVolume;
+	}
+
+	// All channels are used: Take a voice whose fade-out has finished, or the quietest voice if it is quieter than the new note
+	if(result == CHANNELINDEX_INVALID && best != CHANNELINDEX_INVALID)
+	{
+		const VoiceAllocator::Key &key = voices.GetKey(best);
+		if(key.priority == VoiceAllocator::Priority::Silent || key.volume < vol || (key.volume == vol && key.envPosition > 0))
+			result = best;
+	}
+
+#ifdef MPT_VERIFY_VOICEALLOCATOR
+	MPT_ASSERT(result == GetNNAChannelLinear(nChn));
+#endif // MPT_VERIFY_VOICEALLOCATOR
+	return result;
+}
 
 
 CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, bool forceCut)
@@ -2205,6 +2319,7 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 		srcChn.position.Set(0);
 		srcChn.nROfs = srcChn.nLOfs = 0;
 		srcChn.rightVol = srcChn.leftVol = 0;
+		m_PlayState.BackgroundVoices.Activate(nnaChn);
 		return nnaChn;
 	}
 	if(instr > GetNumInstruments())
@@ -2236,12 +2351,9 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 	if(srcChn.dwFlags[CHN_MUTE])
 		return CHANNELINDEX_INVALID;
 
-	for(CHANNELINDEX i = nChn; i < MAX_CHANNELS; i++)
+	// Only apply to the same pattern channel, or background channels that are still playing (free background channels are overwritten when they are used again)
+	for(CHANNELINDEX i = nChn; i < MAX_CHANNELS; i = m_PlayState.BackgroundVoices.FirstActive(std::max(static_cast<CHANNELINDEX>(i + 1), m_nChannels)))
 	{
-		// Only apply to background channels, or the same pattern channel
-		if(i < m_nChannels && i != nChn)
-			continue;
-
 		ModChannel &chn = m_PlayState.Chn[i];
 		bool applyDNAtoPlug = false;
 		if((chn.nMasterChn == nChn + 1 || i == nChn) && chn.pModInstrument != nullptr)
@@ -2332,6 +2444,7 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 					chn.nFadeOutVol = 0;
 					chn.dwFlags.set(CHN_NOTEFADE | CHN_FASTVOLRAMP);
 				}
+				InvalidateBackgroundVoice(i);
 			}
 		}
 	}
@@ -2437,7 +2550,8 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 	srcChn.nLength = 0;
 	srcChn.position.Set(0);
 	srcChn.nROfs = srcChn.nLOfs = 0;
-	
+	m_PlayState.BackgroundVoices.Activate(nnaChn);
+
 	return nnaChn;
 }
 
@@ -4795,6 +4909,7 @@ void CSoundFile::ExtendedS3MCommands(CHANNELINDEX nChn, ModCommand::PARAM param)
 									if(bkChn.dwFlags[CHN_ADLIB] && m_opl)
 										m_opl->NoteCut(i);
 								}
+								InvalidateBackgroundVoice(i);
 #ifndef NO_PLUGINS
 								const ModInstrument *pIns = bkChn.pModInstrument;
 								IMixPlugin *pPlugin;
@@ -4963,8 +5078,15 @@ void CSoundFile::InvertLoop(ModChannel &chn)
 // plugin: Plugin to send MIDI message to (if not specified but needed, it is autodetected)
 void CSoundFile::ProcessMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const MIDIMacroConfigData::Macro &macro, uint8 param, PLUGINDEX plugin)
 {
-	playState.m_midiMacroScratchSpace.resize(macro.Length() + 1);
-	auto out = mpt::as_span(playState.m_midiMacroScratchSpace);
+	ProcessMIDIMacro(playState, nChn, isSmooth, MIDIMacroProgram{macro}, param, plugin);
+}
+
+
+// Same as above, for a macro that has already been compiled (see m_midiMacroPrograms).
+void CSoundFile::ProcessMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const MIDIMacroProgram &macro, uint8 param, PLUGINDEX plugin)
+{
+	std::array<uint8, MIDIMacroProgram::MaxOutputLength> outBuffer;
+	auto out = mpt::as_span(outBuffer);
 
 	ParseMIDIMacro(playState, nChn, isSmooth, macro, out, param, plugin);
 
@@ -5034,8 +5156,11 @@ void CSoundFile::ProcessMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool
 }
 
 
-void CSoundFile::ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const mpt::span<const char> macro, mpt::span<uint8> &out, uint8 param, PLUGINDEX plugin) const
+void CSoundFile::ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const MIDIMacroProgram &macro, mpt::span<uint8> &out, uint8 param, PLUGINDEX plugin) const
 {
+	using OpCode = MIDIMacroProgram::OpCode;
+	MPT_ASSERT(out.size() >= MIDIMacroProgram::MaxOutputLength);
+
 	ModChannel &chn = playState.Chn[nChn];
 	const ModInstrument *pIns = chn.pModInstrument;
 
@@ -5044,32 +5169,35 @@ void CSoundFile::ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool is
 
 	bool firstNibble = true;
 	size_t outPos = 0;  // output buffer position, which also equals the number of complete bytes
-	for(size_t pos = 0; pos < macro.size() && outPos < out.size(); pos++)
+	for(const auto &op : macro.Ops())
 	{
-		bool isNibble = false;  // did we parse a nibble or a byte value?
-		uint8 data = 0;         // data that has just been parsed
+		bool isNibble = false;  // did we evaluate a nibble or a byte value?
+		uint8 data = 0;         // data that has just been evaluated
 
-		// Parse next macro byte... See Impulse Tracker's MIDI.TXT for detailed information on each possible character.
-		if(macro[pos] >= '0' && macro[pos] <= '9')
-		{
-			isNibble = true;
-			data = static_cast<uint8>(macro[pos] - '0');
-		} else if(macro[pos] >= 'A' && macro[pos] <= 'F')
+		// See Impulse Tracker's MIDI.TXT for detailed information on each possible macro character.
+		switch(op.code)
 		{
+		case OpCode::ConstByte:
+			MPT_ASSERT(firstNibble);
+			out[outPos++] = op.value;
+			continue;
+		case OpCode::ConstNibble:
 			isNibble = true;
-			data = static_cast<uint8>(macro[pos] - 'A' + 0x0A);
-		} else if(macro[pos] == 'c')
-		{
+			data = op.value;
+			break;
+		case OpCode::Channel:
 			// MIDI channel
 			isNibble = true;
 			data = 0xFF;
 #ifndef NO_PLUGINS
-			const PLUGINDEX plug = (plugin != 0) ? plugin : GetBestPlugin(playState, nChn, PrioritiseChannel, EvenIfMuted);
-			if(plug > 0 && plug <= MAX_MIXPLUGINS)
 			{
-				auto midiPlug = dynamic_cast<const IMidiPlugin *>(m_MixPlugins[plug - 1u].pMixPlugin);
-				if(midiPlug)
-					data = midiPlug->GetMidiChannel(playState.Chn[nChn], nChn);
+				const PLUGINDEX plug = (plugin != 0) ? plugin : GetBestPlugin(playState, nChn, PrioritiseChannel, EvenIfMuted);
+				if(plug > 0 && plug <= MAX_MIXPLUGINS)
+				{
+					auto midiPlug = dynamic_cast<const IMidiPlugin *>(m_MixPlugins[plug - 1u].pMixPlugin);
+					if(midiPlug)
+						data = midiPlug->GetMidiChannel(playState.Chn[nChn], nChn);
+				}
 			}
 #endif // NO_PLUGINS
 			if(data == 0xFF)
@@ -5080,71 +5208,75 @@ void CSoundFile::ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool is
 				else
 					data = 0;
 			}
-		} else if(macro[pos] == 'n')
-		{
+			break;
+		case OpCode::Note:
 			// Last triggered note
 			if(ModCommand::IsNote(chn.nLastNote))
 			{
 				data = chn.nLastNote - NOTE_MIN;
 			}
-		} else if(macro[pos] == 'v')
-		{
-			// Velocity
-			// This is "almost" how IT does it - apparently, IT seems to lag one row behind on global volume or channel volume changes.
-			const int swing = (m_playBehaviour[kITSwingBehaviour] || m_playBehaviour[kMPTOldSwingBehaviour]) ? chn.nVolSwing : 0;
-			const int vol = Util::muldiv((chn.nVolume + swing) * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 20);
-			data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
-			//data = (unsigned char)std::min((chn.nVolume * chn.nGlobalVol * m_nGlobalVolume) >> (1 + 6 + 8), 127);
-		} else if(macro[pos] == 'u')
-		{
-			// Calculated volume
-			// Same note as with velocity applies here, but apparently also for instrument / sample volumes?
-			const int vol = Util::muldiv(chn.nCalcVolume * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 26);
-			data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
-			//data = (unsigned char)std::min((chn.nCalcVolume * chn.nGlobalVol * m_nGlobalVolume) >> (7 + 6 + 8), 127);
-		} else if(macro[pos] == 'x')
-		{
+			break;
+		case OpCode::Velocity:
+			{
+				// Velocity
+				// This is "almost" how IT does it - apparently, IT seems to lag one row behind on global volume or channel volume changes.
+				const int swing = (m_playBehaviour[kITSwingBehaviour] || m_playBehaviour[kMPTOldSwingBehaviour]) ? chn.nVolSwing : 0;
+				const int vol = Util::muldiv((chn.nVolume + swing) * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 20);
+				data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
+				//data = (unsigned char)std::min((chn.nVolume * chn.nGlobalVol * m_nGlobalVolume) >> (1 + 6 + 8), 127);
+			}
+			break;
+		case OpCode::CalcVolume:
+			{
+				// Calculated volume
+				// Same note as with velocity applies here, but apparently also for instrument / sample volumes?
+				const int vol = Util::muldiv(chn.nCalcVolume * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 26);
+				data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
+				//data = (unsigned char)std::min((chn.nCalcVolume * chn.nGlobalVol * m_nGlobalVolume) >> (7 + 6 + 8), 127);
+			}
+			break;
+		case OpCode::Pan:
 			// Pan set
 			data = static_cast<uint8>(std::min(static_cast<int>(chn.nPan / 2), 127));
-		} else if(macro[pos] == 'y')
-		{
+			break;
+		case OpCode::CalcPan:
 			// Calculated pan
 			data = static_cast<uint8>(std::min(static_cast<int>(chn.nRealPan / 2), 127));
-		} else if(macro[pos] == 'a')
-		{
+			break;
+		case OpCode::BankHigh:
 			// High byte of bank select
 			if(pIns && pIns->wMidiBank)
 			{
 				data = static_cast<uint8>(((pIns->wMidiBank - 1) >> 7) & 0x7F);
 			}
-		} else if(macro[pos] == 'b')
-		{
+			break;
+		case OpCode::BankLow:
 			// Low byte of bank select
 			if(pIns && pIns->wMidiBank)
 			{
 				data = static_cast<uint8>((pIns->wMidiBank - 1) & 0x7F);
 			}
-		} else if(macro[pos] == 'o')
-		{
+			break;
+		case OpCode::Offset:
 			// Offset (ignoring high offset)
 			data = static_cast<uint8>((chn.oldOffset >> 8) & 0xFF);
-		} else if(macro[pos] == 'h')
-		{
+			break;
+		case OpCode::HostChannel:
 			// Host channel number
 			data = static_cast<uint8>((nChn >= GetNumChannels() ? (chn.nMasterChn - 1) : nChn) & 0x7F);
-		} else if(macro[pos] == 'm')
-		{
+			break;
+		case OpCode::LoopDirection:
 			// Loop direction (judging from the character, it was supposed to be loop type, though)
 			data = chn.dwFlags[CHN_PINGPONGFLAG] ? 1 : 0;
-		} else if(macro[pos] == 'p')
-		{
+			break;
+		case OpCode::Program:
 			// Program select
 			if(pIns && pIns->nMidiProgram)
 			{
 				data = static_cast<uint8>((pIns->nMidiProgram - 1) & 0x7F);
 			}
-		} else if(macro[pos] == 'z')
-		{
+			break;
+		case OpCode::Param:
 			// Zxx parameter
 			data = param;
 			if(isSmooth && chn.lastZxxParam < 0x80
@@ -5159,28 +5291,27 @@ void CSoundFile::ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool is
 			{
 				updateZxxParam = data;
 			}
-		} else if(macro[pos] == 's')
-		{
-			// SysEx Checksum (not an original Impulse Tracker macro variable, but added for convenience)
-			auto startPos = outPos;
-			while(startPos > 0 && out[--startPos] != 0xF0);
-			if(outPos - startPos < 5 || out[startPos] != 0xF0)
-			{
-				continue;
-			}
-			for(auto p = startPos + 5u; p != outPos; p++)
+			break;
+		case OpCode::Checksum:
 			{
-				data += out[p];
+				// SysEx Checksum (not an original Impulse Tracker macro variable, but added for convenience)
+				auto startPos = outPos;
+				while(startPos > 0 && out[--startPos] != 0xF0);
+				if(outPos - startPos < 5 || out[startPos] != 0xF0)
+				{
+					continue;
+				}
+				for(auto p = startPos + 5u; p != outPos; p++)
+				{
+					data += out[p];
+				}
+				data = (~data + 1) & 0x7F;
 			}
-			data = (~data + 1) & 0x7F;
-		} else
-		{
-			// Unrecognized byte (e.g. space char)
-			continue;
+			break;
 		}
 
-		// Append parsed data
-		if(isNibble)  // parsed a nibble (constant or 'c' variable)
+		// Append evaluated data
+		if(isNibble)  // evaluated a nibble (constant or 'c' variable)
 		{
 			if(firstNibble)
 			{
@@ -5191,7 +5322,7 @@ void CSoundFile::ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool is
 				outPos++;
 			}
 			firstNibble = !firstNibble;
-		} else  // parsed a byte (variable)
+		} else  // evaluated a byte (variable)
 		{
 			if(!firstNibble)  // From MIDI.TXT: '9n' is exactly the same as '09 n' or '9 n' -- so finish current byte first
 			{
@@ -36,6 +36,7 @@
 #include "../common/FileReader.h"
 #include "Container.h"
 #include "OPL.h"
+#include "ParallelMix.h"
 #include "mpt/io/io.hpp"
 #include "mpt/io/io_stdstream.hpp"
 
@@ -104,7 +105,6 @@ mpt::ustring FileHistory::AsISO8601(mpt::Date::LogicalTimezone internalTimezone)
 CSoundFile::PlayState::PlayState()
 {
 	std::fill(std::begin(Chn), std::end(Chn), ModChannel{});
-	m_midiMacroScratchSpace.reserve(kMacroLength);  // Note: If macros ever become variable-length, the scratch space needs to be at least one byte longer than the longest macro in the file for end-of-SysEx insertion to stay allocation-free in the mixer!
 }
 
 
@@ -129,9 +129,7 @@ CSoundFile::CSoundFile() :
 	, m_MIDIMapper(*this)
 #endif
 {
-	MemsetZero(MixSoundBuffer);
-	MemsetZero(MixRearBuffer);
-	MemsetZero(MixFloatBuffer);
+	AllocateMixBuffers();
 
 #ifdef MODPLUG_TRACKER
 	m_bChannelMuteTogglePending.reset();
@@ -145,6 +143,7 @@ CSoundFile::CSoundFile() :
 
 	MemsetZero(Instruments);
 	Clear(m_szNames);
+	UpdateMIDIMacroPrograms();
 
 	m_pTuningsTuneSpecific = new CTuningCollection();
 }
@@ -713,6 +712,20 @@ bool CSoundFile::CreateInternal(FileReader file, ModLoadingFlags loadFlags)
 		UpgradeModule();
 	}
 
+	UpdateMIDIMacroPrograms();
+	UpdateSamplePyramids();
+
+#ifndef MODPLUG_TRACKER
+	// Pattern data is not edited after loading, so we can remember where the empty cells are.
+	Patterns.UpdateOccupiedChannels();
+	// The same goes for instrument envelopes, so their values can be looked up instead of being interpolated on every tick.
+	for(INSTRUMENTINDEX ins = 1; ins <= m_nInstruments; ins++)
+	{
+		if(Instruments[ins] != nullptr)
+			Instruments[ins]->UpdateEnvelopeLookupTables();
+	}
+#endif // MODPLUG_TRACKER
+
 #ifndef NO_PLUGINS
 	// Load plugins
 #ifdef MODPLUG_TRACKER
@@ -891,6 +904,7 @@ void CSoundFile::ResetPlayPos()
 	const auto muteFlag = GetChannelMuteFlag();
 	for(CHANNELINDEX i = 0; i < MAX_CHANNELS; i++)
 		m_PlayState.Chn[i].Reset(ModChannel::resetSetPosFull, *this, i, muteFlag);
+	m_PlayState.BackgroundVoices.Reset();
 
 	m_visitedRows.Initialize(true);
 	m_SongFlags.reset(SONG_FADINGSONG | SONG_ENDREACHED);
@@ -31,6 +31,7 @@
 
 #include "Mixer.h"
 #include "Resampler.h"
+#include "FilterCoefficientCache.h"
 #ifndef NO_REVERB
 #include "../sounddsp/Reverb.h"
 #endif
@@ -48,6 +49,7 @@
 #include "ModSample.h"
 #include "ModInstrument.h"
 #include "ModChannel.h"
+#include "VoiceAllocator.h"
 #include "plugins/PluginStructs.h"
 #include "RowVisitor.h"
 #include "Message.h"
@@ -127,12 +129,20 @@ struct SubSong
 };
 
 
+struct SeekCheckpoint;
+
+
 // Target seek mode for GetLength()
 struct GetLengthTarget
 {
 	ROWINDEX startRow;
 	ORDERINDEX startOrder;
 	SEQUENCEINDEX sequence;
+
+	std::vector<SeekCheckpoint> *recordCheckpoints = nullptr;  // If set, a checkpoint is appended to this vector every checkpointInterval seconds
+	const SeekCheckpoint *resumeCheckpoint = nullptr;          // If set, seeking resumes from this checkpoint instead of the start position
+	double checkpointInterval = 0.0;
+	bool checkpointSamplePositions = true;  // Checkpoints can only be resumed by seeks that use the same sample position adjustment
 	
 	struct pos_type
 	{
@@ -200,6 +210,32 @@ struct GetLengthTarget
 		startRow = row;
 		return *this;
 	}
+
+	// Record a snapshot of the playback state every interval seconds, which can later be used to quickly seek into the song.
+	// adjustSamplePositions has to match the reset mode of the seeks that resume from these checkpoints.
+	GetLengthTarget &RecordCheckpoints(std::vector<SeekCheckpoint> &checkpoints, double interval, bool adjustSamplePositions)
+	{
+		recordCheckpoints = &checkpoints;
+		checkpointInterval = interval;
+		checkpointSamplePositions = adjustSamplePositions;
+		return *this;
+	}
+
+	// Continue seeking from a checkpoint previously recorded in the same sequence and subsong.
+	GetLengthTarget &StartFrom(const SeekCheckpoint &checkpoint)
+	{
+		resumeCheckpoint = &checkpoint;
+		return *this;
+	}
+};
+
+
+// Per-channel sample seeking state of GetLength()
+struct GetLengthChnSettings
+{
+	uint32 ticksToRender = 0;	// When using sample sync, we still need to render this many ticks
+	bool incChanged = false;	// When using sample sync, note frequency has changed
+	uint8 vol = 0xFF;
 };
 
 
@@ -233,6 +269,7 @@ class CTuningCollection;
 using CTuningCollection = Tuning::CTuningCollection;
 struct CModSpecifications;
 class OPL;
+struct ParallelMixState;
 class CModDoc;
 
 
@@ -343,6 +380,32 @@ public:
 };
 
 
+// Receives the contribution of each pattern channel to the dry mix, with NNA background channels folded into
+// the pattern channel they originate from. The buffer contains two planar channels (left, right) per pattern channel.
+class IChannelOutput
+{
+public:
+	virtual ~IChannelOutput() = default;
+public:
+	virtual void Process(mpt::audio_span_planar<const MixSampleInt> buffer) = 0;
+	virtual void Process(mpt::audio_span_planar<const MixSampleFloat> buffer) = 0;
+};
+
+
+class CSoundFile;
+
+// Notified by CSoundFile::Read() whenever a new tick starts
+class ITickObserver
+{
+public:
+	virtual ~ITickObserver() = default;
+public:
+	// Called after the pattern data of the new tick has been processed, before it is mixed.
+	// offset is the number of frames that the current Read() call has rendered so far.
+	virtual void OnTick(const CSoundFile &sndFile, uint32 offset) = 0;
+};
+
+
 class AudioSourceNone
 	: public IAudioSource
 {
@@ -423,22 +486,39 @@ private: //Misc data
 	const CModSpecifications *m_pModSpecs;
 
 private:
+	// All mix buffers below point into these, sized according to MixerSettings::m_nMixBlockSize (see AllocateMixBuffers)
+	std::vector<mixsample_t> m_mixBufferStorage;
+	std::vector<float> m_mixFloatBufferStorage;
 	// Interleaved Front Mix Buffer (Also room for interleaved rear mix)
-	mixsample_t MixSoundBuffer[MIXBUFFERSIZE * 4];
-	mixsample_t MixRearBuffer[MIXBUFFERSIZE * 2];
-	// Non-interleaved plugin processing buffer
-	float MixFloatBuffer[2][MIXBUFFERSIZE];
-	mixsample_t MixInputBuffer[NUMMIXINPUTBUFFERS][MIXBUFFERSIZE];
+	mixsample_t *MixSoundBuffer = nullptr;
+	mixsample_t *MixRearBuffer = nullptr;
+	// Non-interleaved plugin processing buffer, also holds the master mix with SNDMIX_FLOATMIX
+	float *MixFloatBuffer[2] = {};
+	// Interleaved output of the floating point master mix
+	MixSampleFloat *MixFloatOutputBuffer = nullptr;
+	mixsample_t *MixInputBuffer[NUMMIXINPUTBUFFERS] = {};
+	// Per-channel output (only allocated when requested through Read)
+	mixsample_t *MixChannelScratchBuffer = nullptr;
+	std::vector<mixsample_t> m_channelOutputBuffer;
+	std::vector<mixsample_t *> m_channelOutputPointers;
+
+	void AllocateMixBuffers();
 
 	// End-of-sample pop reduction tail level
 	mixsample_t m_dryLOfsVol = 0, m_dryROfsVol = 0;
 	mixsample_t m_surroundLOfsVol = 0, m_surroundROfsVol = 0;
 
+	// Worker threads for CreateStereoMix (only allocated if MixerSettings::m_nMixThreads > 1)
+	std::unique_ptr<ParallelMixState> m_parallelMix;
+
+	// Filled by SetupChannelFilter, which is otherwise const
+	mutable FilterCoefficientCache m_filterCoefficients;
+
 public:
 	MixerSettings m_MixerSettings;
 	CResampler m_Resampler;
 #ifndef NO_REVERB
-	mixsample_t ReverbSendBuffer[MIXBUFFERSIZE * 2];
+	mixsample_t *ReverbSendBuffer = nullptr;
 	mixsample_t m_RvbROfsVol = 0, m_RvbLOfsVol = 0;
 	CReverb m_Reverb;
 #endif
@@ -476,7 +556,7 @@ public:
 	FlagSet<SongFlags> m_SongFlags;
 	CHANNELINDEX m_nMixChannels = 0;
 private:
-	CHANNELINDEX m_nMixStat;
+	CHANNELINDEX m_nMixStat = 0;
 public:
 	ROWINDEX m_nDefaultRowsPerBeat, m_nDefaultRowsPerMeasure;	// default rows per beat and measure for this module
 	TempoMode m_nTempoMode = TempoMode::Classic;
@@ -516,7 +596,7 @@ protected:
 	ModSample Samples[MAX_SAMPLES];
 public:
 	ModInstrument *Instruments[MAX_INSTRUMENTS];  // Instrument Headers
-	MIDIMacroConfig m_MidiCfg;                    // MIDI Macro config table
+	MIDIMacroConfig m_MidiCfg;                    // MIDI Macro config table - call UpdateMIDIMacroPrograms() after modifying it
 #ifndef NO_PLUGINS
 	std::array<SNDMIXPLUGIN, MAX_MIXPLUGINS> m_MixPlugins;  // Mix plugins
 	uint32 m_loadedPlugins = 0;                             // Not a PLUGINDEX because number of loaded plugins may exceed MAX_MIXPLUGINS during MIDI conversion
@@ -529,6 +609,7 @@ public:
 	PlayBehaviourSet m_playBehaviour;
 
 protected:
+	MIDIMacroPrograms m_midiMacroPrograms;  // Compiled versions of the Zxx macros in m_MidiCfg
 
 	mpt::fast_prng m_PRNG;
 	inline mpt::fast_prng & AccessPRNG() const { return const_cast<CSoundFile*>(this)->m_PRNG; }
@@ -540,7 +621,9 @@ protected:
 	MixLevels m_nMixLevels;
 
 public:
-	struct PlayState
+	// Global part of the playback state, i.e. everything except for the mixing channels.
+	// Kept separate from PlayState so that it can be cheaply copied into seek checkpoints.
+	struct PlayStateGlobals
 	{
 		friend class CSoundFile;
 
@@ -588,9 +671,24 @@ public:
 	public:
 		bool m_bPositionChanged = true; // Report to plugins that we jumped around in the module
 
+	public:
+		// Copy of this state that keeps the remaining tick samples of another state
+		PlayStateGlobals WithBufferCountOf(const PlayStateGlobals &other) const
+		{
+			PlayStateGlobals result = *this;
+			result.m_nBufferCount = other.m_nBufferCount;
+			return result;
+		}
+	};
+
+	struct PlayState : public PlayStateGlobals
+	{
+		friend class CSoundFile;
+
 	public:
 		CHANNELINDEX ChnMix[MAX_CHANNELS]; // Index of channels in Chn to be actually mixed
 		ModChannel Chn[MAX_CHANNELS];      // Mixing channels... First m_nChannels channels are master channels (i.e. they are never NNA channels)!
+		VoiceAllocator BackgroundVoices;   // Background channels that may still be playing, and the order in which they are replaced by new NNA voices
 
 		struct MIDIMacroEvaluationResults
 		{
@@ -598,7 +696,6 @@ public:
 			std::map<std::pair<PLUGINDEX, PlugParamIndex>, PlugParamValue> pluginParameter;
 		};
 
-		std::vector<uint8> m_midiMacroScratchSpace;
 		std::optional<MIDIMacroEvaluationResults> m_midiMacroEvaluationResults;
 
 	public:
@@ -620,6 +717,9 @@ public:
 
 	PlayState m_PlayState;
 
+	// Optional observer that is notified at the start of every tick rendered by Read()
+	ITickObserver *m_tickObserver = nullptr;
+
 protected:
 	// For handling backwards jumps and stuff to prevent infinite loops when counting the mod length or rendering to wav.
 	RowVisitor m_visitedRows;
@@ -798,6 +898,9 @@ public:
 
 	static ChannelFlags GetChannelMuteFlag();
 
+	// Translate the Zxx macros into the form used during playback. Must be called whenever m_MidiCfg is modified.
+	void UpdateMIDIMacroPrograms() noexcept { m_midiMacroPrograms.Compile(m_MidiCfg); }
+
 #ifdef MODPLUG_TRACKER
 	void PatternTranstionChnSolo(const CHANNELINDEX chnIndex);
 	void PatternTransitionChnUnmuteAll();
@@ -1014,16 +1117,21 @@ public:
 		IAudioTarget &target,
 		IAudioSource &source,
 		std::optional<std::reference_wrapper<IMonitorOutput>> outputMonitor = std::nullopt,
-		std::optional<std::reference_wrapper<IMonitorInput>> inputMonitor = std::nullopt
+		std::optional<std::reference_wrapper<IMonitorInput>> inputMonitor = std::nullopt,
+		std::optional<std::reference_wrapper<IChannelOutput>> channelOutput = std::nullopt
 		);
 	samplecount_t ReadOneTick();
 private:
-	void CreateStereoMix(int count);
+	void CreateStereoMix(int count, bool channelOutput = false);
+	bool CreateStereoMixParallel(int count);
+	mixsample_t *GetChannelMixTarget(CHANNELINDEX mixChn, const ModChannel &chn, int count, mixsample_t *&pOfsR, mixsample_t *&pOfsL, PLUGINDEX &mixPlugin);
+	CHANNELINDEX MixChannel(ModChannel &chn, mixsample_t *pbuffer, mixsample_t &ofsR, mixsample_t &ofsL, int count, bool overMixLimit);
 public:
 	bool FadeSong(uint32 msec);
 private:
 	void ProcessDSP(uint32 countChunk);
-	void ProcessPlugins(uint32 nCount);
+	void ProcessPlugins(uint32 nCount, bool floatMix = false);
+	bool UseFloatMix() const;
 	void ProcessInputChannels(IAudioSource &source, std::size_t countChunk);
 public:
 	samplecount_t GetTotalSampleCount() const { return m_PlayState.m_lTotalSampleCount; }
@@ -1037,9 +1145,12 @@ public:
 	// Mixer Config
 	void SetMixerSettings(const MixerSettings &mixersettings);
 	void SetResamplerSettings(const CResamplerSettings &resamplersettings);
+	// Build the band-limited copies of all samples that do not have them yet if sample pyramids are enabled, or free them otherwise
+	void UpdateSamplePyramids();
 	void InitPlayer(bool bReset=false);
 	void SetDspEffects(uint32 DSPMask);
 	uint32 GetSampleRate() const { return m_MixerSettings.gdwMixingFreq; }
+	uint32 GetMixBlockSize() const { return m_MixerSettings.m_nMixBlockSize; }
 #ifndef NO_EQ
 	void SetEQGains(const uint32 *pGains, const uint32 *pFreqs, bool bReset = false) { m_EQ.SetEQGains(pGains, pFreqs, bReset, m_MixerSettings.gdwMixingFreq); } // 0=-12dB, 32=+12dB
 #endif // NO_EQ
@@ -1049,7 +1160,12 @@ public:
 	bool ProcessEffects();
 	std::pair<bool, bool> NextRow(PlayState &playState, const bool breakRow) const;
 	void SetupNextRow(PlayState &playState, const bool patternLoop) const;
-	CHANNELINDEX GetNNAChannel(CHANNELINDEX nChn) const;
+	CHANNELINDEX GetNNAChannel(CHANNELINDEX nChn);
+#ifdef MPT_VERIFY_VOICEALLOCATOR
+	CHANNELINDEX GetNNAChannelLinear(CHANNELINDEX nChn) const;
+#endif // MPT_VERIFY_VOICEALLOCATOR
+	// Call after changing properties of a background voice that affect the NNA replacement order
+	void InvalidateBackgroundVoice(CHANNELINDEX chn) { m_PlayState.BackgroundVoices.Invalidate(chn); }
 	CHANNELINDEX CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, bool forceCut);
 	void NoteChange(ModChannel &chn, int note, bool bPorta = false, bool bResetEnv = true, bool bManual = false, CHANNELINDEX channelHint = CHANNELINDEX_INVALID) const;
 	void InstrumentChange(ModChannel &chn, uint32 instr, bool bPorta = false, bool bUpdVol = true, bool bResetEnv = true) const;
@@ -1157,12 +1273,14 @@ protected:
 
 	void ProcessMacroOnChannel(CHANNELINDEX nChn);
 	void ProcessMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const MIDIMacroConfigData::Macro &macro, uint8 param = 0, PLUGINDEX plugin = 0);
-	void ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const mpt::span<const char> macro, mpt::span<uint8> &out, uint8 param = 0, PLUGINDEX plugin = 0) const;
+	void ProcessMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const MIDIMacroProgram &macro, uint8 param = 0, PLUGINDEX plugin = 0);
+	void ParseMIDIMacro(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const MIDIMacroProgram &macro, mpt::span<uint8> &out, uint8 param = 0, PLUGINDEX plugin = 0) const;
 	static float CalculateSmoothParamChange(const PlayState &playState, float currentValue, float param);
 	void SendMIDIData(PlayState &playState, CHANNELINDEX nChn, bool isSmooth, const mpt::span<const uint8> macro, PLUGINDEX plugin);
 	void SendMIDINote(CHANNELINDEX chn, uint16 note, uint16 volume);
 
 	int SetupChannelFilter(ModChannel &chn, bool bReset, int envModifier = 256) const;
+	FilterCoefficientCache::Coefficients ComputeFilterCoefficients(int cutoff, int resonance, int envModifier) const;
 	int HandleNoteChangeFilter(ModChannel &chn) const;
 
 	// Low-Level effect processing
@@ -1293,8 +1411,8 @@ public:
 	void ProcessMidiOut(CHANNELINDEX nChn);
 #endif // NO_PLUGINS
 
-	void ProcessGlobalVolume(samplecount_t countChunk);
-	void ProcessStereoSeparation(samplecount_t countChunk);
+	void ProcessGlobalVolume(samplecount_t countChunk, bool floatMix = false);
+	void ProcessStereoSeparation(samplecount_t countChunk, bool floatMix = false);
 
 private:
 	PLUGINDEX GetChannelPlugin(const PlayState &playState, CHANNELINDEX nChn, PluginMutePriority respectMutes) const;
@@ -1307,6 +1425,26 @@ public:
 };
 
 
+// Snapshot of the GetLength() state at the start of a row, from which seeking can be resumed instead of replaying the subsong from its start.
+// Only the pattern channels are stored, as GetLength() never makes use of NNA background channels.
+struct SeekCheckpoint
+{
+	CSoundFile::PlayStateGlobals globals;
+	std::vector<ModChannel> channels;
+	std::vector<GetLengthChnSettings> chnSettings;
+	std::optional<CSoundFile::PlayState::MIDIMacroEvaluationResults> midiMacroEvaluationResults;
+	RowVisitor visitedRows;
+	double elapsedTime = 0.0;      // Time since start of subsong in seconds
+	uint32 tickDuration = 0;       // Tick duration of previous row, for sample sync
+	ORDERINDEX subsongStartOrder = 0;
+	ROWINDEX subsongStartRow = 0;
+	SEQUENCEINDEX sequence = 0;
+	bool breakToRow = false;
+
+	SeekCheckpoint(const RowVisitor &visitedRows) : visitedRows{visitedRows} { }
+};
+
+
 #ifndef NO_PLUGINS
 inline IMixPlugin* CSoundFile::GetInstrumentPlugin(INSTRUMENTINDEX instr) const noexcept
 {
@@ -22,6 +22,8 @@
 #include "plugins/PlugInterface.h"
 #endif // NO_PLUGINS
 #include "OPL.h"
+#include "ParallelMix.h"
+#include "SamplePyramid.h"
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -58,16 +60,100 @@ void CSoundFile::SetMixerSettings(const MixerSettings &mixersettings)
 		||
 		(mixersettings.MixerFlags != m_MixerSettings.MixerFlags))
 		reset = true;
+	const bool resizeBuffers = (mixersettings.m_nMixBlockSize != m_MixerSettings.m_nMixBlockSize);
+	const uint32 mixThreads = m_parallelMix ? m_parallelMix->pool.GetNumThreads() : 1;
+	const bool recreateMixThreads = (mixersettings.m_nMixThreads != mixThreads);
+	if(recreateMixThreads)
+	{
+		m_parallelMix.reset();
+		if(mixersettings.m_nMixThreads > 1)
+			m_parallelMix = std::make_unique<ParallelMixState>(mixersettings.m_nMixThreads);
+	}
 	m_MixerSettings = mixersettings;
+	if(resizeBuffers)
+		AllocateMixBuffers();
+	if(m_parallelMix && (recreateMixThreads || resizeBuffers))
+	{
+		// Voices are mixed into the dry, rear or reverb send buffer, or into the input buffer of a plugin
+		uint32 maxMixTargets = 3;
+#ifndef NO_PLUGINS
+		for(const auto &plugin : m_MixPlugins)
+		{
+			if(plugin.pMixPlugin)
+				maxMixTargets++;
+		}
+#endif // NO_PLUGINS
+		m_parallelMix->Reserve(GetMixBlockSize(), maxMixTargets);
+	}
 	InitPlayer(reset);
 }
 
 
+// (Re-)create all mix buffers with room for one mix block
+void CSoundFile::AllocateMixBuffers()
+{
+	const std::size_t blockSize = GetMixBlockSize();
+	std::size_t intBuffers = 4 + 2 + NUMMIXINPUTBUFFERS + 2;
+#ifndef NO_REVERB
+	intBuffers += 2;
+#endif
+	m_mixBufferStorage.assign(intBuffers * blockSize, 0);
+	m_mixFloatBufferStorage.assign(4 * blockSize, 0.0f);
+
+	mixsample_t *buffer = m_mixBufferStorage.data();
+	MixSoundBuffer = buffer;
+	buffer += blockSize * 4;
+	MixRearBuffer = buffer;
+	buffer += blockSize * 2;
+	for(auto &inputBuffer : MixInputBuffer)
+	{
+		inputBuffer = buffer;
+		buffer += blockSize;
+	}
+	MixChannelScratchBuffer = buffer;
+	buffer += blockSize * 2;
+#ifndef NO_REVERB
+	ReverbSendBuffer = buffer;
+#endif
+
+	MixFloatBuffer[0] = m_mixFloatBufferStorage.data();
+	MixFloatBuffer[1] = MixFloatBuffer[0] + blockSize;
+	MixFloatOutputBuffer = MixFloatBuffer[1] + blockSize;
+
+	// Per-channel outputs are re-created on demand by Read
+	m_channelOutputBuffer.clear();
+	m_channelOutputPointers.clear();
+
+#ifndef NO_PLUGINS
+	for(auto &plugin : m_MixPlugins)
+	{
+		if(plugin.pMixPlugin)
+			plugin.pMixPlugin->SetMixBlockSize(GetMixBlockSize());
+	}
+#endif // NO_PLUGINS
+}
+
+
 void CSoundFile::SetResamplerSettings(const CResamplerSettings &resamplersettings)
 {
 	m_Resampler.m_Settings = resamplersettings;
 	m_Resampler.UpdateTables();
 	InitAmigaResampler();
+	UpdateSamplePyramids();
+}
+
+
+void CSoundFile::UpdateSamplePyramids()
+{
+	// Building the copies takes time proportional to the sample length, so this must not happen while rendering.
+	// Samples without copies (e.g. because their loop was changed by an effect) are mixed from the original sample data.
+	for(SAMPLEINDEX smp = 1; smp <= GetNumSamples(); smp++)
+	{
+		if(!m_Resampler.m_Settings.samplePyramids)
+			Samples[smp].pyramid.reset();
+		else if(!Samples[smp].pyramid)
+			Samples[smp].pyramid = SamplePyramid::Create(Samples[smp]);
+	}
 }
 
 
@@ -169,6 +255,23 @@ static void ApplyStereoSeparation(mixsample_t *mixBuf, std::size_t count, int32
 }
 
 
+// Same as above, for the non-interleaved floating point master mix (SNDMIX_FLOATMIX)
+static void ApplyStereoSeparation(float *mixL, float *mixR, std::size_t count, int32 separation)
+{
+	const float normalize_factor = 0.5f; // cumulative mid/side normalization factor (1/sqrt(2))*(1/sqrt(2))
+	const float factor = static_cast<float>(separation) / static_cast<float>(MixerSettings::StereoSeparationScale); // sep / 128
+	const float mid_factor = normalize_factor;
+	const float side_factor = factor * normalize_factor;
+	for(std::size_t i = 0; i < count; i++)
+	{
+		const float m = (mixL[i] + mixR[i]) * mid_factor;
+		const float s = (mixL[i] - mixR[i]) * side_factor;
+		mixL[i] = m + s;
+		mixR[i] = m - s;
+	}
+}
+
+
 static void ApplyStereoSeparation(mixsample_t *SoundFrontBuffer, mixsample_t *SoundRearBuffer, std::size_t channels, std::size_t countChunk, int32 separation)
 {
 	if(separation == MixerSettings::StereoSeparationScale)
@@ -203,7 +306,7 @@ CSoundFile::samplecount_t CSoundFile::ReadOneTick()
 	ResetMixStat();
 	while(m_PlayState.m_nBufferCount)
 	{
-		auto framesToRender = std::min(m_PlayState.m_nBufferCount, samplecount_t(MIXBUFFERSIZE));
+		auto framesToRender = std::min(m_PlayState.m_nBufferCount, samplecount_t(GetMixBlockSize()));
 		CreateStereoMix(framesToRender);
 		m_PlayState.m_nBufferCount -= framesToRender;
 		m_PlayState.m_lTotalSampleCount += framesToRender;
@@ -216,12 +319,28 @@ CSoundFile::samplecount_t CSoundFile::ReadOneTick()
 }
 
 
-CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &target, IAudioSource &source, std::optional<std::reference_wrapper<IMonitorOutput>> outputMonitor, std::optional<std::reference_wrapper<IMonitorInput>> inputMonitor)
+CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &target, IAudioSource &source, std::optional<std::reference_wrapper<IMonitorOutput>> outputMonitor, std::optional<std::reference_wrapper<IMonitorInput>> inputMonitor, std::optional<std::reference_wrapper<IChannelOutput>> channelOutput)
 {
 	MPT_ASSERT_ALWAYS(m_MixerSettings.IsValid());
 
 	samplecount_t countRendered = 0;
 	samplecount_t countToRender = count;
+	const bool floatMix = UseFloatMix();
+
+	if(channelOutput)
+	{
+		// Left and right planar buffer for each pattern channel
+		const std::size_t numBuffers = GetNumChannels() * 2u;
+		if(m_channelOutputPointers.size() != numBuffers)
+		{
+			m_channelOutputBuffer.assign(numBuffers * GetMixBlockSize(), 0);
+			m_channelOutputPointers.resize(numBuffers);
+			for(std::size_t i = 0; i < numBuffers; i++)
+			{
+				m_channelOutputPointers[i] = m_channelOutputBuffer.data() + i * GetMixBlockSize();
+			}
+		}
+	}
 
 	while(!m_SongFlags[SONG_ENDREACHED] && countToRender > 0)
 	{
@@ -239,6 +358,10 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &ta
 			{
 				// Render next tick (normal progress)
 				MPT_ASSERT(m_PlayState.m_nBufferCount > 0);
+				if(m_tickObserver)
+				{
+					m_tickObserver->OnTick(*this, countRendered);
+				}
 				#ifdef MODPLUG_TRACKER
 					// Save pattern cue points for WAV rendering here (if we reached a new pattern, that is.)
 					if(m_PatternCuePoints != nullptr && (m_PatternCuePoints->empty() || m_PlayState.m_nCurrentOrder != m_PatternCuePoints->back().order))
@@ -291,7 +414,7 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &ta
 
 		MPT_ASSERT(m_PlayState.m_nBufferCount > 0); // assert that we have actually something to do
 
-		const samplecount_t countChunk = std::min({ static_cast<samplecount_t>(MIXBUFFERSIZE), static_cast<samplecount_t>(m_PlayState.m_nBufferCount), static_cast<samplecount_t>(countToRender) });
+		const samplecount_t countChunk = std::min({ static_cast<samplecount_t>(GetMixBlockSize()), static_cast<samplecount_t>(m_PlayState.m_nBufferCount), static_cast<samplecount_t>(countToRender) });
 
 		if(m_MixerSettings.NumInputChannels > 0)
 		{
@@ -308,7 +431,7 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &ta
 			inputMonitor->get().Process(mpt::audio_span_planar<const mixsample_t>(buffers, m_MixerSettings.NumInputChannels, countChunk));
 		}
 
-		CreateStereoMix(countChunk);
+		CreateStereoMix(countChunk, channelOutput.has_value());
 
 		if(m_opl)
 		{
@@ -319,26 +442,37 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &ta
 		m_Reverb.Process(MixSoundBuffer, ReverbSendBuffer, m_RvbROfsVol, m_RvbLOfsVol, countChunk);
 #endif  // NO_REVERB
 
+#ifdef MPT_INTMIXER
+		if(floatMix)
+		{
+			// From here on, the master mix lives in MixFloatBuffer
+			StereoMixToFloat(MixSoundBuffer, MixFloatBuffer[0], MixFloatBuffer[1], countChunk, m_PlayConfig.getIntToFloat());
+		}
+#endif // MPT_INTMIXER
+
 #ifndef NO_PLUGINS
 		if(m_loadedPlugins)
 		{
-			ProcessPlugins(countChunk);
+			ProcessPlugins(countChunk, floatMix);
 		}
 #endif  // NO_PLUGINS
 
 		if(m_MixerSettings.gnChannels == 1)
 		{
-			MonoFromStereo(MixSoundBuffer, countChunk);
+			if(floatMix)
+				MonoFromStereo(MixFloatBuffer[0], MixFloatBuffer[1], countChunk);
+			else
+				MonoFromStereo(MixSoundBuffer, countChunk);
 		}
 
 		if(m_PlayConfig.getGlobalVolumeAppliesToMaster())
 		{
-			ProcessGlobalVolume(countChunk);
+			ProcessGlobalVolume(countChunk, floatMix);
 		}
 
 		if(m_MixerSettings.m_nStereoSeparation != MixerSettings::StereoSeparationScale)
 		{
-			ProcessStereoSeparation(countChunk);
+			ProcessStereoSeparation(countChunk, floatMix);
 		}
 
 		if(m_MixerSettings.DSPMask)
@@ -351,12 +485,28 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioTarget &ta
 			InterleaveFrontRear(MixSoundBuffer, MixRearBuffer, countChunk);
 		}
 
-		if(outputMonitor)
+		if(floatMix)
+		{
+			// The float mix is scaled like the plugin buffers, while the output expects 1.0 to be full scale
+			FloatToOutputMix(MixFloatBuffer[0], MixFloatBuffer[1], MixFloatOutputBuffer, m_MixerSettings.gnChannels, countChunk, m_PlayConfig.getFloatToInt() / MIXING_SCALEF);
+			if(outputMonitor)
+			{
+				outputMonitor->get().Process(mpt::audio_span_interleaved<const MixSampleFloat>(MixFloatOutputBuffer, m_MixerSettings.gnChannels, countChunk));
+			}
+			target.Process(mpt::audio_span_interleaved<MixSampleFloat>(MixFloatOutputBuffer, m_MixerSettings.gnChannels, countChunk));
+		} else
 		{
-			outputMonitor->get().Process(mpt::audio_span_interleaved<const mixsample_t>(MixSoundBuffer, m_MixerSettings.gnChannels, countChunk));
+			if(outputMonitor)
+			{
+				outputMonitor->get().Process(mpt::audio_span_interleaved<const mixsample_t>(MixSoundBuffer, m_MixerSettings.gnChannels, countChunk));
+			}
+			target.Process(mpt::audio_span_interleaved<mixsample_t>(MixSoundBuffer, m_MixerSettings.gnChannels, countChunk));
 		}
 
-		target.Process(mpt::audio_span_interleaved<mixsample_t>(MixSoundBuffer, m_MixerSettings.gnChannels, countChunk));
+		if(channelOutput)
+		{
+			channelOutput->get().Process(mpt::audio_span_planar<const mixsample_t>(m_channelOutputPointers.data(), m_channelOutputPointers.size(), countChunk));
+		}
 
 		// Buffer ready
 		countRendered += countChunk;
@@ -510,6 +660,7 @@ bool CSoundFile::ProcessRow()
 							}
 							chn.dwFlags.set(CHN_NOTEFADE | CHN_KEYOFF);
 							chn.nFadeOutVol = 0;
+							InvalidateBackgroundVoice(i);
 
 							if(i < m_nChannels)
 							{
@@ -644,6 +795,7 @@ bool CSoundFile::ProcessRow()
 					const auto muteFlag = CSoundFile::GetChannelMuteFlag();
 					for(CHANNELINDEX i = 0; i < MAX_CHANNELS; i++)
 						m_PlayState.Chn[i].Reset(ModChannel::resetSetPosFull, *this, i, muteFlag);
+					m_PlayState.BackgroundVoices.Reset();
 					StopAllVsti();
 					// ...and the global playback information.
 					m_PlayState.m_nMusicSpeed = m_nDefaultSpeed;
@@ -2076,6 +2228,9 @@ std::pair<SamplePosition, uint32> CSoundFile::GetChannelIncrement(const ModChann
 
 bool CSoundFile::ReadNote()
 {
+	// Background voices may have stopped while they were being mixed, which changes their NNA replacement order
+	m_PlayState.BackgroundVoices.InvalidateAll();
+
 #ifdef MODPLUG_TRACKER
 	// Checking end of row ?
 	if(m_SongFlags[SONG_PAUSED])
@@ -2135,7 +2290,14 @@ bool CSoundFile::ReadNote()
 	////////////////////////////////////////////////////////////////////////////////////
 	// Update channels data
 	m_nMixChannels = 0;
-	for (CHANNELINDEX nChn = 0; nChn < MAX_CHANNELS; nChn++)
+	// Visit all pattern channels, followed by the background channels that may still be playing
+	const auto nextChannel = [this](CHANNELINDEX nChn) -> CHANNELINDEX
+	{
+		if(nChn + 1 < m_nChannels)
+			return nChn + 1;
+		return m_PlayState.BackgroundVoices.FirstActive(std::max(static_cast<CHANNELINDEX>(nChn + 1), m_nChannels));
+	};
+	for(CHANNELINDEX nChn = (m_nChannels ? 0 : m_PlayState.BackgroundVoices.FirstActive(0)); nChn < MAX_CHANNELS; nChn = nextChannel(nChn))
 	{
 		ModChannel &chn = m_PlayState.Chn[nChn];
 		// FT2 Compatibility: Prevent notes to be stopped after a fadeout. This way, a portamento effect can pick up a faded instrument which is long enough.
@@ -2155,6 +2317,9 @@ bool CSoundFile::ReadNote()
 				ProcessMacroOnChannel(nChn);
 			}
 			chn.nLeftVU = chn.nRightVU = 0;
+			// Stopped background channels are free for NNA again
+			if(nChn >= m_nChannels && !chn.nLength && !chn.HasMIDIOutput() && !chn.dwFlags[CHN_ADLIB])
+				m_PlayState.BackgroundVoices.Release(nChn);
 			continue;
 		}
 		// Reset channel data
@@ -2571,6 +2736,7 @@ bool CSoundFile::ReadNote()
 		chn.dwOldFlags = chn.dwFlags;
 		chn.triggerNote = false;  // For SONG_PAUSED mode
 	}
+	m_PlayState.BackgroundVoices.InvalidateAll();
 
 	// If there are more channels being mixed than allowed, order them by volume and discard the most quiet ones
 	if(m_nMixChannels >= m_MixerSettings.m_nMaxMixChannels)
@@ -2594,9 +2760,9 @@ void CSoundFile::ProcessMacroOnChannel(CHANNELINDEX nChn)
 		if((chn.rowCommand.command == CMD_MIDI && m_SongFlags[SONG_FIRSTTICK]) || chn.rowCommand.command == CMD_SMOOTHMIDI)
 		{
 			if(chn.rowCommand.param < 0x80)
-				ProcessMIDIMacro(m_PlayState, nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_MidiCfg.SFx[chn.nActiveMacro], chn.rowCommand.param);
+				ProcessMIDIMacro(m_PlayState, nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_midiMacroPrograms.SFx[chn.nActiveMacro], chn.rowCommand.param);
 			else
-				ProcessMIDIMacro(m_PlayState, nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_MidiCfg.Zxx[chn.rowCommand.param & 0x7F], chn.rowCommand.param);
+				ProcessMIDIMacro(m_PlayState, nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_midiMacroPrograms.Zxx[chn.rowCommand.param & 0x7F], chn.rowCommand.param);
 		}
 	}
 }
@@ -2742,7 +2908,34 @@ MPT_FORCEINLINE void ApplyGlobalVolumeWithRamping(int32 *SoundBuffer, int32 *Rea
 }
 
 
-void CSoundFile::ProcessGlobalVolume(samplecount_t lCount)
+// Same as above, for the non-interleaved floating point master mix (SNDMIX_FLOATMIX)
+template<int channels>
+MPT_FORCEINLINE void ApplyGlobalVolumeWithRamping(float *SoundBufferL, float *SoundBufferR, uint32 lCount, int32 m_nGlobalVolume, int32 step, int32 &m_nSamplesToGlobalVolRampDest, int32 &m_lHighResRampingGlobalVolume)
+{
+	const bool isStereo = (channels >= 2);
+	const float rampFactor = 1.0f / static_cast<float>(MAX_GLOBAL_VOLUME << VOLUMERAMPPRECISION);
+	const float volume = static_cast<float>(m_nGlobalVolume) / static_cast<float>(MAX_GLOBAL_VOLUME);
+	for(uint32 pos = 0; pos < lCount; ++pos)
+	{
+		float factor;
+		if(m_nSamplesToGlobalVolRampDest > 0)
+		{
+			// Ramping required
+			m_lHighResRampingGlobalVolume += step;
+			factor = static_cast<float>(m_lHighResRampingGlobalVolume) * rampFactor;
+			m_nSamplesToGlobalVolRampDest--;
+		} else
+		{
+			factor = volume;
+			m_lHighResRampingGlobalVolume = m_nGlobalVolume << VOLUMERAMPPRECISION;
+		}
+		                          SoundBufferL[pos] *= factor;
+		if constexpr(isStereo) SoundBufferR[pos] *= factor; else MPT_UNUSED_VARIABLE(SoundBufferR);
+	}
+}
+
+
+void CSoundFile::ProcessGlobalVolume(samplecount_t lCount, bool floatMix)
 {
 
 	// should we ramp?
@@ -2791,7 +2984,13 @@ void CSoundFile::ProcessGlobalVolume(samplecount_t lCount)
 	}
 
 	// apply volume and ramping
-	if(m_MixerSettings.gnChannels == 1)
+	if(floatMix)
+	{
+		if(m_MixerSettings.gnChannels == 1)
+			ApplyGlobalVolumeWithRamping<1>(MixFloatBuffer[0], MixFloatBuffer[1], lCount, m_PlayState.m_nGlobalVolume, step, m_PlayState.m_nSamplesToGlobalVolRampDest, m_PlayState.m_lHighResRampingGlobalVolume);
+		else
+			ApplyGlobalVolumeWithRamping<2>(MixFloatBuffer[0], MixFloatBuffer[1], lCount, m_PlayState.m_nGlobalVolume, step, m_PlayState.m_nSamplesToGlobalVolRampDest, m_PlayState.m_lHighResRampingGlobalVolume);
+	} else if(m_MixerSettings.gnChannels == 1)
 	{
 		ApplyGlobalVolumeWithRamping<1>(MixSoundBuffer, MixRearBuffer, lCount, m_PlayState.m_nGlobalVolume, step, m_PlayState.m_nSamplesToGlobalVolRampDest, m_PlayState.m_lHighResRampingGlobalVolume);
 	} else if(m_MixerSettings.gnChannels == 2)
@@ -2805,10 +3004,35 @@ void CSoundFile::ProcessGlobalVolume(samplecount_t lCount)
 }
 
 
-void CSoundFile::ProcessStereoSeparation(samplecount_t countChunk)
+void CSoundFile::ProcessStereoSeparation(samplecount_t countChunk, bool floatMix)
 {
+	if(floatMix)
+	{
+		if(m_MixerSettings.gnChannels >= 2 && m_MixerSettings.m_nStereoSeparation != MixerSettings::StereoSeparationScale)
+			ApplyStereoSeparation(MixFloatBuffer[0], MixFloatBuffer[1], countChunk, m_MixerSettings.m_nStereoSeparation);
+		return;
+	}
 	ApplyStereoSeparation(MixSoundBuffer, MixRearBuffer, m_MixerSettings.gnChannels, countChunk, m_MixerSettings.m_nStereoSeparation);
 }
 
 
+// The DSP effects and the rear channels only exist in the fixed point mix buffers, so the floating point master mix can only be used without them.
+bool CSoundFile::UseFloatMix() const
+{
+#ifdef MPT_INTMIXER
+	if(!(m_MixerSettings.MixerFlags & SNDMIX_FLOATMIX) || m_MixerSettings.gnChannels > 2)
+		return false;
+#ifndef NO_REVERB
+	// Reverb is applied before the master mix is converted
+	return (m_MixerSettings.DSPMask & ~SNDDSP_REVERB) == 0;
+#else
+	return m_MixerSettings.DSPMask == 0;
+#endif // NO_REVERB
+#else
+	// Everything is floating point already
+	return false;
+#endif // MPT_INTMIXER
+}
+
+
 OPENMPT_NAMESPACE_END
@@ -740,19 +740,13 @@ static void getsinc(SINC_TYPE *psinc, double beta, double cutoff)
 }
 
 
-#ifdef MODPLUG_TRACKER
-bool CResampler::StaticTablesInitialized = false;
-SINC_TYPE CResampler::gKaiserSinc[SINC_PHASES * 8];     // Upsampling
-SINC_TYPE CResampler::gDownsample13x[SINC_PHASES * 8];  // Downsample 1.333x
-SINC_TYPE CResampler::gDownsample2x[SINC_PHASES * 8];   // Downsample 2x
-Paula::BlepTables CResampler::blepTables;               // Amiga BLEP resampler
 #ifndef MPT_INTMIXER
 mixsample_t CResampler::FastSincTablef[256 * 4];        // Cubic spline LUT
+mixsample_t CResampler::LinearTablef[256];              // Linear interpolation LUT
 #endif // !defined(MPT_INTMIXER)
-#endif // MODPLUG_TRACKER
 
 
-void CResampler::InitFloatmixerTables()
+static void InitFloatmixerTables()
 {
 #ifdef MPT_BUILD_FUZZER
 	// Creating resampling tables can take a little while which we really should not spend
@@ -762,82 +756,40 @@ void CResampler::InitFloatmixerTables()
 #endif // MPT_BUILD_FUZZER
 #ifndef MPT_INTMIXER
 	// Prepare fast sinc coefficients for floating point mixer
-	for(std::size_t i = 0; i < std::size(FastSincTable); i++)
+	for(std::size_t i = 0; i < std::size(CResampler::FastSincTable); i++)
 	{
-		FastSincTablef[i] = static_cast<mixsample_t>(FastSincTable[i] * mixsample_t(1.0f / 16384.0f));
+		CResampler::FastSincTablef[i] = static_cast<mixsample_t>(CResampler::FastSincTable[i] * mixsample_t(1.0f / 16384.0f));
 	}
 #endif // !defined(MPT_INTMIXER)
 }
 
 
-void CResampler::InitializeTablesFromScratch(bool force)
+CResamplerSincTables::CResamplerSincTables()
 {
-	bool initParameterIndependentTables = false;
-	if(force)
-	{
-		initParameterIndependentTables = true;
-	}
-#ifdef MODPLUG_TRACKER
-	initParameterIndependentTables = !StaticTablesInitialized;
-#endif  // MODPLUG_TRACKER
-
-	MPT_MAYBE_CONSTANT_IF(initParameterIndependentTables)
-	{
-		InitFloatmixerTables();
-
-		blepTables.InitTables();
-
-		getsinc(gKaiserSinc, 9.6377, 0.97);
-		getsinc(gDownsample13x, 8.5, 0.5);
-		getsinc(gDownsample2x, 7.0, 0.425);
-
-#ifdef MODPLUG_TRACKER
-		StaticTablesInitialized = true;
-#endif  // MODPLUG_TRACKER
-	}
-
-	if((m_OldSettings == m_Settings) && !force)
-	{
-		return;
-	}
-
-	m_WindowedFIR.InitTable(m_Settings.gdWFIRCutoff, m_Settings.gbWFIRType);
-
-	m_OldSettings = m_Settings;
-}
-
+	InitFloatmixerTables();
 
-#ifdef MPT_RESAMPLER_TABLES_CACHED
+	blepTables.InitTables();
 
-static const CResampler & GetCachedResampler()
-{
-	static CResampler s_CachedResampler(true);
-	return s_CachedResampler;
+	getsinc(gKaiserSinc, 9.6377, 0.97);
+	getsinc(gDownsample13x, 8.5, 0.5);
+	getsinc(gDownsample2x, 7.0, 0.425);
 }
 
 
-void CResampler::InitializeTablesFromCache()
+std::shared_ptr<const CResamplerSincTables> CResamplerSincTables::Get()
 {
-	const CResampler & s_CachedResampler = GetCachedResampler();
-	InitFloatmixerTables();
-	std::copy(s_CachedResampler.gKaiserSinc, s_CachedResampler.gKaiserSinc + SINC_PHASES*8, gKaiserSinc);
-	std::copy(s_CachedResampler.gDownsample13x, s_CachedResampler.gDownsample13x + SINC_PHASES*8, gDownsample13x);
-	std::copy(s_CachedResampler.gDownsample2x, s_CachedResampler.gDownsample2x + SINC_PHASES*8, gDownsample2x);
-	std::copy(s_CachedResampler.m_WindowedFIR.lut, s_CachedResampler.m_WindowedFIR.lut + WFIR_LUTLEN*WFIR_WIDTH, m_WindowedFIR.lut);
-	blepTables = s_CachedResampler.blepTables;
+	// Built exactly once (which also initializes the static float mixer tables) and never freed
+	static const std::shared_ptr<const CResamplerSincTables> sharedTables = std::make_shared<const CResamplerSincTables>();
+	return sharedTables;
 }
 
-#endif // MPT_RESAMPLER_TABLES_CACHED
-
 
 #ifdef MPT_RESAMPLER_TABLES_CACHED_ONSTARTUP
 
 struct ResampleCacheInitializer
 {
-	ResampleCacheInitializer()
-	{
-		GetCachedResampler();
-	}
+	// Builds the tables before the first module is loaded
+	std::shared_ptr<const CResamplerSincTables> tables = CResamplerSincTables::Get();
 };
 #if MPT_COMPILER_CLANG
 #pragma clang diagnostic push
@@ -0,0 +1,218 @@
+/*
+ * VoiceAllocator.h
+ * ----------------
+ * Purpose: Bookkeeping of background (NNA) voices: which background channels are in use, and which of them
+ *          should be replaced first when a new NNA voice is needed.
+ * Notes  : The stealing order is kept in a tournament tree over all channels (an indexed priority queue),
+ *          so that finding the voice to be replaced costs O(1) once the tree is up to date. The order is exactly
+ *          the one of the original linear search in CSoundFile::GetNNAChannel, including the tie-breaking by channel index.
+ *          Priorities are updated lazily: a voice must be invalidated whenever any of the channel properties used
+ *          in MakeKey change, and Refresh must be called before querying the order. As background voices change
+ *          on every tick anyway, this way the priorities are only recomputed on ticks that actually need a new voice.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "openmpt/all/BuildSettings.hpp"
+
+#include "ChannelSet.h"
+#include "ModChannel.h"
+
+#include <array>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+#if defined(MPT_BUILD_DEBUG) || defined(MPT_BUILD_FUZZER)
+#define MPT_VERIFY_VOICEALLOCATOR
+#endif  // MPT_BUILD_DEBUG || MPT_BUILD_FUZZER
+
+
+class VoiceAllocator
+{
+public:
+	enum class Priority : uint8
+	{
+		Stopped = 0,  // Sample has stopped and no plugin note is playing: Can be reused right away
+		Silent  = 1,  // Fade-out has finished
+		Playing = 2,  // Ordered by volume, then by envelope position
+		None    = 3,  // Channel is not a background voice
+	};
+
+	struct Key
+	{
+		Priority priority = Priority::None;
+		uint32 volume = 0;       // Combination of real volume and note volume, halved for looped samples
+		uint32 envPosition = 0;  // Voices further into their volume envelope are replaced first
+	};
+
+	VoiceAllocator() noexcept
+	{
+		m_winner.fill(0);
+		Reset();
+	}
+
+	// Stop tracking all voices
+	void Reset() noexcept
+	{
+		m_active.reset();
+		m_dirty.reset();
+		m_oplVoices.reset();
+		m_keys.fill(Key{});
+		Rebuild();
+	}
+
+	// Start tracking a channel that has just been set up as a background voice
+	void Activate(CHANNELINDEX chn) noexcept
+	{
+		m_active.set(chn);
+		m_dirty.set(chn);
+	}
+
+	// Stop tracking a channel that no longer plays anything
+	void Release(CHANNELINDEX chn) noexcept
+	{
+		m_active.reset(chn);
+		m_dirty.reset(chn);
+		m_oplVoices.reset(chn);
+		SetKey(chn, Key{});
+	}
+
+	// Mark the priority of a channel as outdated after its properties have changed. Does nothing if the channel is not a background voice.
+	void Invalidate(CHANNELINDEX chn) noexcept
+	{
+		if(m_active.test(chn))
+			m_dirty.set(chn);
+	}
+
+	// Mark the priorities of all background voices as outdated
+	void InvalidateAll() noexcept { m_dirty = m_active; }
+
+	// Recompute the priorities of all outdated voices
+	void Refresh(const ModChannel *channels) noexcept
+	{
+		CHANNELINDEX chn = m_dirty.FindFirstSet(0);
+		if(chn == CHANNELINDEX_INVALID)
+			return;
+		int numDirty = 0;
+		for(; chn != CHANNELINDEX_INVALID; chn = m_dirty.FindFirstSet(chn + 1))
+		{
+			const ModChannel &channel = channels[chn];
+			if(channel.dwFlags[CHN_ADLIB])
+				m_oplVoices.set(chn);
+			else
+				m_oplVoices.reset(chn);
+			m_keys[chn] = MakeKey(channel);
+			numDirty++;
+		}
+		// Replaying each leaf-to-root path costs log2(MAX_CHANNELS) comparisons, a full rebuild costs MAX_CHANNELS.
+		if(numDirty >= MAX_CHANNELS / 8)
+		{
+			Rebuild();
+		} else
+		{
+			for(chn = m_dirty.FindFirstSet(0); chn != CHANNELINDEX_INVALID; chn = m_dirty.FindFirstSet(chn + 1))
+				Replay(chn);
+		}
+		m_dirty.reset();
+	}
+
+	bool IsActive(CHANNELINDEX chn) const noexcept { return m_active.test(chn); }
+	// Lowest background voice index >= first, or CHANNELINDEX_INVALID
+	CHANNELINDEX FirstActive(CHANNELINDEX first) const noexcept { return m_active.FindFirstSet(first); }
+	// Lowest channel index >= first that is not a background voice, or CHANNELINDEX_INVALID
+	CHANNELINDEX FirstInactive(CHANNELINDEX first) const noexcept { return m_active.FindFirstUnset(first); }
+	bool IsUpToDate() const noexcept { return m_dirty.FindFirstSet(0) == CHANNELINDEX_INVALID; }
+
+	// The following functions require all priorities to be up to date.
+	// Background voices playing OPL instruments, whose state also depends on the OPL emulator
+	const ChannelSet &OPLVoices() const noexcept { return m_oplVoices; }
+
+	// The voice that should be replaced first, or CHANNELINDEX_INVALID if there are no background voices
+	CHANNELINDEX Best() const noexcept
+	{
+		MPT_ASSERT(IsUpToDate());
+		const CHANNELINDEX chn = m_winner[1];
+		return (m_keys[chn].priority != Priority::None) ? chn : CHANNELINDEX_INVALID;
+	}
+
+	const Key &GetKey(CHANNELINDEX chn) const noexcept { return m_keys[chn]; }
+
+	static Key MakeKey(const ModChannel &chn) noexcept
+	{
+		Key key;
+		if(!chn.nLength && (!chn.HasMIDIOutput() || chn.dwFlags[CHN_KEYOFF | CHN_NOTEFADE]))
+		{
+			key.priority = Priority::Stopped;
+		} else if(chn.nLength && !chn.nFadeOutVol)
+		{
+			key.priority = Priority::Silent;
+		} else
+		{
+			key.priority = Priority::Playing;
+			// Use a combination of real volume [14 bit] (which includes volume envelopes, but also potentially global volume) and note volume [9 bit].
+			// Rationale: We need volume envelopes in case e.g. all NNA channels are playing at full volume but are looping on a 0-volume envelope node.
+			// But if global volume is not applied to master and the global volume temporarily drops to 0, we would kill arbitrary channels. Hence, add the note volume as well.
+			key.volume = (chn.nRealVolume << 9) | chn.nVolume;
+			if(chn.dwFlags[CHN_LOOP])
+				key.volume /= 2;
+			key.envPosition = chn.VolEnv.nEnvPosition;
+		}
+		return key;
+	}
+
+	// Returns true if a should be replaced before b. Voices with the same priority are replaced in channel order.
+	static bool IsBetter(const Key &a, const Key &b) noexcept
+	{
+		if(a.priority != b.priority)
+			return a.priority < b.priority;
+		if(a.priority != Priority::Playing)
+			return false;
+		return (a.volume < b.volume) || (a.volume == b.volume && a.envPosition > b.envPosition);
+	}
+
+private:
+	// Node 1 is the root, nodes [1, MAX_CHANNELS) are internal, node MAX_CHANNELS + chn is the leaf of channel chn.
+	CHANNELINDEX Child(std::size_t node, std::size_t which) const noexcept
+	{
+		const std::size_t child = node * 2 + which;
+		return (child >= MAX_CHANNELS) ? static_cast<CHANNELINDEX>(child - MAX_CHANNELS) : m_winner[child];
+	}
+
+	CHANNELINDEX Winner(CHANNELINDEX left, CHANNELINDEX right) const noexcept
+	{
+		// Channels in the left subtree always have lower indices
+		return IsBetter(m_keys[right], m_keys[left]) ? right : left;
+	}
+
+	void SetKey(CHANNELINDEX chn, const Key &key) noexcept
+	{
+		m_keys[chn] = key;
+		Replay(chn);
+	}
+
+	// Update the path from a leaf to the root
+	void Replay(CHANNELINDEX chn) noexcept
+	{
+		for(std::size_t node = (MAX_CHANNELS + chn) / 2; node >= 1; node /= 2)
+			m_winner[node] = Winner(Child(node, 0), Child(node, 1));
+	}
+
+	void Rebuild() noexcept
+	{
+		for(std::size_t node = MAX_CHANNELS - 1; node >= 1; node--)
+			m_winner[node] = Winner(Child(node, 0), Child(node, 1));
+	}
+
+	ChannelSet m_active;
+	ChannelSet m_dirty;  // Voices whose key is outdated
+	ChannelSet m_oplVoices;
+	std::array<Key, MAX_CHANNELS> m_keys;
+	std::array<CHANNELINDEX, MAX_CHANNELS> m_winner;  // Winning channel of each internal tree node
+};
+
+
+OPENMPT_NAMESPACE_END
@@ -12,7 +12,10 @@
 #include "stdafx.h"
 #include "WindowedFIR.h"
 #include "mpt/base/numbers.hpp"
+#include "mpt/mutex/mutex.hpp"
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -96,4 +99,45 @@ void CWindowedFIR::InitTable(double WFIRCutoff, uint8 WFIRType)
 }
 
 
+
+std::shared_ptr<const CWindowedFIR> CWindowedFIR::Get(double WFIRCutoff, uint8 WFIRType)
+{
+	struct CacheEntry
+	{
+		double cutoff;
+		uint8 type;
+		std::weak_ptr<const CWindowedFIR> table;
+		std::shared_ptr<const CWindowedFIR> keepAlive;  // Only set for the default settings
+	};
+	static mpt::mutex cacheMutex;
+	static std::vector<CacheEntry> cache;
+
+	mpt::lock_guard<mpt::mutex> lock(cacheMutex);
+#if MPT_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wfloat-equal"
+#endif // MPT_COMPILER_CLANG
+	for(auto &entry : cache)
+	{
+		if(entry.cutoff == WFIRCutoff && entry.type == WFIRType)
+		{
+			if(auto table = entry.table.lock())
+				return table;
+		}
+	}
+	// Almost every module uses the default table, so it is not rebuilt whenever the last module using it is gone
+	const bool isDefault = (WFIRCutoff == WFIR_DEFAULT_CUTOFF && WFIRType == WFIR_DEFAULT_TYPE);
+#if MPT_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif // MPT_COMPILER_CLANG
+	// Tables that are no longer used by anyone are replaced
+	cache.erase(std::remove_if(cache.begin(), cache.end(), [](const CacheEntry &entry) { return entry.table.expired(); }), cache.end());
+
+	auto table = std::make_shared<CWindowedFIR>();
+	table->InitTable(WFIRCutoff, WFIRType);
+	cache.push_back({WFIRCutoff, WFIRType, table, isDefault ? table : nullptr});
+	return table;
+}
+
+
 OPENMPT_NAMESPACE_END
@@ -15,6 +15,8 @@
 
 #include "Mixer.h"
 
+#include <memory>
+
 OPENMPT_NAMESPACE_BEGIN
 
 /*
@@ -62,6 +64,9 @@ enum WFIRType
 	WFIR_BLACKMAN4T74  = 6,  // Blackman 4-Tap 74
 	WFIR_KAISER4T      = 7,  // Kaiser a=7.5
 };
+// default settings
+inline constexpr double WFIR_DEFAULT_CUTOFF = 0.97;
+inline constexpr uint8 WFIR_DEFAULT_TYPE = WFIR_KAISER4T;
 
 
 // fir interpolation
@@ -77,6 +82,9 @@ private:
 public:
 	void InitTable(double WFIRCutoff, uint8 WFIRType);
 	WFIR_TYPE lut[WFIR_LUTLEN * WFIR_WIDTH];
+
+	// Returns the table for the given parameters, shared with all other users of the same parameters in the process
+	static std::shared_ptr<const CWindowedFIR> Get(double WFIRCutoff, uint8 WFIRType);
 };
 
 OPENMPT_NAMESPACE_END
@@ -40,6 +40,10 @@ bool CPattern::IsEmptyRow(ROWINDEX row) const noexcept
 	{
 		return true;
 	}
+	if(row < m_occupiedChannels.size())
+	{
+		return m_occupiedChannels[row].FindFirstSet(0) == CHANNELINDEX_INVALID;
+	}
 
 	for(const auto &m : GetRow(row))
 	{
@@ -52,6 +56,36 @@ bool CPattern::IsEmptyRow(ROWINDEX row) const noexcept
 }
 
 
+void CPattern::UpdateOccupiedChannels()
+{
+	m_occupiedChannels.clear();
+	if(m_ModCommands.empty())
+		return;
+	std::vector<PatternChannelSet> occupied(m_Rows);
+	for(ROWINDEX row = 0; row < m_Rows; row++)
+	{
+		occupied[row] = GetOccupiedChannels(row);
+	}
+	m_occupiedChannels = std::move(occupied);
+}
+
+
+PatternChannelSet CPattern::GetOccupiedChannels(ROWINDEX row) const noexcept
+{
+	if(row < m_occupiedChannels.size())
+		return m_occupiedChannels[row];
+
+	PatternChannelSet occupied;
+	const ModCommand *m = GetpModCommand(row, 0);
+	for(CHANNELINDEX chn = 0; chn < GetNumChannels(); chn++, m++)
+	{
+		if(!m->IsEmpty())
+			occupied.set(chn);
+	}
+	return occupied;
+}
+
+
 bool CPattern::SetSignature(const ROWINDEX rowsPerBeat, const ROWINDEX rowsPerMeasure) noexcept
 {
 	if(rowsPerBeat < 1
@@ -99,6 +133,7 @@ bool CPattern::Resize(const ROWINDEX newRowCount, bool enforceFormatLimits, bool
 	}
 
 	m_Rows = newRowCount;
+	m_occupiedChannels.clear();
 	return true;
 }
 
@@ -106,6 +141,7 @@ bool CPattern::Resize(const ROWINDEX newRowCount, bool enforceFormatLimits, bool
 void CPattern::ClearCommands() noexcept
 {
 	std::fill(m_ModCommands.begin(), m_ModCommands.end(), ModCommand{});
+	m_occupiedChannels.clear();
 }
 
 
@@ -125,6 +161,7 @@ bool CPattern::AllocatePattern(ROWINDEX rows)
 		// Do this in two steps in order to keep the old pattern data in case of OOM
 		decltype(m_ModCommands) newPattern(newSize, ModCommand{});
 		m_ModCommands = std::move(newPattern);
+		m_occupiedChannels.clear();
 	}
 	m_Rows = rows;
 	return true;
@@ -135,6 +172,7 @@ void CPattern::Deallocate()
 {
 	m_Rows = m_RowsPerBeat = m_RowsPerMeasure = 0;
 	m_ModCommands.clear();
+	m_occupiedChannels.clear();
 	m_PatternName.clear();
 }
 
@@ -145,6 +183,7 @@ CPattern& CPattern::operator= (const CPattern &pat)
 		return *this;
 
 	m_ModCommands = pat.m_ModCommands;
+	m_occupiedChannels.clear();
 	m_Rows = pat.m_Rows;
 	m_RowsPerBeat = pat.m_RowsPerBeat;
 	m_RowsPerMeasure = pat.m_RowsPerMeasure;
@@ -204,6 +243,7 @@ bool CPattern::Expand()
 	}
 
 	m_ModCommands = std::move(newPattern);
+	m_occupiedChannels.clear();
 	m_Rows = newRows;
 
 	return true;
@@ -253,6 +293,7 @@ bool CPattern::Shrink()
 		}
 	}
 	m_ModCommands.resize(m_Rows * nChns);
+	m_occupiedChannels.clear();
 
 	return true;
 }
@@ -290,6 +331,7 @@ bool CPattern::WriteEffect(EffectWriter &settings)
 	{
 		return false;
 	}
+	m_occupiedChannels.clear();
 
 	CHANNELINDEX scanChnMin = settings.m_channel, scanChnMax = settings.m_channel;
 
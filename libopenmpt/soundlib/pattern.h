@@ -14,6 +14,7 @@
 
 #include <vector>
 #include "modcommand.h"
+#include "ChannelSet.h"
 #include "Snd_defs.h"
 
 
@@ -61,6 +62,12 @@ public:
 	// Check if there is any note data on a given row.
 	bool IsEmptyRow(ROWINDEX row) const noexcept;
 
+	// Remember which channels contain any data on each row, so that code iterating over rows can skip empty cells.
+	// Must be called again after modifying pattern data through pointers or iterators; all other modifications discard the information.
+	void UpdateOccupiedChannels();
+	// Returns the channels that contain any data on a given row.
+	PatternChannelSet GetOccupiedChannels(ROWINDEX row) const noexcept;
+
 	// Allocate new pattern memory and replace old pattern data.
 	bool AllocatePattern(ROWINDEX rows);
 	// Deallocate pattern data.
@@ -74,7 +81,7 @@ public:
 	const CSoundFile& GetSoundFile() const noexcept;
 
 	const std::vector<ModCommand> &GetData() const { return m_ModCommands; }
-	void SetData(std::vector<ModCommand> &&data) { MPT_ASSERT(data.size() == GetNumRows() * GetNumChannels()); m_ModCommands = std::move(data); }
+	void SetData(std::vector<ModCommand> &&data) { MPT_ASSERT(data.size() == GetNumRows() * GetNumChannels()); m_ModCommands = std::move(data); m_occupiedChannels.clear(); }
 
 	// Set pattern signature (rows per beat, rows per measure). Returns true on success.
 	bool SetSignature(const ROWINDEX rowsPerBeat, const ROWINDEX rowsPerMeasure) noexcept;
@@ -128,6 +135,7 @@ protected:
 
 protected:
 	std::vector<ModCommand> m_ModCommands;
+	std::vector<PatternChannelSet> m_occupiedChannels;  // Channels that contain any data on each row, empty if unknown
 	ROWINDEX m_Rows = 0;
 	ROWINDEX m_RowsPerBeat = 0;    // patterns-specific time signature. if != 0, this is implicitely set.
 	ROWINDEX m_RowsPerMeasure = 0; // ditto
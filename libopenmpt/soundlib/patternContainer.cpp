@@ -131,6 +131,15 @@ void CPatternContainer::ResizeArray(const PATTERNINDEX newSize)
 }
 
 
+void CPatternContainer::UpdateOccupiedChannels()
+{
+	for(auto &pattern : m_Patterns)
+	{
+		pattern.UpdateOccupiedChannels();
+	}
+}
+
+
 void CPatternContainer::OnModTypeChanged(const MODTYPE /*oldtype*/)
 {
 	const CModSpecifications specs = m_rSndFile.GetModSpecifications();
@@ -80,6 +80,9 @@ public:
 
 	// Returns true if the pattern is empty, i.e. there are no notes/effects in this pattern
 	bool IsPatternEmpty(const PATTERNINDEX nPat) const noexcept;
+
+	// Remember which channels contain data on each row of all patterns, see CPattern::UpdateOccupiedChannels
+	void UpdateOccupiedChannels();
 	
 	void ResizeArray(const PATTERNINDEX newSize);
 
@@ -102,7 +105,10 @@ template <class Func>
 void CPatternContainer::ForEachModCommand(Func func)
 {
 	for(auto &pattern : m_Patterns)
+	{
 		std::for_each(pattern.begin(), pattern.end(), func);
+		pattern.m_occupiedChannels.clear();
+	}
 }
 
 
@@ -30,12 +30,12 @@
 #include "../mod_specifications.h"
 #endif // MODPLUG_TRACKER
 #include "../../soundlib/AudioCriticalSection.h"
-#include "mpt/base/aligned_array.hpp"
 #include "mpt/io/base.hpp"
 #include "mpt/io/io.hpp"
 #include "mpt/io/io_span.hpp"
 
 #include <cmath>
+#include <memory>
 
 #ifndef NO_PLUGINS
 
@@ -52,9 +52,10 @@ IMixPlugin::IMixPlugin(VSTPluginLib &factory, CSoundFile &sndFile, SNDMIXPLUGIN
 	: m_Factory(factory)
 	, m_SndFile(sndFile)
 	, m_pMixStruct(&mixStruct)
+	, m_mixBuffer(sndFile.GetMixBlockSize())
 {
 	m_SndFile.m_loadedPlugins++;
-	m_MixState.pMixBuffer = mpt::align_bytes<8, MIXBUFFERSIZE * 2>(m_MixBuffer);
+	SetMixBlockSize(sndFile.GetMixBlockSize());
 	while(m_pMixStruct != &(m_SndFile.m_MixPlugins[m_nSlot]) && m_nSlot < MAX_MIXPLUGINS - 1)
 	{
 		m_nSlot++;
@@ -62,6 +63,17 @@ IMixPlugin::IMixPlugin(VSTPluginLib &factory, CSoundFile &sndFile, SNDMIXPLUGIN
 }
 
 
+void IMixPlugin::SetMixBlockSize(uint32 numFrames)
+{
+	m_mixBuffer.SetBufferSize(numFrames);
+	m_MixBuffer.assign(numFrames * 2 + 2, 0);
+	m_silenceOutput.assign(numFrames * 2, 0.0f);
+	void *buf = m_MixBuffer.data();
+	std::size_t space = m_MixBuffer.size() * sizeof(mixsample_t);
+	m_MixState.pMixBuffer = static_cast<mixsample_t *>(std::align(8, numFrames * 2 * sizeof(mixsample_t), buf, space));
+}
+
+
 IMixPlugin::~IMixPlugin()
 {
 #ifdef MODPLUG_TRACKER
@@ -354,21 +366,23 @@ float IMixPlugin::RenderSilence(uint32 numFrames)
 		Resume();
 	}
 
-	float out[2][MIXBUFFERSIZE]; // scratch buffers
+	const uint32 blockSize = m_mixBuffer.GetBufferSize();
+	float *outL = m_silenceOutput.data(), *outR = outL + blockSize;
 	float maxVal = 0.0f;
-	m_mixBuffer.ClearInputBuffers(MIXBUFFERSIZE);
+	m_mixBuffer.ClearInputBuffers(blockSize);
 
 	while(numFrames > 0)
 	{
 		uint32 renderSamples = numFrames;
-		LimitMax(renderSamples, mpt::saturate_cast<uint32>(std::size(out[0])));
-		MemsetZero(out);
+		LimitMax(renderSamples, blockSize);
+		std::fill(outL, outL + renderSamples, 0.0f);
+		std::fill(outR, outR + renderSamples, 0.0f);
 
-		Process(out[0], out[1], renderSamples);
+		Process(outL, outR, renderSamples);
 		for(size_t i = 0; i < renderSamples; i++)
 		{
-			maxVal = std::max(maxVal, std::fabs(out[0][i]));
-			maxVal = std::max(maxVal, std::fabs(out[1][i]));
+			maxVal = std::max(maxVal, std::fabs(outL[i]));
+			maxVal = std::max(maxVal, std::fabs(outR[i]));
 		}
 
 		numFrames -= renderSamples;
@@ -70,10 +70,11 @@ protected:
 
 public:
 	SNDMIXPLUGINSTATE m_MixState;
-	PluginMixBuffer<float, MIXBUFFERSIZE> m_mixBuffer;	// Float buffers (input and output) for plugins
+	PluginMixBuffer<float> m_mixBuffer;	// Float buffers (input and output) for plugins
 
 protected:
-	mixsample_t m_MixBuffer[MIXBUFFERSIZE * 2 + 2];		// Stereo interleaved input (sample mixer renders here)
+	std::vector<mixsample_t> m_MixBuffer;	// Stereo interleaved input (sample mixer renders here)
+	std::vector<float> m_silenceOutput;	// Left and right output of RenderSilence, one mix block each
 
 	float m_fGain = 1.0f;
 	PLUGINDEX m_nSlot = 0;
@@ -104,6 +105,9 @@ public:
 	inline CSoundFile &GetSoundFile() { return m_SndFile; }
 	inline const CSoundFile &GetSoundFile() const { return m_SndFile; }
 
+	// Resize the input and output buffers to hold the given number of frames (called when the mix block size changes)
+	void SetMixBlockSize(uint32 numFrames);
+
 #ifdef MODPLUG_TRACKER
 	CModDoc *GetModDoc();
 	const CModDoc *GetModDoc() const;
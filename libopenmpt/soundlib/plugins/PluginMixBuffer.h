@@ -13,11 +13,8 @@
 #include "openmpt/all/BuildSettings.hpp"
 
 #include <algorithm>
-#include <array>
-
-#if defined(MPT_ENABLE_ARCH_INTRINSICS) || defined(MPT_WITH_VST)
-#include "mpt/base/aligned_array.hpp"
-#endif // MPT_ENABLE_ARCH_INTRINSICS || MPT_WITH_VST
+#include <memory>
+#include <vector>
 
 
 OPENMPT_NAMESPACE_BEGIN
@@ -25,82 +22,100 @@ OPENMPT_NAMESPACE_BEGIN
 
 // At least this part of the code is ready for double-precision rendering... :>
 // buffer_t: Sample buffer type (float, double, ...)
-// bufferSize: Buffer size in samples
-template<typename buffer_t, uint32 bufferSize>
+// The buffer size (in samples) follows the mix block size and can be changed at runtime.
+template<typename buffer_t>
 class PluginMixBuffer
 {
 
 private:
 
 #if defined(MPT_ENABLE_ARCH_INTRINSICS) || defined(MPT_WITH_VST)
-	static constexpr std::align_val_t alignment = std::align_val_t{16};
-	static_assert(sizeof(mpt::aligned_array<buffer_t, bufferSize, alignment>) == sizeof(std::array<buffer_t, bufferSize>));
-	static_assert(alignof(mpt::aligned_array<buffer_t, bufferSize, alignment>) == static_cast<std::size_t>(alignment));
+	static constexpr std::size_t alignment = 16;
+#else // !(MPT_ENABLE_ARCH_INTRINSICS || MPT_WITH_VST)
+	static constexpr std::size_t alignment = alignof(buffer_t);
 #endif // MPT_ENABLE_ARCH_INTRINSICS || MPT_WITH_VST
+	static_assert((alignment % sizeof(buffer_t)) == 0);
 
 protected:
 
-#if defined(MPT_ENABLE_ARCH_INTRINSICS) || defined(MPT_WITH_VST)
-	std::vector<mpt::aligned_array<buffer_t, bufferSize, alignment>> inputs;
-	std::vector<mpt::aligned_array<buffer_t, bufferSize, alignment>> outputs;
-#else // !(MPT_ENABLE_ARCH_INTRINSICS || MPT_WITH_VST)
-	std::vector<std::array<buffer_t, bufferSize>> inputs;
-	std::vector<std::array<buffer_t, bufferSize>> outputs;
-#endif // MPT_ENABLE_ARCH_INTRINSICS || MPT_WITH_VST
+	// All input buffers followed by all output buffers, each one starting at an aligned address
+	std::vector<buffer_t> storage;
 	std::vector<buffer_t*> inputsarray;
 	std::vector<buffer_t*> outputsarray;
+	uint32 bufferSize = 0;
 
 public:
 
 	// Allocate input and output buffers
-	bool Initialize(uint32 numInputs, uint32 numOutputs)
+	bool Initialize(uint32 numInputs, uint32 numOutputs, uint32 numSamples)
 	{
 		// Short cut - we do not need to recreate the buffers.
-		if(inputs.size() == numInputs && outputs.size() == numOutputs)
+		if(inputsarray.size() == numInputs && outputsarray.size() == numOutputs && bufferSize == numSamples)
 		{
 			return true;
 		}
 
+		// Round up so that every buffer stays aligned
+		constexpr std::size_t alignmentSamples = alignment / sizeof(buffer_t);
+		const std::size_t stride = (numSamples + alignmentSamples - 1) & ~(alignmentSamples - 1);
 		try
 		{
-			inputs.resize(numInputs);
-			outputs.resize(numOutputs);
+			storage.assign(stride * (numInputs + numOutputs) + alignmentSamples - 1, buffer_t{0});
 			inputsarray.resize(numInputs);
 			outputsarray.resize(numOutputs);
 		} catch(mpt::out_of_memory e)
 		{
 			mpt::delete_out_of_memory(e);
-			inputs.clear();
-			inputs.shrink_to_fit();
-			outputs.clear();
-			outputs.shrink_to_fit();
+			storage.clear();
+			storage.shrink_to_fit();
 			inputsarray.clear();
 			inputsarray.shrink_to_fit();
 			outputsarray.clear();
 			outputsarray.shrink_to_fit();
+			bufferSize = 0;
 			return false;
 		}
+		bufferSize = numSamples;
+
+		void *buf = storage.data();
+		std::size_t space = storage.size() * sizeof(buffer_t);
+		buffer_t *data = static_cast<buffer_t *>(std::align(alignment, stride * (numInputs + numOutputs) * sizeof(buffer_t), buf, space));
 
 		for(uint32 i = 0; i < numInputs; i++)
 		{
-			inputsarray[i] = inputs[i].data();
+			inputsarray[i] = data;
+			data += stride;
 		}
 
 		for(uint32 i = 0; i < numOutputs; i++)
 		{
-			outputsarray[i] = outputs[i].data();
+			outputsarray[i] = data;
+			data += stride;
 		}
 
 		return true;
 	}
 
+	bool Initialize(uint32 numInputs, uint32 numOutputs)
+	{
+		return Initialize(numInputs, numOutputs, bufferSize);
+	}
+
+	// Change the size of all buffers, keeping the number of inputs and outputs
+	bool SetBufferSize(uint32 numSamples)
+	{
+		return Initialize(static_cast<uint32>(inputsarray.size()), static_cast<uint32>(outputsarray.size()), numSamples);
+	}
+
+	uint32 GetBufferSize() const { return bufferSize; }
+
 	// Silence all input buffers.
 	void ClearInputBuffers(uint32 numSamples)
 	{
 		MPT_ASSERT(numSamples <= bufferSize);
-		for(size_t i = 0; i < inputs.size(); i++)
+		for(buffer_t *input : inputsarray)
 		{
-			std::fill(inputs[i].data(), inputs[i].data() + numSamples, buffer_t{0});
+			std::fill(input, input + numSamples, buffer_t{0});
 		}
 	}
 
@@ -108,28 +123,28 @@ public:
 	void ClearOutputBuffers(uint32 numSamples)
 	{
 		MPT_ASSERT(numSamples <= bufferSize);
-		for(size_t i = 0; i < outputs.size(); i++)
+		for(buffer_t *output : outputsarray)
 		{
-			std::fill(outputs[i].data(), outputs[i].data() + numSamples, buffer_t{0});
+			std::fill(output, output + numSamples, buffer_t{0});
 		}
 	}
 
-	PluginMixBuffer()
+	explicit PluginMixBuffer(uint32 numSamples)
 	{
-		Initialize(2, 0);
+		Initialize(2, 0, numSamples);
 	}
 
 	// Return pointer to a given input or output buffer
-	const buffer_t *GetInputBuffer(uint32 index) const { return inputs[index].data(); }
-	const buffer_t *GetOutputBuffer(uint32 index) const { return outputs[index].data(); }
-	buffer_t *GetInputBuffer(uint32 index) { return inputs[index].data(); }
-	buffer_t *GetOutputBuffer(uint32 index) { return outputs[index].data(); }
+	const buffer_t *GetInputBuffer(uint32 index) const { return inputsarray[index]; }
+	const buffer_t *GetOutputBuffer(uint32 index) const { return outputsarray[index]; }
+	buffer_t *GetInputBuffer(uint32 index) { return inputsarray[index]; }
+	buffer_t *GetOutputBuffer(uint32 index) { return outputsarray[index]; }
 
 	// Return pointer array to all input or output buffers
-	buffer_t **GetInputBufferArray() { return inputs.empty() ? nullptr : inputsarray.data(); }
-	buffer_t **GetOutputBufferArray() { return outputs.empty() ? nullptr : outputsarray.data(); }
+	buffer_t **GetInputBufferArray() { return inputsarray.empty() ? nullptr : inputsarray.data(); }
+	buffer_t **GetOutputBufferArray() { return outputsarray.empty() ? nullptr : outputsarray.data(); }
 
-	bool Ok() const { return (inputs.size() + outputs.size()) > 0; }
+	bool Ok() const { return (inputsarray.size() + outputsarray.size()) > 0; }
 
 };
 
@@ -83,7 +83,7 @@ DMOPlugin::DMOPlugin(VSTPluginLib &factory, CSoundFile &sndFile, SNDMIXPLUGIN &m
 		m_pParamInfo = nullptr;
 	if (FAILED(m_pMediaObject->QueryInterface(IID_IMediaParams, (void **)&m_pMediaParams)))
 		m_pMediaParams = nullptr;
-	m_alignedBuffer.f32 = mpt::align_bytes<16, MIXBUFFERSIZE * 2>(m_interleavedBuffer.f32);
+	m_alignedBuffer.f32 = mpt::align_bytes<16, MIXBUFFERSIZE_MAX * 2>(m_interleavedBuffer.f32);
 	m_mixBuffer.Initialize(2, 2);
 }
 
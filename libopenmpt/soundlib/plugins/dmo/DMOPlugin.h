@@ -38,8 +38,8 @@ protected:
 	} m_alignedBuffer;
 	union
 	{
-		int16 i16[MIXBUFFERSIZE * 2 + 16];		// 16-bit PCM Stereo interleaved
-		float f32[MIXBUFFERSIZE * 2 + 16];		// 32-bit Float Stereo interleaved
+		int16 i16[MIXBUFFERSIZE_MAX * 2 + 16];		// 16-bit PCM Stereo interleaved
+		float f32[MIXBUFFERSIZE_MAX * 2 + 16];		// 32-bit Float Stereo interleaved
 	} m_interleavedBuffer;
 	bool m_useFloat;
 
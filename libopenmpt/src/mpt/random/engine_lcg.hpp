@@ -31,6 +31,10 @@ public:
 	typedef Tstate state_type;
 	typedef Tvalue result_type;
 
+	static constexpr state_type modulus = m;
+	static constexpr state_type multiplier = a;
+	static constexpr state_type increment = c;
+
 private:
 	state_type state;
 
@@ -65,6 +69,13 @@ public:
 		state = s;
 		return result;
 	}
+	// Allows generating several results at once (e.g. with SIMD) and continuing the sequence afterwards.
+	inline state_type get_state() const noexcept {
+		return state;
+	}
+	inline void set_state(state_type s) noexcept {
+		state = s;
+	}
 };
 
 #if MPT_COMPILER_MSVC
@@ -46,6 +46,15 @@ public:
 	{
 		return DitherChannels.size();
 	}
+	// Access to the individual parts, for processing whole buffers at once
+	Tdither &GetChannelDither(std::size_t channel)
+	{
+		return DitherChannels[channel];
+	}
+	typename Tdither::prng_type &GetPRNG()
+	{
+		return prng;
+	}
 	template <uint32 targetbits>
 	MPT_FORCEINLINE MixSampleInt process(std::size_t channel, MixSampleInt sample)
 	{
@@ -50,7 +50,15 @@ public:
 	template <uint32 targetbits, typename Trng>
 	MPT_FORCEINLINE MixSampleFloat process(MixSampleFloat sample, Trng &prng)
 	{
-		return mix_sample_cast<MixSampleFloat>(process<targetbits>(mix_sample_cast<MixSampleInt>(sample), prng));
+		if constexpr(targetbits == 0)
+		{
+			// Floating point output, do not clip the sample by going through fixed point
+			MPT_UNUSED(prng);
+			return sample;
+		} else
+		{
+			return mix_sample_cast<MixSampleFloat>(process<targetbits>(mix_sample_cast<MixSampleInt>(sample), prng));
+		}
 	}
 };
 
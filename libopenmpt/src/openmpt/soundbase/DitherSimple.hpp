@@ -33,56 +33,79 @@ private:
 	int32 error = 0;
 
 public:
+	// Number of bits taken from the PRNG per sample (0 if there is nothing to dither)
+	template <uint32 targetbits>
+	static constexpr int noise_bits()
+	{
+		static_assert(sizeof(MixSampleInt) == 4);
+		if constexpr(targetbits == 0)
+		{
+			return 0;
+		} else
+		{
+			constexpr int rshift = (32 - targetbits) - MixSampleIntTraits::mix_headroom_bits;
+			return (rshift <= 1) ? 0 : (rshift + (ditherdepth - 1));
+		}
+	}
+
+	// Dither with noise that has already been drawn from the PRNG
+	template <uint32 targetbits>
+	MPT_FORCEINLINE MixSampleInt process_noise(MixSampleInt sample, unsigned int unoise)
+	{
+		static_assert(noise_bits<targetbits>() > 0);
+		constexpr int rshift = (32 - targetbits) - MixSampleIntTraits::mix_headroom_bits;
+		constexpr int rshiftpositive = (rshift > 1) ? rshift : 1;  // work-around warnings about negative shift with C++14 compilers
+		constexpr int round_mask = ~((1 << rshiftpositive) - 1);
+		constexpr int round_offset = 1 << (rshiftpositive - 1);
+		constexpr int noise_bias = (1 << (noise_bits<targetbits>() - 1));
+		int32 e = error;
+		int noise = static_cast<int>(unoise) - noise_bias;  // un-bias
+		int val = sample;
+		if constexpr(shaped)
+		{
+			val += (e >> 1);
+		}
+		int rounded = (val + noise + round_offset) & round_mask;
+		e = val - rounded;
+		sample = rounded;
+		error = e;
+		return sample;
+	}
+
 	template <uint32 targetbits, typename Trng>
 	MPT_FORCEINLINE MixSampleInt process(MixSampleInt sample, Trng &prng)
 	{
-		if constexpr(targetbits == 0)
+		if constexpr(noise_bits<targetbits>() == 0)
 		{
 			MPT_UNUSED(prng);
+			// nothing to dither
 			return sample;
 		} else
 		{
-			static_assert(sizeof(MixSampleInt) == 4);
-			constexpr int rshift = (32 - targetbits) - MixSampleIntTraits::mix_headroom_bits;
-			if constexpr(rshift <= 1)
+			constexpr int noise_bits_ = noise_bits<targetbits>();
+			unsigned int unoise = 0;
+			if constexpr(triangular)
 			{
-				MPT_UNUSED(prng);
-				// nothing to dither
-				return sample;
+				unoise = (mpt::random<unsigned int>(prng, noise_bits_) + mpt::random<unsigned int>(prng, noise_bits_)) >> 1;
 			} else
 			{
-				constexpr int rshiftpositive = (rshift > 1) ? rshift : 1;  // work-around warnings about negative shift with C++14 compilers
-				constexpr int round_mask = ~((1 << rshiftpositive) - 1);
-				constexpr int round_offset = 1 << (rshiftpositive - 1);
-				constexpr int noise_bits = rshiftpositive + (ditherdepth - 1);
-				constexpr int noise_bias = (1 << (noise_bits - 1));
-				int32 e = error;
-				unsigned int unoise = 0;
-				if constexpr(triangular)
-				{
-					unoise = (mpt::random<unsigned int>(prng, noise_bits) + mpt::random<unsigned int>(prng, noise_bits)) >> 1;
-				} else
-				{
-					unoise = mpt::random<unsigned int>(prng, noise_bits);
-				}
-				int noise = static_cast<int>(unoise) - noise_bias;  // un-bias
-				int val = sample;
-				if constexpr(shaped)
-				{
-					val += (e >> 1);
-				}
-				int rounded = (val + noise + round_offset) & round_mask;
-				e = val - rounded;
-				sample = rounded;
-				error = e;
-				return sample;
+				unoise = mpt::random<unsigned int>(prng, noise_bits_);
 			}
+			return process_noise<targetbits>(sample, unoise);
 		}
 	}
 	template <uint32 targetbits, typename Trng>
 	MPT_FORCEINLINE MixSampleFloat process(MixSampleFloat sample, Trng &prng)
 	{
-		return mix_sample_cast<MixSampleFloat>(process<targetbits>(mix_sample_cast<MixSampleInt>(sample), prng));
+		if constexpr(targetbits == 0)
+		{
+			// Floating point output, do not clip the sample by going through fixed point
+			MPT_UNUSED(prng);
+			return sample;
+		} else
+		{
+			return mix_sample_cast<MixSampleFloat>(process<targetbits>(mix_sample_cast<MixSampleInt>(sample), prng));
+		}
 	}
 };
 
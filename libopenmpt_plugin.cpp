@@ -1,5 +1,6 @@
 #include <libopenmpt/libopenmpt.h>
 #include <libopenmpt/libopenmpt.hpp>
+#include <libopenmpt/libopenmpt_ext.hpp>
 
 #include <retrovert/audio_format.h>
 #include <retrovert/io.h>
@@ -11,17 +12,43 @@
 
 #include <assert.h>
 #include <string.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 const int MAX_EXT_COUNT = 16 * 1024;
 static char s_supported_extensions[MAX_EXT_COUNT];
 const char* PLUGIN_NAME = "libopenmpt";
+const char* PLUGIN_VERSION = "0.0.3";
 
 const RVIo* g_io_api = nullptr;
 const RVLog* g_rv_log = nullptr;
 
+// The log service may not be called from several threads at once. Everything that logs from worker threads (metadata
+// batch, background analysis) has to go through rv_log_locked
+static std::mutex g_rv_log_mutex;
+
+#define rv_log_locked(log_call)                               \
+    {                                                         \
+        std::lock_guard<std::mutex> log_lock(g_rv_log_mutex); \
+        log_call;                                             \
+    }
+
+// The same goes for the io service. Background analysis frees the song data on its own thread, so every call into
+// g_io_api is made with g_io_mutex held
+static std::mutex g_io_mutex;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #define ID_SAMPLE_RATE "SampleRate"
@@ -34,6 +61,9 @@ const RVLog* g_rv_log = nullptr;
 #define ID_PITCH_FACTOR "PitchFactor"
 #define ID_USE_AMIGA_RESAMPLER_AMIGA_MODS "AmigaModResampling"
 #define ID_AMIGA_RESAMPLER_FILTER "AmigaModResamplerFilter"
+#define ID_RENDER_AHEAD "RenderAhead"
+#define ID_MODULE_CACHE "ModuleCache"
+#define ID_ASYNC_OPEN "AsyncOpen"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // clang-format off
@@ -84,6 +114,15 @@ static const RVSIntegerRangeValue s_channels[] = {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static const RVSIntegerRangeValue s_render_ahead_range[] = {
+    {"Off", 0},
+    {"50 ms", 50},
+    {"100 ms", 100},
+    {"200 ms", 200},
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static const RVSStringRangeValue s_amiga_filter_values[] = {
     {"Default filter", "auto"},
     {"Amiga A500 filter", "a500"},
@@ -123,6 +162,18 @@ static RVSetting s_settings[] = {
                         2.0f),
     RVSFloatValue_Range(ID_PITCH_FACTOR, "Pitch Factor", "Set the pitch factor. Default value is 1.0", 1.0, 0.01f,
                         2.0f),
+    RVSIntValue_DescRange(ID_RENDER_AHEAD, "Render Ahead",
+                          "Render audio ahead of time on a separate thread to avoid drop-outs on expensive songs. "
+                          "Off renders directly when the audio is requested. Takes effect when the next song is opened.",
+                          0, s_render_ahead_range),
+    RVSBoolValue(ID_MODULE_CACHE, "Cache song lengths",
+                 "Store song lengths and metadata on disk, so songs that have been played or scanned before open "
+                 "without calculating their length again.",
+                 true),
+    RVSBoolValue(ID_ASYNC_OPEN, "Start playback early",
+                 "Start playing songs while their length is still being calculated in the background. Seeking waits "
+                 "for the calculation to finish.",
+                 true),
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -136,16 +187,85 @@ enum class Channels {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+const int RENDER_BLOCK_FRAMES = 512;
+const int RENDER_MAX_CHANNELS = 4;
+// Number of ticks of playback state kept for openmpt_event. Enough for a few seconds of render ahead at high tempos
+const int STATE_HISTORY_TICKS = 512;
+
+// One block of pre-rendered audio. The format is stored per block as settings or the host sample rate can change while
+// blocks are still queued.
+struct RenderBlock {
+    float data[RENDER_BLOCK_FRAMES * RENDER_MAX_CHANNELS];
+    uint32_t frame_count = 0;
+    uint32_t sample_rate = 0;
+    // Blocks rendered before the last seek or settings change have an older generation and are skipped by the reader
+    uint32_t generation = 0;
+    uint8_t channel_count = 0;
+    // Set on the last block of the song
+    bool finished = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Single-producer (render thread), single-consumer (read_data) ring of rendered blocks. The indices only ever
+// increase, the block for an index is blocks[index % blocks.size()]
+
+struct RenderAhead {
+    std::vector<RenderBlock> blocks;
+    std::atomic<uint64_t> write_index{0};
+    std::atomic<uint64_t> read_index{0};
+    // Frames already consumed from the block at read_index. Only touched by the reader
+    uint32_t read_offset = 0;
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint32_t> host_sample_rate{48000};
+    std::atomic<bool> quit{false};
+    uint32_t ahead_ms = 0;
+    std::thread thread;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Subsong lengths and metadata of a song that is already playing, calculated on a separate instance of the module
+// so the background thread never touches the module that is being played
+
+struct SongAnalysis {
+    std::thread thread;
+    std::atomic<bool> done{false};
+    // Only valid once done is set
+    bool ok = false;
+    std::string subsongs;
+    double length = 0.0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 struct OpenMptData {
-    openmpt::module* mod = 0;
+    openmpt::module_ext* mod = 0;
+    // Url, size and hash of the open module, used to hand the module back to the module pool on close
+    std::string url;
+    uint64_t data_size = 0;
+    uint64_t data_hash = 0;
+    openmpt::ext::channel_output* channel_output = nullptr;
+    openmpt::ext::state_history* state_history = nullptr;
+    // Left/right output of each module channel when virtual channels are requested
+    std::vector<float> channel_buffer;
+    std::vector<float*> channel_pointers;
     std::string ext;
-    // number of channels to render
-    Channels channels;
-    int sample_rate;
+    // number of channels to render. Can be changed by settings updates while rendering
+    std::atomic<Channels> channels{Channels::Default};
+    std::atomic<int> sample_rate{0};
     float length = 0.0f;
     void* song_data = 0;
+    // Render ahead time in ms as set in the settings, 0 if disabled
+    int render_ahead_ms = 0;
+    // Held while rendering or changing the state of mod when render ahead is active
+    std::mutex render_mutex;
+    std::unique_ptr<RenderAhead> render_ahead;
+    // Running while the song was opened without knowing its subsongs yet
+    std::unique_ptr<SongAnalysis> analysis;
 };
 
+static void render_ahead_stop(OpenMptData* data);
+static void song_analysis_apply(OpenMptData* data, bool wait);
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static const char* openmpt_supported_extensions() {
@@ -183,6 +303,11 @@ static void* openmpt_create(const RVService* service_api) {
 
 static int openmpt_destroy(void* user_data) {
     OpenMptData* data = (OpenMptData*)user_data;
+    render_ahead_stop(data);
+    if (data->mod) {
+        song_analysis_apply(data, true);
+    }
+    delete data->mod;
     delete data;
     return 0;
 }
@@ -216,8 +341,24 @@ static RVProbeResult openmpt_probe_can_play(uint8_t* data, uint64_t data_size, c
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Formats a value for queue_ctl, which always expects '.' as decimal separator
+
+static std::string ctl_float_value(double value) {
+    std::ostringstream stream;
+    stream.imbue(std::locale::classic());
+    stream.precision(17);
+    stream << value;
+    return stream.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Changes to the module are queued and picked up by the next render call, so this can run on any thread while
+// rendering is in progress
+
 static void settings_apply(OpenMptData* data, const RVSettings* api) {
     const char* ext = data->ext.c_str();
+    openmpt::ext::queued_params* params =
+        static_cast<openmpt::ext::queued_params*>(data->mod->get_interface(openmpt::ext::queued_params_id));
 
     RVSBoolResult bool_res = {};
     RVSStringResult string_res = {};
@@ -233,38 +374,671 @@ static void settings_apply(OpenMptData* data, const RVSettings* api) {
     }
 
     if ((float_res = RVSettings_get_float(api, PLUGIN_NAME, ext, ID_MASTER_GAIN)).result == RVSettingsResult_Ok) {
-        data->mod->set_render_param(openmpt::module::RENDER_MASTERGAIN_MILLIBEL, int(float_res.value * 1000));
+        params->queue_render_param(openmpt::module::RENDER_MASTERGAIN_MILLIBEL, int(float_res.value * 1000));
     }
 
     if ((int_res = RVSettings_get_int(api, PLUGIN_NAME, ext, ID_STEREO_SEPARATION)).result == RVSettingsResult_Ok) {
-        data->mod->set_render_param(openmpt::module::RENDER_STEREOSEPARATION_PERCENT, int_res.value);
+        params->queue_render_param(openmpt::module::RENDER_STEREOSEPARATION_PERCENT, int_res.value);
     }
 
     if ((int_res = RVSettings_get_int(api, PLUGIN_NAME, ext, ID_VOLUME_RAMPING)).result == RVSettingsResult_Ok) {
-        data->mod->set_render_param(openmpt::module::RENDER_VOLUMERAMPING_STRENGTH, int_res.value);
+        params->queue_render_param(openmpt::module::RENDER_VOLUMERAMPING_STRENGTH, int_res.value);
     }
 
     if ((int_res = RVSettings_get_int(api, PLUGIN_NAME, ext, ID_INTERPOLATION_RANGE)).result == RVSettingsResult_Ok) {
-        data->mod->set_render_param(openmpt::module::RENDER_INTERPOLATIONFILTER_LENGTH, int_res.value);
+        params->queue_render_param(openmpt::module::RENDER_INTERPOLATIONFILTER_LENGTH, int_res.value);
     }
 
     if ((string_res = RVSettings_get_string(api, PLUGIN_NAME, ext, ID_AMIGA_RESAMPLER_FILTER)).result ==
         RVSettingsResult_Ok) {
-        data->mod->ctl_set_text("render.resampler.emulate_amiga_type", string_res.value);
+        params->queue_ctl("render.resampler.emulate_amiga_type", string_res.value);
     }
 
     if ((bool_res = RVSettings_get_bool(api, PLUGIN_NAME, ext, ID_USE_AMIGA_RESAMPLER_AMIGA_MODS)).result ==
         RVSettingsResult_Ok) {
-        data->mod->ctl_set_boolean("render.resampler.emulate_amiga", bool_res.value);
+        params->queue_ctl("render.resampler.emulate_amiga", bool_res.value ? "1" : "0");
     }
 
     if ((float_res = RVSettings_get_float(api, PLUGIN_NAME, ext, ID_TEMPO_FACTOR)).result == RVSettingsResult_Ok) {
-        data->mod->ctl_set_floatingpoint("play.tempo_factor", float_res.value);
+        params->queue_ctl("play.tempo_factor", ctl_float_value(float_res.value));
     }
 
     if ((float_res = RVSettings_get_float(api, PLUGIN_NAME, ext, ID_PITCH_FACTOR)).result == RVSettingsResult_Ok) {
-        data->mod->ctl_set_floatingpoint("play.pitch_factor", float_res.value);
+        params->queue_ctl("play.pitch_factor", ctl_float_value(float_res.value));
+    }
+
+    if ((int_res = RVSettings_get_int(api, PLUGIN_NAME, ext, ID_RENDER_AHEAD)).result == RVSettingsResult_Ok) {
+        data->render_ahead_ms = int_res.value;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Renders up to frame_count frames in the format selected by the settings. Returns the number of rendered frames
+
+static int render_frames(OpenMptData* data, float* output, int frame_count, uint32_t sample_rate,
+                         uint8_t* channel_count) {
+    switch (data->channels) {
+        default:
+        case Channels::Stereo:
+        case Channels::Default: {
+            *channel_count = 2;
+            return (int)data->mod->read_interleaved_stereo(sample_rate, frame_count, output);
+        }
+
+        case Channels::Mono: {
+            *channel_count = 1;
+            return (int)data->mod->read(sample_rate, frame_count, output);
+        }
+
+        case Channels::Quad: {
+            *channel_count = 4;
+            return (int)data->mod->read_interleaved_quad(sample_rate, frame_count, output);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void render_ahead_thread(OpenMptData* data) {
+    RenderAhead* ra = data->render_ahead.get();
+    const uint64_t block_count = ra->blocks.size();
+    // Generation in which the end of the song was rendered. Nothing more is rendered until the next flush
+    uint32_t ended_generation = UINT32_MAX;
+
+    while (!ra->quit.load(std::memory_order_acquire)) {
+        const uint64_t write_index = ra->write_index.load(std::memory_order_relaxed);
+        const uint64_t read_index = ra->read_index.load(std::memory_order_acquire);
+        const uint32_t host_sample_rate = ra->host_sample_rate.load(std::memory_order_relaxed);
+
+        uint64_t target_blocks = (uint64_t(ra->ahead_ms) * host_sample_rate / 1000 + RENDER_BLOCK_FRAMES - 1) /
+                                 RENDER_BLOCK_FRAMES;
+        target_blocks = std::min(std::max(target_blocks, uint64_t(1)), block_count);
+
+        if (write_index - read_index >= target_blocks ||
+            ended_generation == ra->generation.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        RenderBlock& block = ra->blocks[write_index % block_count];
+
+        {
+            std::lock_guard<std::mutex> lock(data->render_mutex);
+            song_analysis_apply(data, false);
+            // Read under the lock, so blocks rendered after a flush are guaranteed to have the new generation
+            block.generation = ra->generation.load(std::memory_order_relaxed);
+            const int sample_rate = data->sample_rate;
+            block.sample_rate = sample_rate != 0 ? uint32_t(sample_rate) : host_sample_rate;
+            block.frame_count =
+                render_frames(data, block.data, RENDER_BLOCK_FRAMES, block.sample_rate, &block.channel_count);
+        }
+
+        block.finished = block.frame_count < RENDER_BLOCK_FRAMES;
+
+        if (block.finished) {
+            ended_generation = block.generation;
+        }
+
+        ra->write_index.store(write_index + 1, std::memory_order_release);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void render_ahead_start(OpenMptData* data) {
+    if (data->render_ahead_ms <= 0) {
+        return;
+    }
+
+    // Enough blocks for the render ahead time at the highest sample rate we support
+    const uint32_t max_sample_rate = 192000;
+    const size_t block_count =
+        (uint64_t(data->render_ahead_ms) * max_sample_rate / 1000 + RENDER_BLOCK_FRAMES - 1) / RENDER_BLOCK_FRAMES;
+
+    data->render_ahead.reset(new RenderAhead);
+    data->render_ahead->blocks.resize(block_count);
+    data->render_ahead->ahead_ms = data->render_ahead_ms;
+    data->render_ahead->thread = std::thread(render_ahead_thread, data);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void render_ahead_stop(OpenMptData* data) {
+    if (!data->render_ahead) {
+        return;
+    }
+
+    data->render_ahead->quit.store(true, std::memory_order_release);
+    data->render_ahead->thread.join();
+    data->render_ahead.reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Makes the reader skip everything rendered so far. Has to be called with render_mutex held, after the state of mod
+// has been changed
+
+static void render_ahead_flush(OpenMptData* data) {
+    if (data->render_ahead) {
+        data->render_ahead->generation.fetch_add(1, std::memory_order_release);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static RVReadInfo render_ahead_read(OpenMptData* data, RVReadData dest) {
+    RenderAhead* ra = data->render_ahead.get();
+    const uint64_t block_count = ra->blocks.size();
+
+    ra->host_sample_rate.store(dest.info.format.sample_rate, std::memory_order_relaxed);
+
+    const uint32_t generation = ra->generation.load(std::memory_order_acquire);
+    const uint64_t write_index = ra->write_index.load(std::memory_order_acquire);
+    uint64_t read_index = ra->read_index.load(std::memory_order_relaxed);
+
+    // Drop blocks that were rendered before the last seek or settings change
+    while (read_index != write_index && int32_t(ra->blocks[read_index % block_count].generation - generation) < 0) {
+        read_index++;
+        ra->read_offset = 0;
+    }
+
+    if (read_index == write_index) {
+        // The render thread hasn't caught up (yet), output silence rather than blocking the audio thread
+        ra->read_index.store(read_index, std::memory_order_release);
+
+        const Channels channels = data->channels;
+        const int settings_sample_rate = data->sample_rate;
+        uint8_t channel_count = channels == Channels::Mono ? 1 : channels == Channels::Quad ? 4 : 2;
+        uint32_t sample_rate = settings_sample_rate != 0 ? uint32_t(settings_sample_rate) : dest.info.format.sample_rate;
+        uint32_t frame_count = std::min(uint32_t(RENDER_BLOCK_FRAMES),
+                                        uint32_t(dest.channels_output_max_bytes_size / (channel_count * sizeof(float))));
+
+        memset(dest.channels_output, 0, frame_count * channel_count * sizeof(float));
+
+        RVAudioFormat format = {RVAudioStreamFormat_F32, channel_count, sample_rate};
+        return RVReadInfo{format, frame_count, RVReadStatus_Ok, 0};
+    }
+
+    const RenderBlock& block = ra->blocks[read_index % block_count];
+    const RVAudioFormat format = {RVAudioStreamFormat_F32, block.channel_count, block.sample_rate};
+    const uint32_t frame_size = block.channel_count * sizeof(float);
+    const uint32_t frame_count =
+        std::min(block.frame_count - ra->read_offset, dest.channels_output_max_bytes_size / frame_size);
+
+    memcpy(dest.channels_output, &block.data[ra->read_offset * block.channel_count], frame_count * frame_size);
+
+    ra->read_offset += frame_count;
+
+    RVReadStatus status = RVReadStatus_Ok;
+
+    if (ra->read_offset >= block.frame_count) {
+        if (block.finished) {
+            status = RVReadStatus_Finished;
+        }
+
+        ra->read_offset = 0;
+        read_index++;
+    }
+
+    // Publishing the read index hands the block back to the render thread, so it has to be the last access to it
+    ra->read_index.store(read_index, std::memory_order_release);
+
+    return RVReadInfo{format, frame_count, status, 0};
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Everything the metadata scan needs to know about a module. This is also what is stored in the module cache.
+
+struct ModuleInfo {
+    // Subsong boundaries and lengths in the format of the libopenmpt "load.subsongs" ctl
+    std::string subsongs;
+    std::string title;
+    std::string type_long;
+    std::string tracker;
+    std::string artist;
+    std::string date;
+    std::string message;
+    double length = 0.0;
+    std::vector<std::string> samples;
+    std::vector<std::string> instruments;
+    // Only filled in if there is more than one subsong
+    std::vector<std::pair<std::string, double>> subsong_lengths;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Notice that this changes the selected subsong
+
+static ModuleInfo module_info_from_module(openmpt::module* mod) {
+    ModuleInfo info;
+
+    info.subsongs = mod->ctl_get_text("load.subsongs");
+    info.title = mod->get_metadata("title");
+    info.type_long = mod->get_metadata("type_long");
+    info.tracker = mod->get_metadata("tracker");
+    info.artist = mod->get_metadata("artist");
+    info.date = mod->get_metadata("date");
+    info.message = mod->get_metadata("message");
+    info.length = mod->get_duration_seconds();
+    info.samples = mod->get_sample_names();
+    info.instruments = mod->get_instrument_names();
+
+    if (mod->get_num_subsongs() > 1) {
+        int i = 0;
+        for (const auto& name : mod->get_subsong_names()) {
+            mod->select_subsong(i++);
+            info.subsong_lengths.emplace_back(name, mod->get_duration_seconds());
+        }
+    }
+
+    return info;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool async_open_enabled(const RVSettings* settings_api) {
+    RVSBoolResult bool_res;
+
+    if ((bool_res = RVSettings_get_bool(settings_api, PLUGIN_NAME, "", ID_ASYNC_OPEN)).result == RVSettingsResult_Ok) {
+        return bool_res.value;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool cache_enabled(const RVSettings* settings_api) {
+    RVSBoolResult bool_res;
+
+    if ((bool_res = RVSettings_get_bool(settings_api, PLUGIN_NAME, "", ID_MODULE_CACHE)).result == RVSettingsResult_Ok) {
+        return bool_res.value;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Fast non-cryptographic hash of the module data, used as the key for the module cache and the module pool
+
+static uint64_t cache_hash(const uint8_t* data, uint64_t size) {
+    const uint64_t k0 = 0x9e3779b97f4a7c15ull;
+    const uint64_t k1 = 0xc2b2ae3d27d4eb4full;
+    uint64_t h = size * k0;
+    uint64_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h ^= word * k0;
+        h = ((h << 31) | (h >> 33)) * k1;
+    }
+
+    uint64_t tail = 0;
+    if (i < size) {
+        memcpy(&tail, data + i, size_t(size - i));
+    }
+    h ^= tail * k0;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Entries are invalidated when the library version changes as lengths may be calculated differently
+
+static const std::string& cache_version() {
+    static const std::string s_version = openmpt::string::get("library_version") + " " + PLUGIN_VERSION;
+    return s_version;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const std::filesystem::path& cache_directory() {
+    static const std::filesystem::path s_path = []() -> std::filesystem::path {
+        const char* dir = nullptr;
+
+        if ((dir = getenv("XDG_CACHE_HOME")) && dir[0]) {
+            return std::filesystem::path(dir) / "retrovert" / PLUGIN_NAME;
+        } else if ((dir = getenv("LOCALAPPDATA")) && dir[0]) {
+            return std::filesystem::path(dir) / "retrovert" / "cache" / PLUGIN_NAME;
+        } else if ((dir = getenv("HOME")) && dir[0]) {
+            return std::filesystem::path(dir) / ".cache" / "retrovert" / PLUGIN_NAME;
+        }
+
+        return std::filesystem::path();
+    }();
+
+    return s_path;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::filesystem::path cache_path(uint64_t hash, uint64_t size) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%llx", (unsigned long long)hash, (unsigned long long)size);
+
+    // Spread the entries over 256 directories to keep them at a manageable size for huge collections
+    return cache_directory() / std::string(name, 2) / name;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Entries are stored as one "key value" pair per line, so line breaks and backslashes are escaped
+
+static std::string cache_escape(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+
+    for (char c : text) {
+        switch (c) {
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\r':
+                result += "\\r";
+                break;
+            default:
+                result += c;
+                break;
+        }
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::string cache_unescape(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            const char c = text[++i];
+            result += c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+        } else {
+            result += text[i];
+        }
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool cache_load(uint64_t hash, uint64_t size, ModuleInfo* info) {
+    if (cache_directory().empty()) {
+        return false;
+    }
+
+    std::ifstream file(cache_path(hash, size), std::ios::binary);
+    std::string line;
+
+    if (!file || !std::getline(file, line) || line != "version " + cache_version()) {
+        return false;
+    }
+
+    while (std::getline(file, line)) {
+        const size_t split = line.find(' ');
+        const std::string key = line.substr(0, split);
+        const std::string value = split != std::string::npos ? cache_unescape(line.substr(split + 1)) : std::string();
+
+        if (key == "subsongs") {
+            info->subsongs = value;
+        } else if (key == "title") {
+            info->title = value;
+        } else if (key == "type_long") {
+            info->type_long = value;
+        } else if (key == "tracker") {
+            info->tracker = value;
+        } else if (key == "artist") {
+            info->artist = value;
+        } else if (key == "date") {
+            info->date = value;
+        } else if (key == "message") {
+            info->message = value;
+        } else if (key == "length") {
+            info->length = strtod(value.c_str(), nullptr);
+        } else if (key == "sample") {
+            info->samples.push_back(value);
+        } else if (key == "instrument") {
+            info->instruments.push_back(value);
+        } else if (key == "subsong") {
+            // "<length> <name>"
+            const size_t name_split = value.find(' ');
+            const std::string name = name_split != std::string::npos ? value.substr(name_split + 1) : std::string();
+            info->subsong_lengths.emplace_back(name, strtod(value.c_str(), nullptr));
+        }
+    }
+
+    return !info->subsongs.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void cache_store(uint64_t hash, uint64_t size, const ModuleInfo& info) {
+    if (cache_directory().empty()) {
+        return;
+    }
+
+    const std::filesystem::path path = cache_path(hash, size);
+    std::error_code error;
+
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Write to a temporary file first so other threads/processes never see a partial entry
+    std::filesystem::path temp_path = path;
+    temp_path += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+
+        if (!file) {
+            rv_log_locked(rv_error("Unable to write module cache entry %s", temp_path.string().c_str()));
+            return;
+        }
+
+        char length[64];
+
+        file << "version " << cache_version() << "\n";
+        file << "subsongs " << cache_escape(info.subsongs) << "\n";
+        file << "title " << cache_escape(info.title) << "\n";
+        file << "type_long " << cache_escape(info.type_long) << "\n";
+        file << "tracker " << cache_escape(info.tracker) << "\n";
+        file << "artist " << cache_escape(info.artist) << "\n";
+        file << "date " << cache_escape(info.date) << "\n";
+        file << "message " << cache_escape(info.message) << "\n";
+        snprintf(length, sizeof(length), "%.17g", info.length);
+        file << "length " << length << "\n";
+
+        for (const auto& sample : info.samples) {
+            file << "sample " << cache_escape(sample) << "\n";
+        }
+
+        for (const auto& instrument : info.instruments) {
+            file << "instrument " << cache_escape(instrument) << "\n";
+        }
+
+        for (const auto& subsong : info.subsong_lengths) {
+            snprintf(length, sizeof(length), "%.17g", subsong.second);
+            file << "subsong " << length << " " << cache_escape(subsong.first) << "\n";
+        }
+    }
+
+    std::filesystem::rename(temp_path, path, error);
+
+    if (error) {
+        std::filesystem::remove(temp_path, error);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loads a module for metadata purposes only. Sample data, plugins and seek checkpoints are skipped as none of them
+// is needed for tags, names or durations
+
+static std::unique_ptr<openmpt::module> metadata_load_module(const uint8_t* data, uint64_t data_size) {
+    static const std::map<std::string, std::string> s_metadata_ctls = {
+        {"load.skip_samples", "1"},
+        {"load.skip_plugins", "1"},
+        {"seek.checkpoint_interval", "0"},
+    };
+
+    return std::unique_ptr<openmpt::module>(new openmpt::module(data, data_size, std::clog, s_metadata_ctls));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void song_data_free(void* song_data) {
+    std::lock_guard<std::mutex> io_lock(g_io_mutex);
+    RVIo_free_url_to_memory(g_io_api, song_data);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loads a second, sample-less instance of the song to calculate what openmpt_open skipped. Takes ownership of
+// song_data, which is freed as soon as that instance has been loaded
+
+static void song_analysis_start(OpenMptData* data, uint8_t* song_data, uint64_t song_size, bool use_cache,
+                                uint64_t hash) {
+    SongAnalysis* analysis = new SongAnalysis;
+    data->analysis.reset(analysis);
+
+    analysis->thread = std::thread([analysis, song_data, song_size, use_cache, hash]() {
+        std::unique_ptr<openmpt::module> mod;
+
+        try {
+            mod = metadata_load_module(song_data, song_size);
+        } catch (...) {
+        }
+
+        // Both the playing and the analysis module have their own copy of the song by now
+        song_data_free(song_data);
+
+        try {
+            if (mod) {
+                ModuleInfo info = module_info_from_module(mod.get());
+
+                if (use_cache) {
+                    cache_store(hash, song_size, info);
+                }
+
+                analysis->subsongs = info.subsongs;
+                analysis->length = info.length;
+                analysis->ok = true;
+            }
+        } catch (...) {
+        }
+
+        if (!analysis->ok) {
+            rv_log_locked(rv_error("openmpt: Unable to calculate subsongs in the background"));
+        }
+
+        analysis->done.store(true, std::memory_order_release);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hands the result of the background analysis to the playing module. Has to be called by whoever currently renders
+// from mod, with render_mutex held unless nothing else can render or seek anymore. If wait is false nothing happens
+// until the analysis is done
+
+static void song_analysis_apply(OpenMptData* data, bool wait) {
+    SongAnalysis* analysis = data->analysis.get();
+
+    if (!analysis || (!wait && !analysis->done.load(std::memory_order_acquire))) {
+        return;
+    }
+
+    analysis->thread.join();
+
+    if (analysis->ok) {
+        data->mod->ctl_set_text("load.subsongs", analysis->subsongs);
+        data->length = (float)analysis->length;
     }
+
+    data->analysis.reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Modules that have been closed are kept around for a while so that switching subsongs or replaying a file doesn't
+// have to load and parse it again. Modules are keyed on url, size and hash of the file, so a file that changed on disk
+// is loaded again. A module is only reused when it is idle: it is taken out of the pool while it is played back and
+// only handed back on close, so it is never shared between instances playing at the same time. Instances that open a
+// url which is already playing load their own copy.
+
+const size_t MODULE_POOL_SIZE = 4;
+
+struct PooledModule {
+    std::string url;
+    uint64_t size = 0;
+    uint64_t hash = 0;
+    std::unique_ptr<openmpt::module_ext> mod;
+    float length = 0.0f;
+};
+
+struct ModulePool {
+    std::mutex mutex;
+    // Most recently closed module first
+    std::list<PooledModule> modules;
+};
+
+static ModulePool& module_pool() {
+    static ModulePool pool;
+    return pool;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Takes an idle module loaded from the same url and data out of the pool. Returns false if there is none
+
+static bool module_pool_take(const char* url, uint64_t size, uint64_t hash, PooledModule* entry) {
+    ModulePool& pool = module_pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    for (auto it = pool.modules.begin(); it != pool.modules.end(); ++it) {
+        if (it->url == url && it->size == size && it->hash == hash) {
+            *entry = std::move(*it);
+            pool.modules.erase(it);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hands a module that is no longer played back to the pool, evicting the least recently used ones
+
+static void module_pool_give(PooledModule entry) {
+    std::list<PooledModule> evicted;
+
+    {
+        ModulePool& pool = module_pool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.modules.push_front(std::move(entry));
+
+        while (pool.modules.size() > MODULE_POOL_SIZE) {
+            evicted.splice(evicted.end(), pool.modules, std::prev(pool.modules.end()));
+        }
+    }
+
+    // evicted modules are freed here, outside of the lock
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Sizes the buffers for the output of each module channel up front, so that rendering virtual channels doesn't
+// allocate memory
+
+static void channel_buffers_init(OpenMptData* data) {
+    const size_t module_channels = data->channel_output ? size_t(data->mod->get_num_channels()) : 0;
+    data->channel_buffer.assign(module_channels * 2 * RENDER_BLOCK_FRAMES, 0.0f);
+    data->channel_pointers.assign(module_channels * 2, nullptr);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -273,26 +1047,92 @@ static int openmpt_open(void* user_data, const char* url, uint32_t subsong, cons
     RVIoReadUrlResult read_res;
 
     const RVSettings* settings_api = RVService_get_settings(service_api, RV_SETTINGS_API_VERSION);
+    struct OpenMptData* replayer_data = (struct OpenMptData*)user_data;
+    PooledModule pooled;
+
+    {
+        std::lock_guard<std::mutex> io_lock(g_io_mutex);
+        read_res = RVIo_read_url_to_memory(g_io_api, url);
+    }
 
-    if ((read_res = RVIo_read_url_to_memory(g_io_api, url)).data == nullptr) {
+    if (read_res.data == nullptr) {
         rv_error("Failed to load %s to memory", url);
         return -1;
     }
 
-    struct OpenMptData* replayer_data = (struct OpenMptData*)user_data;
+    const uint64_t hash = cache_hash(read_res.data, read_res.data_size);
+
+    replayer_data->url = url;
+    replayer_data->data_size = read_res.data_size;
+    replayer_data->data_hash = hash;
+
+    // Reusing an already parsed module only needs the subsong to be selected
+    if (module_pool_take(url, read_res.data_size, hash, &pooled)) {
+        song_data_free(read_res.data);
+        replayer_data->mod = pooled.mod.release();
+        replayer_data->channel_output = static_cast<openmpt::ext::channel_output*>(
+            replayer_data->mod->get_interface(openmpt::ext::channel_output_id));
+        channel_buffers_init(replayer_data);
+        replayer_data->state_history = static_cast<openmpt::ext::state_history*>(
+            replayer_data->mod->get_interface(openmpt::ext::state_history_id));
+        replayer_data->length = pooled.length;
+        static_cast<openmpt::ext::restart*>(replayer_data->mod->get_interface(openmpt::ext::restart_id))
+            ->restart_subsong(subsong);
+
+        settings_apply(replayer_data, settings_api);
+        render_ahead_start(replayer_data);
+
+        return 0;
+    }
+
+    // With a cache hit the subsong lengths don't have to be calculated when loading
+    const bool use_cache = cache_enabled(settings_api);
+    // Output is always float, so the master mix (plugins, global volume) can stay in floating point as well
+    std::map<std::string, std::string> ctls = {{"render.state_history", std::to_string(STATE_HISTORY_TICKS)},
+                                               {"render.mixer.float", "1"}};
+    ModuleInfo cached_info;
+    const bool cache_hit = use_cache && cache_load(hash, read_res.data_size, &cached_info);
+    // Starting anywhere else than at the first subsong needs to know where the subsongs are
+    const bool async = !cache_hit && subsong == 0 && async_open_enabled(settings_api);
+
+    if (cache_hit) {
+        ctls["load.subsongs"] = cached_info.subsongs;
+    } else if (async) {
+        ctls["load.skip_subsongs_init"] = "1";
+    }
 
     try {
-        replayer_data->mod = new openmpt::module(read_res.data, read_res.data_size);
+        replayer_data->mod = new openmpt::module_ext(read_res.data, read_res.data_size, std::clog, ctls);
+        replayer_data->channel_output = static_cast<openmpt::ext::channel_output*>(
+            replayer_data->mod->get_interface(openmpt::ext::channel_output_id));
+        channel_buffers_init(replayer_data);
+        replayer_data->state_history = static_cast<openmpt::ext::state_history*>(
+            replayer_data->mod->get_interface(openmpt::ext::state_history_id));
     } catch (...) {
+        song_data_free(read_res.data);
         return -1;
     }
 
     // rv_info("Started to play %s (subsong %d)", url, subsong);
 
-    replayer_data->length = (float)replayer_data->mod->get_duration_seconds();
-    replayer_data->mod->select_subsong(subsong);
+    if (async) {
+        // A freshly loaded module is already positioned at the start of the first subsong
+        replayer_data->length = 0.0f;
+        song_analysis_start(replayer_data, read_res.data, read_res.data_size, use_cache, hash);
+    } else {
+        // The module keeps its own copy of everything it needs
+        song_data_free(read_res.data);
+
+        if (use_cache && !cache_hit) {
+            cache_store(hash, read_res.data_size, module_info_from_module(replayer_data->mod));
+        }
+
+        replayer_data->length = (float)replayer_data->mod->get_duration_seconds();
+        replayer_data->mod->select_subsong(subsong);
+    }
 
     settings_apply(replayer_data, settings_api);
+    render_ahead_start(replayer_data);
 
     return 0;
 }
@@ -302,59 +1142,118 @@ static int openmpt_open(void* user_data, const char* url, uint32_t subsong, cons
 void openmpt_close(void* user_data) {
     struct OpenMptData* replayer_data = (struct OpenMptData*)user_data;
 
-    delete replayer_data->mod;
-    delete replayer_data;
+    // The render thread has to be gone before the module is, the instance itself is freed in destroy
+    render_ahead_stop(replayer_data);
+
+    // Pooled modules are expected to know their subsongs
+    if (replayer_data->mod) {
+        song_analysis_apply(replayer_data, true);
+    }
+
+    if (replayer_data->mod) {
+        module_pool_give(PooledModule{replayer_data->url, replayer_data->data_size, replayer_data->data_hash,
+                                      std::unique_ptr<openmpt::module_ext>(replayer_data->mod), replayer_data->length});
+    }
+
+    replayer_data->mod = nullptr;
+    replayer_data->channel_output = nullptr;
+    replayer_data->state_history = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Renders the stereo mix and the output of each module channel in one pass. Every virtual channel is written as a
+// planar block of mono frames. Like the channel output of libopenmpt, they don't have global volume and click removal
+// applied, so they don't necessarily add up to the stereo mix
+
+static RVReadInfo read_with_virtual_channels(OpenMptData* data, RVReadData dest, uint32_t frame_count,
+                                             uint32_t sample_rate) {
+    const uint32_t module_channels = uint32_t(data->mod->get_num_channels());
+    const uint32_t channel_count = std::min(uint32_t(dest.info.virtual_channel_count), module_channels);
+
+    frame_count = std::min(frame_count, dest.virtual_channels_output_max_bytes_size /
+                                            uint32_t(std::max(channel_count, 1u) * sizeof(float)));
+
+    // Only fetch the channels that the host asked for
+    for (uint32_t i = 0; i < module_channels; ++i) {
+        float* left = i < channel_count ? &data->channel_buffer[(i * 2 + 0) * RENDER_BLOCK_FRAMES] : nullptr;
+        float* right = i < channel_count ? &data->channel_buffer[(i * 2 + 1) * RENDER_BLOCK_FRAMES] : nullptr;
+        data->channel_pointers[i * 2 + 0] = left;
+        data->channel_pointers[i * 2 + 1] = right;
+    }
+
+    const uint32_t gen_count = (uint32_t)data->channel_output->read_interleaved_stereo_channels(
+        sample_rate, frame_count, (float*)dest.channels_output, module_channels, data->channel_pointers.data());
+
+    float* output = (float*)dest.virtual_channel_output;
+
+    for (uint32_t c = 0; c < channel_count; ++c) {
+        const float* left = data->channel_pointers[c * 2 + 0];
+        const float* right = data->channel_pointers[c * 2 + 1];
+
+        for (uint32_t i = 0; i < gen_count; ++i) {
+            output[c * gen_count + i] = (left[i] + right[i]) * 0.5f;
+        }
+    }
+
+    RVAudioFormat format = {RVAudioStreamFormat_F32, 2, sample_rate};
+    return RVReadInfo{format, gen_count, gen_count == frame_count ? RVReadStatus_Ok : RVReadStatus_Finished,
+                      uint16_t(channel_count)};
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// static RVReadInfo openmpt_read_data(void* user_data, void* dest, uint32_t max_output_bytes, uint32_t sample_rate) {
 static RVReadInfo openmpt_read_data(void* user_data, RVReadData dest) {
     struct OpenMptData* replayer_data = (struct OpenMptData*)user_data;
     uint32_t sample_rate = dest.info.format.sample_rate;
 
-    const int samples_to_generate = std::min(uint32_t(512), dest.channels_output_max_bytes_size / 8);
-
-    // support overringing the default sample rate
-    if (replayer_data->sample_rate != 0) {
-        sample_rate = replayer_data->sample_rate;
+    if (replayer_data->render_ahead) {
+        return render_ahead_read(replayer_data, dest);
     }
 
-    uint8_t channel_count = 2;
-    uint16_t gen_count = 0;
+    // Seeking and the analysis hand-over must not happen while rendering
+    std::lock_guard<std::mutex> lock(replayer_data->render_mutex);
+    song_analysis_apply(replayer_data, false);
 
-    switch (replayer_data->channels) {
-        default:
-        case Channels::Stereo:
-        case Channels::Default: {
-            gen_count = (uint16_t)replayer_data->mod->read_interleaved_stereo(sample_rate, samples_to_generate,
-                                                                              (float*)dest.channels_output);
-            break;
-        }
+    const int samples_to_generate = std::min(uint32_t(RENDER_BLOCK_FRAMES), dest.channels_output_max_bytes_size / 8);
 
-        case Channels::Mono: {
-            gen_count =
-                (uint16_t)replayer_data->mod->read(sample_rate, samples_to_generate, (float*)dest.channels_output);
-            channel_count = 1;
-            break;
-        }
+    // support overringing the default sample rate
+    const int settings_sample_rate = replayer_data->sample_rate;
+    if (settings_sample_rate != 0) {
+        sample_rate = settings_sample_rate;
+    }
 
-        case Channels::Quad: {
-            gen_count = (uint16_t)replayer_data->mod->read_interleaved_quad(sample_rate, samples_to_generate,
-                                                                            (float*)dest.channels_output);
-            channel_count = 4;
-            break;
-        }
+    // Virtual channels are only available for stereo output
+    const Channels channels = replayer_data->channels;
+    const bool stereo = channels != Channels::Mono && channels != Channels::Quad;
+
+    if (stereo && replayer_data->channel_output && dest.virtual_channel_output && dest.info.virtual_channel_count) {
+        return read_with_virtual_channels(replayer_data, dest, samples_to_generate, sample_rate);
     }
 
+    uint8_t channel_count = 2;
+    uint16_t gen_count =
+        (uint16_t)render_frames(replayer_data, (float*)dest.channels_output, samples_to_generate, sample_rate,
+                                &channel_count);
+
     RVAudioFormat format = {RVAudioStreamFormat_F32, channel_count, sample_rate};
-    return RVReadInfo{format, gen_count, gen_count == 512 ? RVReadStatus_Ok : RVReadStatus_Finished, 0};
+    return RVReadInfo{format, gen_count, gen_count == RENDER_BLOCK_FRAMES ? RVReadStatus_Ok : RVReadStatus_Finished, 0};
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static int64_t openmpt_seek(void* user_data, int64_t ms) {
-    return 0;
+    struct OpenMptData* replayer_data = (struct OpenMptData*)user_data;
+    std::lock_guard<std::mutex> lock(replayer_data->render_mutex);
+
+    // Seeking needs the subsong lengths
+    song_analysis_apply(replayer_data, true);
+
+    // libopenmpt resumes from the closest seek checkpoint and returns the position it actually landed on
+    double pos = replayer_data->mod->set_position_seconds(double(ms) / 1000.0);
+    render_ahead_flush(replayer_data);
+
+    return int64_t(pos * 1000.0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -371,109 +1270,230 @@ static const char* filename_from_path(const char* path) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static int openmpt_metadata(const char* filename, const RVService* service_api) {
+static void metadata_write(const char* filename, const ModuleInfo& info, const RVMetadata* metadata_api) {
+    auto index = RVMetadata_create_url(metadata_api, filename);
+    const char* title = info.title != "" ? info.title.c_str() : filename_from_path(filename);
+
+    rv_log_locked(rv_info("Updating meta data for %s", filename));
+
+    RVMetadata_set_tag(metadata_api, index, RV_METADATA_TITLE_TAG, title);
+    RVMetadata_set_tag(metadata_api, index, RV_METADATA_SONGTYPE_TAG, info.type_long.c_str());
+    RVMetadata_set_tag(metadata_api, index, RV_METADATA_AUTHORINGTOOL_TAG, info.tracker.c_str());
+    RVMetadata_set_tag(metadata_api, index, RV_METADATA_ARTIST_TAG, info.artist.c_str());
+    RVMetadata_set_tag(metadata_api, index, RV_METADATA_DATE_TAG, info.date.c_str());
+    RVMetadata_set_tag(metadata_api, index, RV_METADATA_MESSAGE_TAG, info.message.c_str());
+    RVMetadata_set_tag_f64(metadata_api, index, RV_METADATA_LENGTH_TAG, info.length);
+
+    for (const auto& sample : info.samples) {
+        RVMetadata_add_sample(metadata_api, index, sample.c_str());
+    }
+
+    for (const auto& instrument : info.instruments) {
+        RVMetadata_add_instrument(metadata_api, index, instrument.c_str());
+    }
+
+    int i = 0;
+    for (const auto& subsong : info.subsong_lengths) {
+        RVMetadata_add_subsong(metadata_api, index, i++, subsong.first.c_str(), (float)subsong.second);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Updates the metadata of a single file. Calls into the IO and metadata services are done with the respective mutex
+// held, everything else may run in parallel with other calls.
+
+static bool metadata_update(const char* filename, const RVIo* io_api, const RVMetadata* metadata_api, bool use_cache,
+                            std::mutex& io_mutex, std::mutex& metadata_mutex) {
     RVIoReadUrlResult read_res;
 
+    {
+        std::lock_guard<std::mutex> lock(io_mutex);
+        read_res = RVIo_read_url_to_memory(io_api, filename);
+    }
+
+    if (read_res.data == nullptr) {
+        rv_log_locked(rv_error("Failed to load %s to memory", filename));
+        return false;
+    }
+
+    const uint64_t data_size = read_res.data_size;
+    const uint64_t hash = use_cache ? cache_hash(read_res.data, data_size) : 0;
+    ModuleInfo info;
+    bool found = use_cache && cache_load(hash, data_size, &info);
+
+    if (!found) {
+        try {
+            // The module keeps its own copy of everything it needs, so the data can be freed right after
+            std::unique_ptr<openmpt::module> mod = metadata_load_module(read_res.data, data_size);
+            info = module_info_from_module(mod.get());
+            found = true;
+        } catch (...) {
+            rv_log_locked(rv_error("Failed to open %s even if is as supported format", filename));
+        }
+
+        if (found && use_cache) {
+            cache_store(hash, data_size, info);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(io_mutex);
+        RVIo_free_url_to_memory(io_api, read_res.data);
+    }
+
+    if (found) {
+        std::lock_guard<std::mutex> lock(metadata_mutex);
+        metadata_write(filename, info, metadata_api);
+    }
+
+    return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int openmpt_metadata(const char* filename, const RVService* service_api) {
     const RVIo* io_api = RVService_get_io(service_api, RV_IO_API_VERSION);
     const RVMetadata* metadata_api = RVService_get_metadata(service_api, RV_METADATA_API_VERSION);
+    const RVSettings* settings_api = RVService_get_settings(service_api, RV_SETTINGS_API_VERSION);
+    std::mutex io_mutex;
+    std::mutex metadata_mutex;
 
-    if ((read_res = RVIo_read_url_to_memory(g_io_api, filename)).data == nullptr) {
-        rv_error("Failed to load %s to memory", filename);
+    if (!metadata_update(filename, io_api, metadata_api, cache_enabled(settings_api), io_mutex, metadata_mutex)) {
         return -1;
     }
 
-    openmpt::module* mod = nullptr;
+    return 0;
+}
 
-    try {
-        mod = new openmpt::module(read_res.data, read_res.data_size);
-    } catch (...) {
-        rv_error("Failed to open %s even if is as supported format", filename);
-        return -1;
-    }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Updates the metadata for a list of files using a pool of worker threads. Loading and scanning the modules runs in
+// parallel while calls into the IO and metadata services are serialized. thread_count 0 uses one thread per core.
+// Returns the number of files that failed.
 
-    auto index = RVMetadata_create_url(metadata_api, filename);
-    char title[512] = {0};
+static int openmpt_metadata_batch(const char* const* filenames, uint32_t count, const RVService* service_api,
+                                  uint32_t thread_count) {
+    const RVIo* io_api = RVService_get_io(service_api, RV_IO_API_VERSION);
+    const RVMetadata* metadata_api = RVService_get_metadata(service_api, RV_METADATA_API_VERSION);
+    const RVSettings* settings_api = RVService_get_settings(service_api, RV_SETTINGS_API_VERSION);
+    const bool use_cache = cache_enabled(settings_api);
 
-    const auto& mod_title = mod->get_metadata("title");
+    std::atomic<uint32_t> next_file{0};
+    std::atomic<int> fail_count{0};
+    std::mutex io_mutex;
+    std::mutex metadata_mutex;
 
-    if (mod_title != "") {
-        strcpy(title, mod_title.c_str());
-    } else {
-        const char* file_title = filename_from_path(filename);
-        strcpy(title, file_title);
+    auto worker = [&]() {
+        for (;;) {
+            const uint32_t file = next_file.fetch_add(1, std::memory_order_relaxed);
+
+            if (file >= count) {
+                return;
+            }
+
+            if (!metadata_update(filenames[file], io_api, metadata_api, use_cache, io_mutex, metadata_mutex)) {
+                fail_count++;
+            }
+        }
+    };
+
+    if (thread_count == 0) {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
     }
 
-    rv_info("Updating meta data for %s", filename);
+    thread_count = std::min(thread_count, count);
 
-    RVMetadata_set_tag(metadata_api, index, RV_METADATA_TITLE_TAG, title);
-    RVMetadata_set_tag(metadata_api, index, RV_METADATA_SONGTYPE_TAG, mod->get_metadata("type_long").c_str());
-    RVMetadata_set_tag(metadata_api, index, RV_METADATA_AUTHORINGTOOL_TAG, mod->get_metadata("tracker").c_str());
-    RVMetadata_set_tag(metadata_api, index, RV_METADATA_ARTIST_TAG, mod->get_metadata("artist").c_str());
-    RVMetadata_set_tag(metadata_api, index, RV_METADATA_DATE_TAG, mod->get_metadata("date").c_str());
-    RVMetadata_set_tag(metadata_api, index, RV_METADATA_MESSAGE_TAG, mod->get_metadata("message").c_str());
-    RVMetadata_set_tag_f64(metadata_api, index, RV_METADATA_LENGTH_TAG, mod->get_duration_seconds());
-
-    for (const auto& sample : mod->get_sample_names()) {
-        RVMetadata_add_sample(metadata_api, index, sample.c_str());
+    std::vector<std::thread> threads;
+
+    // The calling thread is one of the workers
+    for (uint32_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
     }
 
-    for (const auto& instrument : mod->get_instrument_names()) {
-        RVMetadata_add_instrument(metadata_api, index, instrument.c_str());
+    worker();
+
+    for (auto& thread : threads) {
+        thread.join();
     }
 
-    const int subsong_count = mod->get_num_subsongs();
+    return fail_count;
+}
 
-    if (subsong_count > 1) {
-        int i = 0;
-        for (const auto& name : mod->get_subsong_names()) {
-            mod->select_subsong(i);
-            RVMetadata_add_subsong(metadata_api, index, i, name.c_str(), (float)mod->get_duration_seconds());
-            ++i;
-        }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Frames that have been rendered but not handed to the host yet. Only whole blocks are counted as the read offset
+// within the current block belongs to the audio thread
+
+static uint64_t render_ahead_pending_frames(OpenMptData* data) {
+    if (!data->render_ahead) {
+        return 0;
     }
 
-    // Make sure to free the buffer before we leave
-    RVIo_free_url_to_memory(io_api, read_res.data);
+    const uint64_t write_index = data->render_ahead->write_index.load(std::memory_order_acquire);
+    const uint64_t read_index = data->render_ahead->read_index.load(std::memory_order_acquire);
 
-    return 0;
+    return write_index > read_index ? (write_index - read_index) * RENDER_BLOCK_FRAMES : 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reports the state of the song at the position that has been handed to the host last, not at the render position.
+// Only reads state snapshots that libopenmpt records while rendering, so this never waits for the audio thread
 
 static void openmpt_event(void* user_data, uint8_t* data, uint64_t len) {
     struct OpenMptData* replayer_data = (struct OpenMptData*)user_data;
+    (void)len;
+
+    memset(data, 0, 8);
+
+    if (!replayer_data->state_history) {
+        return;
+    }
+
+    const uint64_t rendered = replayer_data->state_history->get_rendered_frames();
+    const uint64_t pending = render_ahead_pending_frames(replayer_data);
+    const uint64_t position = rendered > pending ? rendered - pending : 0;
 
-    int current_pattern = replayer_data->mod->get_current_pattern();
-    int current_row = replayer_data->mod->get_current_row();
-    int channel_vol_0 = int(replayer_data->mod->get_current_channel_vu_mono(0) * 255.0f);
-    int channel_vol_1 = int(replayer_data->mod->get_current_channel_vu_mono(1) * 255.0f);
-    int channel_vol_2 = int(replayer_data->mod->get_current_channel_vu_mono(2) * 255.0f);
-    int channel_vol_3 = int(replayer_data->mod->get_current_channel_vu_mono(3) * 255.0f);
+    openmpt::ext::playback_state state;
+    openmpt::ext::playback_state_channel channels[4] = {};
 
-    //printf("vols %d %d %d %d\n", channel_vol_0, channel_vol_1, channel_vol_2, channel_vol_3);
-    //printf("current_pattern %d\n", current_pattern);
-    //printf("current_row %d\n", current_row);
+    if (replayer_data->state_history->get_state_at(position, state, channels, 4) < 0) {
+        return;
+    }
+
+    int channel_vols[4];
+
+    for (int i = 0; i < 4; ++i) {
+        // Same scale as openmpt::module::get_current_channel_vu_mono
+        const float left = channels[i].vu_left * (1.0f / 128.0f);
+        const float right = channels[i].vu_right * (1.0f / 128.0f);
+        channel_vols[i] = std::min(int(std::sqrt(left * left + right * right) * 255.0f), 255);
+    }
 
-    data[7] = current_pattern & 0xFF; 
-    data[6] = current_row & 0xFF; 
+    data[7] = state.pattern & 0xFF;
+    data[6] = state.row & 0xFF;
     data[5] = 0;//(comb_position >> 16) & 0xFF;
     data[4] = 0;//(comb_position >> 24) & 0xFF;
-    data[3] = channel_vol_0;
-    data[2] = channel_vol_1;
-    data[1] = channel_vol_2;
-    data[0] = channel_vol_3;
-
-    (void)len;
-    (void)user_data;
-    (void)data;
+    data[3] = channel_vols[0];
+    data[2] = channel_vols[1];
+    data[1] = channel_vols[2];
+    data[0] = channel_vols[3];
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static RVSettingsUpdate openmpt_settings_updated(void* user_data, const RVService* service_api) {
     const RVSettings* settings_api = RVService_get_settings(service_api, RV_SETTINGS_API_VERSION);
+    OpenMptData* data = (OpenMptData*)user_data;
+
+    if (!data->mod) {
+        return RVSettingsUpdate_Default;
+    }
 
-    settings_apply((OpenMptData*)user_data, settings_api);
+    settings_apply(data, settings_api);
+
+    // Audio that has been rendered ahead with the old settings is thrown away
+    std::lock_guard<std::mutex> lock(data->render_mutex);
+    render_ahead_flush(data);
 
     return RVSettingsUpdate_Default;
 }
@@ -496,7 +1516,7 @@ static void openmpt_static_init(const RVService* service_api) {
 static RVPlaybackPlugin s_openmpt_plugin = {
     RV_PLAYBACK_PLUGIN_API_VERSION,
     PLUGIN_NAME,
-    "0.0.3",
+    PLUGIN_VERSION,
     "libopenmpt 0.7.6",
     openmpt_probe_can_play,
     openmpt_supported_extensions,
@@ -520,4 +1540,10 @@ extern "C" RV_EXPORT RVPlaybackPlugin* rv_playback_plugin() {
     return &s_openmpt_plugin;
 }
 
+// Not part of RVPlaybackPlugin (yet), hosts that know about it can use this to index large collections faster
+extern "C" RV_EXPORT int rv_openmpt_metadata_batch(const char* const* filenames, uint32_t count,
+                                                   const RVService* service_api, uint32_t thread_count) {
+    return openmpt_metadata_batch(filenames, count, service_api, thread_count);
+}
+
 //#endif
@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+
+# Renders a set of Amiga modules with Paula emulation (render.resampler.emulate_amiga) for every
+# emulated filter type, comparing a baseline openmpt123 with the one to test.
+# Prints the total wall-clock time of both builds and whether their output is identical.
+# Paula emulation only applies to ProTracker-compatible 4-channel MODs.
+#
+# Usage: bench_amiga_resampler.sh module...
+#
+# Environment:
+#   OPENMPT123       openmpt123 binary linked against the library to test [default: openmpt123]
+#   OPENMPT123_BASE  openmpt123 binary linked against the baseline library [required]
+#   SAMPLERATE       output sample rate [default: 48000]
+#   RUNS             number of passes over the corpus per filter type [default: 3]
+
+if [ $# -eq 0 ] || [ -z "$OPENMPT123_BASE" ]; then
+	echo "Usage: OPENMPT123_BASE=... $0 module..." >&2
+	exit 1
+fi
+
+OPENMPT123=${OPENMPT123:-openmpt123}
+SAMPLERATE=${SAMPLERATE:-48000}
+RUNS=${RUNS:-3}
+
+# A failed render must not go unnoticed in the checksum pipeline below
+set -o pipefail
+
+# Renders the corpus RUNS times, prints the elapsed milliseconds followed by the checksum of one pass
+render() {
+	START=$(date +%s%N)
+	RUN=0
+	while [ $RUN -lt $RUNS ]; do
+		SUM=$(for MODULE in "$@"; do
+			"$BINARY" --quiet --float --stdout --samplerate "$SAMPLERATE" \
+				--ctl render.resampler.emulate_amiga=1 --ctl render.resampler.emulate_amiga_type=$TYPE -- "$MODULE" || exit 1
+		done | cksum)
+		if [ $? -ne 0 ]; then
+			echo "$BINARY failed to render the modules with $TYPE filter" >&2
+			exit 1
+		fi
+		RUN=$((RUN + 1))
+	done
+	END=$(date +%s%N)
+	echo "$(( (END - START) / 1000000 / RUNS )) $SUM"
+}
+
+echo "type         base_ms   test_ms  identical"
+for TYPE in a500 a1200 unfiltered; do
+	BINARY=$OPENMPT123_BASE
+	BASE=$(render "$@") || exit 1
+	BINARY=$OPENMPT123
+	TEST=$(render "$@") || exit 1
+	BASE_MS=${BASE%% *}
+	TEST_MS=${TEST%% *}
+	if [ "${BASE#* }" = "${TEST#* }" ]; then IDENTICAL=yes; else IDENTICAL=no; fi
+	printf "%-10s  %8d  %8d  %s\n" $TYPE $BASE_MS $TEST_MS $IDENTICAL
+done
@@ -0,0 +1,38 @@
+#!/bin/sh
+
+# Renders a set of modules at every supported mix block size (render.mixer.block_size)
+# and prints the total wall-clock time per block size.
+#
+# Usage: bench_mix_block_size.sh module...
+#
+# Environment:
+#   OPENMPT123   openmpt123 binary linked against the library to test [default: openmpt123]
+#   SAMPLERATE   output sample rate [default: 48000]
+#   FILTER       interpolation filter taps [default: 8]
+#   RUNS         number of passes over the corpus per block size [default: 3]
+
+if [ $# -eq 0 ]; then
+	echo "Usage: $0 module..." >&2
+	exit 1
+fi
+
+OPENMPT123=${OPENMPT123:-openmpt123}
+SAMPLERATE=${SAMPLERATE:-48000}
+FILTER=${FILTER:-8}
+RUNS=${RUNS:-3}
+
+echo "block_size  total_ms  ms_per_run"
+for BLOCKSIZE in 64 128 256 512 1024 2048 4096; do
+	START=$(date +%s%N)
+	RUN=0
+	while [ $RUN -lt $RUNS ]; do
+		for MODULE in "$@"; do
+			"$OPENMPT123" --quiet --float --stdout --samplerate "$SAMPLERATE" --filter "$FILTER" \
+				--ctl render.mixer.block_size=$BLOCKSIZE -- "$MODULE" > /dev/null || exit 1
+		done
+		RUN=$((RUN + 1))
+	done
+	END=$(date +%s%N)
+	TOTAL=$(( (END - START) / 1000000 ))
+	printf "%10d  %8d  %10d\n" $BLOCKSIZE $TOTAL $((TOTAL / RUNS))
+done
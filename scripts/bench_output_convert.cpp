@@ -0,0 +1,95 @@
+// Microbenchmark for the conversion of the fixed-point mix buffer to the output sample formats
+// (AudioTargetBuffer::Process), comparing the generic ConvertBufferMixInternalFixedToBuffer
+// with the vectorized path for every output format and dither mode.
+//
+// Build from the repository root:
+//   g++ -O2 -std=c++17 -DLIBOPENMPT_BUILD -Ilibopenmpt -Ilibopenmpt/src -Ilibopenmpt/common \
+//       scripts/bench_output_convert.cpp -o bench_output_convert
+//
+// Usage: bench_output_convert [iterations]
+
+#include "stdafx.h"
+#include "soundlib/AudioReadTarget.h"
+#include "soundlib/AudioReadTargetSIMD.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+namespace
+{
+
+constexpr std::size_t BenchChannels = 2;
+constexpr std::size_t BenchFrames = MIXBUFFERSIZE;
+
+std::vector<MixSampleInt> MakeInput()
+{
+	std::vector<MixSampleInt> input(BenchChannels * BenchFrames);
+	uint32 s = 1;
+	for(auto &v : input)
+	{
+		s = s * 1103515245u + 12345u;
+		v = static_cast<int32>(s) >> 4;
+	}
+	return input;
+}
+
+template <typename T, typename Tfunc>
+double Measure(int iterations, Tfunc &&func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < iterations; i++)
+		func();
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	return ns / (static_cast<double>(iterations) * BenchChannels * BenchFrames);
+}
+
+template <typename T>
+void Bench(const char *name, std::size_t ditherMode, int iterations)
+{
+	const std::vector<MixSampleInt> input = MakeInput();
+	std::vector<MixSampleInt> mix(input.size());
+	std::vector<T> output(input.size());
+	mpt::lcg_msvc rd{42};
+	DithersOpenMPT dithers{rd, ditherMode, BenchChannels};
+
+	const double generic = Measure<T>(iterations, [&]()
+	{
+		mix = input;
+		std::visit(
+			[&](auto &ditherInstance)
+			{
+				ConvertBufferMixInternalFixedToBuffer<MixSampleIntTraits::mix_fractional_bits, false>(mpt::audio_span_interleaved<T>(output.data(), BenchChannels, BenchFrames), mpt::audio_span_interleaved<MixSampleInt>(mix.data(), BenchChannels, BenchFrames), ditherInstance, BenchChannels, BenchFrames);
+			},
+			dithers.Variant());
+	});
+	const double vectorized = Measure<T>(iterations, [&]()
+	{
+		mix = input;
+		AudioTargetBuffer<mpt::audio_span_interleaved<T>> target{mpt::audio_span_interleaved<T>(output.data(), BenchChannels, BenchFrames), dithers};
+		target.Process(mpt::audio_span_interleaved<MixSampleInt>(mix.data(), BenchChannels, BenchFrames));
+	});
+	std::printf("%-6s %-22s %8.2f %8.2f\n", name, DithersOpenMPT::GetModeName(ditherMode).c_str(), generic, vectorized);
+}
+
+}  // namespace
+
+OPENMPT_NAMESPACE_END
+
+
+int main(int argc, char *argv[])
+{
+	using namespace OPENMPT_NAMESPACE;
+	const int iterations = (argc > 1) ? std::atoi(argv[1]) : 20000;
+	std::printf("format dither                 generic vectorized (ns/sample)\n");
+	for(std::size_t mode = 0; mode < DithersOpenMPT::GetNumDithers(); mode++)
+		Bench<int16>("int16", mode, iterations);
+	for(std::size_t mode = 0; mode < DithersOpenMPT::GetNumDithers(); mode++)
+		Bench<int24>("int24", mode, iterations);
+	Bench<float>("float", DithersOpenMPT::NoDither, iterations);
+	return 0;
+}
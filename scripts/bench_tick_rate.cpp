@@ -0,0 +1,124 @@
+// Benchmark for the per-tick pattern and voice processing (CSoundFile::ProcessRow and CSoundFile::ReadNote),
+// printing how many ticks per second are processed for each module.
+// Modules are rendered at a low sample rate into a target that discards the output, so that the time spent
+// in the mixer stays small compared to the per-tick work. Useful inputs are sparse 4-channel MODs, where the
+// cost is dominated by the channel bookkeeping, and IT files with many NNA (background) voices.
+// At a regular sample rate (e.g. -samplerate 48000), the mixer dominates instead, which makes the realtime
+// factor (seconds of audio rendered per second) a benchmark for the voice mixing loop and the ModChannel layout.
+//
+// Build from the repository root, linking against a libopenmpt build that exports its internal symbols
+// (e.g. a static library build):
+//   g++ -O2 -std=c++17 -DLIBOPENMPT_BUILD -Ilibopenmpt -Ilibopenmpt/src -Ilibopenmpt/common \
+//       scripts/bench_tick_rate.cpp -o bench_tick_rate <libopenmpt library>
+//
+// Usage: bench_tick_rate [-runs N] [-samplerate N] module...
+
+#include "stdafx.h"
+#include "soundlib/Sndfile.h"
+#include "common/FileReader.h"
+#include "mpt/io_read/filecursor_memory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+namespace
+{
+
+class TickCounter : public ITickObserver
+{
+public:
+	void OnTick(const CSoundFile &, uint32) override { ticks++; }
+	uint64 ticks = 0;
+};
+
+class DiscardTarget : public IAudioTarget
+{
+public:
+	void Process(mpt::audio_span_interleaved<MixSampleInt>) override { }
+	void Process(mpt::audio_span_interleaved<MixSampleFloat>) override { }
+};
+
+bool Bench(const char *filename, int runs, uint32 sampleRate)
+{
+	std::ifstream f(filename, std::ios::binary);
+	const std::vector<char> data{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+	if(data.empty())
+	{
+		std::fprintf(stderr, "%s: cannot read file\n", filename);
+		return false;
+	}
+
+	uint64 ticks = 0, frames = 0;
+	double seconds = 0.0;
+	CHANNELINDEX voices = 0;
+	for(int run = 0; run < runs; run++)
+	{
+		auto sndFile = std::make_unique<CSoundFile>();
+		if(!sndFile->Create(mpt::IO::make_FileCursor<mpt::PathString>(mpt::as_span(data)), CSoundFile::loadCompleteModule))
+		{
+			std::fprintf(stderr, "%s: cannot load module\n", filename);
+			return false;
+		}
+		MixerSettings mixerSettings = sndFile->m_MixerSettings;
+		mixerSettings.gdwMixingFreq = sampleRate;
+		mixerSettings.gnChannels = 2;
+		sndFile->SetMixerSettings(mixerSettings);
+
+		TickCounter counter;
+		DiscardTarget target;
+		sndFile->m_tickObserver = &counter;
+		const auto start = std::chrono::steady_clock::now();
+		while(const auto rendered = sndFile->Read(4096, target))
+		{
+			frames += rendered;
+			voices = std::max(voices, sndFile->GetMixStat());
+			// Read only ever raises the mix statistics, so they are reset for every block like libopenmpt does
+			sndFile->ResetMixStat();
+		}
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ticks += counter.ticks;
+	}
+	std::printf("%-32s %10llu %8u %12.0f %10.1f\n", filename, static_cast<unsigned long long>(ticks / runs), voices, ticks / seconds, frames / (seconds * sampleRate));
+	return true;
+}
+
+}  // namespace
+
+OPENMPT_NAMESPACE_END
+
+
+int main(int argc, char *argv[])
+{
+	using namespace OPENMPT_NAMESPACE;
+	int runs = 3;
+	uint32 sampleRate = 8000;
+	int arg = 1;
+	for(; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+	{
+		if(!std::strcmp(argv[arg], "-runs"))
+			runs = std::max(1, std::atoi(argv[arg + 1]));
+		else if(!std::strcmp(argv[arg], "-samplerate"))
+			sampleRate = static_cast<uint32>(std::atoi(argv[arg + 1]));
+		else
+			break;
+	}
+	if(arg >= argc)
+	{
+		std::fprintf(stderr, "Usage: %s [-runs N] [-samplerate N] module...\n", argv[0]);
+		return 1;
+	}
+	std::printf("%-32s %10s %8s %12s %10s\n", "module", "ticks", "voices", "ticks/s", "realtime");
+	bool ok = true;
+	for(; arg < argc; arg++)
+		ok &= Bench(argv[arg], runs, sampleRate);
+	return ok ? 0 : 1;
+}